@@ -141,6 +141,10 @@ static int want_sdp = 1;
 
 static BenchmarkTimeStamps current_time;
 AVIOContext *progress_avio = NULL;
+AVIOContext *telemetry_avio = NULL;
+
+/* number of latency samples kept per output stream between two reports */
+#define TELEMETRY_MAX_LATENCY 4096
 
 static uint8_t *subtitle_out;
 
@@ -491,6 +495,7 @@ static void ffmpeg_cleanup(int ret)
 
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
+        print_filtergraph_stats(fg);
         avfilter_graph_free(&fg->graph);
         for (j = 0; j < fg->nb_inputs; j++) {
             while (av_fifo_size(fg->inputs[j]->frame_queue)) {
@@ -566,6 +571,8 @@ static void ffmpeg_cleanup(int ret)
         av_freep(&ost->audio_channels_map);
         ost->audio_channels_mapped = 0;
 
+        av_freep(&ost->latency);
+
         av_dict_free(&ost->sws_dict);
 
         avcodec_free_context(&ost->enc_ctx);
@@ -613,6 +620,7 @@ static void ffmpeg_cleanup(int ret)
                    av_err2str(AVERROR(errno)));
     }
     av_freep(&vstats_filename);
+    avio_closep(&telemetry_avio);
 
     av_freep(&input_streams);
     av_freep(&input_files);
@@ -677,6 +685,35 @@ static void update_benchmark(const char *fmt, ...)
     }
 }
 
+static int64_t telemetry_start(void)
+{
+    return telemetry_avio ? av_gettime_relative() : 0;
+}
+
+static void telemetry_add(int64_t *total, int64_t start)
+{
+    if (telemetry_avio)
+        *total += av_gettime_relative() - start;
+}
+
+/**
+ * Record the time elapsed since the packet the frame was decoded from was
+ * read from its input. The wallclock travels with the frame in
+ * reordered_opaque, see process_input().
+ */
+static void telemetry_record_latency(OutputStream *ost, const AVFrame *frame)
+{
+    if (!telemetry_avio || frame->reordered_opaque <= 0)
+        return;
+    if (!ost->latency) {
+        ost->latency = av_malloc_array(TELEMETRY_MAX_LATENCY, sizeof(*ost->latency));
+        if (!ost->latency)
+            return;
+    }
+    ost->latency[ost->nb_latency++ % TELEMETRY_MAX_LATENCY] =
+        av_gettime_relative() - frame->reordered_opaque;
+}
+
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
 {
     int i;
@@ -690,6 +727,7 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
 {
     AVFormatContext *s = of->ctx;
     AVStream *st = ost->st;
+    int64_t t0;
     int ret;
 
     /*
@@ -812,7 +850,9 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
               );
     }
 
+    t0 = telemetry_start();
     ret = av_interleaved_write_frame(s, pkt);
+    telemetry_add(&ost->mux_time, t0);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
@@ -912,6 +952,7 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
 {
     AVCodecContext *enc = ost->enc_ctx;
     AVPacket pkt;
+    int64_t t0;
     int ret;
 
     av_init_packet(&pkt);
@@ -936,17 +977,23 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                enc->time_base.num, enc->time_base.den);
     }
 
+    telemetry_record_latency(ost, frame);
+    t0 = telemetry_start();
     ret = avcodec_send_frame(enc, frame);
+    telemetry_add(&ost->encode_time, t0);
     if (ret < 0)
         goto error;
 
     while (1) {
+        t0 = telemetry_start();
         ret = avcodec_receive_packet(enc, &pkt);
+        telemetry_add(&ost->encode_time, t0);
         if (ret == AVERROR(EAGAIN))
             break;
         if (ret < 0)
             goto error;
 
+        ost->packets_encoded++;
         update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
 
         av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
@@ -1064,6 +1111,7 @@ static void do_video_out(OutputFile *of,
     double delta, delta0;
     double duration = 0;
     int frame_size = 0;
+    int64_t t0;
     InputStream *ist = NULL;
     AVFilterContext *filter = ost->filter->filter;
 
@@ -1284,20 +1332,27 @@ static void do_video_out(OutputFile *of,
 
         ost->frames_encoded++;
 
+        telemetry_record_latency(ost, in_picture);
+        t0 = telemetry_start();
         ret = avcodec_send_frame(enc, in_picture);
+        telemetry_add(&ost->encode_time, t0);
         if (ret < 0)
             goto error;
         // Make sure Closed Captions will not be duplicated
         av_frame_remove_side_data(in_picture, AV_FRAME_DATA_A53_CC);
 
         while (1) {
+            t0 = telemetry_start();
             ret = avcodec_receive_packet(enc, &pkt);
+            telemetry_add(&ost->encode_time, t0);
             update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
             if (ret == AVERROR(EAGAIN))
                 break;
             if (ret < 0)
                 goto error;
 
+            ost->packets_encoded++;
+
             if (debug_ts) {
                 av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
                        "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
@@ -1454,8 +1509,10 @@ static int reap_filters(int flush)
 
         while (1) {
             double float_pts = AV_NOPTS_VALUE; // this is identical to filtered_frame.pts but with higher precision
+            int64_t t0 = telemetry_start();
             ret = av_buffersink_get_frame_flags(filter, filtered_frame,
                                                AV_BUFFERSINK_FLAG_NO_REQUEST);
+            telemetry_add(&ost->filter->graph->filter_time, t0);
             if (ret < 0) {
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
                     av_log(NULL, AV_LOG_WARNING,
@@ -1913,6 +1970,7 @@ static void flush_encoders(void)
             const char *desc = NULL;
             AVPacket pkt;
             int pkt_size;
+            int64_t t0;
 
             switch (enc->codec_type) {
             case AVMEDIA_TYPE_AUDIO:
@@ -1931,6 +1989,7 @@ static void flush_encoders(void)
 
             update_benchmark(NULL);
 
+            t0 = telemetry_start();
             while ((ret = avcodec_receive_packet(enc, &pkt)) == AVERROR(EAGAIN)) {
                 ret = avcodec_send_frame(enc, NULL);
                 if (ret < 0) {
@@ -1940,6 +1999,7 @@ static void flush_encoders(void)
                     exit_program(1);
                 }
             }
+            telemetry_add(&ost->encode_time, t0);
 
             update_benchmark("flush_%s %d.%d", desc, ost->file_index, ost->index);
             if (ret < 0 && ret != AVERROR_EOF) {
@@ -1955,6 +2015,7 @@ static void flush_encoders(void)
                 output_packet(of, &pkt, ost, 1);
                 break;
             }
+            ost->packets_encoded++;
             if (ost->finished & MUXER_FINISHED) {
                 av_packet_unref(&pkt);
                 continue;
@@ -2130,6 +2191,7 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
 {
     FilterGraph *fg = ifilter->graph;
     int need_reinit, ret, i;
+    int64_t t0;
 
     /* determine if the parameters for this input changed */
     need_reinit = ifilter->format != frame->format;
@@ -2193,7 +2255,9 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
         }
     }
 
+    t0 = telemetry_start();
     ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, AV_BUFFERSRC_FLAG_PUSH);
+    telemetry_add(&fg->filter_time, t0);
     if (ret < 0) {
         if (ret != AVERROR_EOF)
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
@@ -2285,6 +2349,7 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
     AVFrame *decoded_frame;
     AVCodecContext *avctx = ist->dec_ctx;
     int ret, err = 0;
+    int64_t t0;
     AVRational decoded_frame_tb;
 
     if (!ist->decoded_frame && !(ist->decoded_frame = av_frame_alloc()))
@@ -2294,7 +2359,9 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
     decoded_frame = ist->decoded_frame;
 
     update_benchmark(NULL);
+    t0  = telemetry_start();
     ret = decode(avctx, decoded_frame, got_output, pkt);
+    telemetry_add(&ist->decode_time, t0);
     update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -2348,6 +2415,7 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     int i, ret = 0, err = 0;
     int64_t best_effort_timestamp;
     int64_t dts = AV_NOPTS_VALUE;
+    int64_t t0;
     AVPacket avpkt;
 
     // With fate-indeo3-2, we're getting 0-sized packets before EOF for some
@@ -2379,7 +2447,9 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     }
 
     update_benchmark(NULL);
+    t0  = telemetry_start();
     ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt ? &avpkt : NULL);
+    telemetry_add(&ist->decode_time, t0);
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -4028,7 +4098,10 @@ static void *input_thread(void *arg)
 
     while (1) {
         AVPacket pkt;
+        int64_t t0 = telemetry_start();
         ret = av_read_frame(f->ctx, &pkt);
+        if (telemetry_avio)
+            atomic_fetch_add(&f->demux_time, av_gettime_relative() - t0);
 
         if (ret == AVERROR(EAGAIN)) {
             av_usleep(10000);
@@ -4132,6 +4205,9 @@ static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 
 static int get_input_packet(InputFile *f, AVPacket *pkt)
 {
+    int64_t t0;
+    int ret;
+
     if (f->rate_emu) {
         int i;
         for (i = 0; i < f->nb_streams; i++) {
@@ -4147,7 +4223,11 @@ static int get_input_packet(InputFile *f, AVPacket *pkt)
     if (nb_input_files > 1)
         return get_input_packet_mt(f, pkt);
 #endif
-    return av_read_frame(f->ctx, pkt);
+    t0  = telemetry_start();
+    ret = av_read_frame(f->ctx, pkt);
+    if (telemetry_avio)
+        atomic_fetch_add(&f->demux_time, av_gettime_relative() - t0);
+    return ret;
 }
 
 static int got_eagain(void)
@@ -4350,6 +4430,10 @@ static int process_input(int file_index)
     if (ist->discard)
         goto discard_packet;
 
+    /* the decoder copies this into the frames decoded from the packet */
+    if (telemetry_avio && ist->decoding_needed)
+        ist->dec_ctx->reordered_opaque = av_gettime_relative();
+
     if (pkt.flags & AV_PKT_FLAG_CORRUPT) {
         av_log(NULL, exit_on_error ? AV_LOG_FATAL : AV_LOG_WARNING,
                "%s: corrupt input packet in stream %d\n", is->url, pkt.stream_index);
@@ -4536,9 +4620,12 @@ static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
     int nb_requests, nb_requests_max = 0;
     InputFilter *ifilter;
     InputStream *ist;
+    int64_t t0;
 
     *best_ist = NULL;
+    t0 = telemetry_start();
     ret = avfilter_graph_request_oldest(graph->graph);
+    telemetry_add(&graph->filter_time, t0);
     if (ret >= 0)
         return reap_filters(0);
 
@@ -4648,6 +4735,114 @@ static int transcode_step(void)
     return reap_filters(0);
 }
 
+static void telemetry_print_latency(AVBPrint *bp, OutputStream *ost)
+{
+    int nb = FFMIN(ost->nb_latency, TELEMETRY_MAX_LATENCY);
+
+    av_bprintf(bp, "\"latency\":{\"samples\":%d", nb);
+    if (nb) {
+        qsort(ost->latency, nb, sizeof(*ost->latency), compare_int64);
+        av_bprintf(bp, ",\"p50\":%"PRId64",\"p90\":%"PRId64",\"p99\":%"PRId64",\"max\":%"PRId64,
+                   ost->latency[nb * 50 / 100], ost->latency[nb * 90 / 100],
+                   ost->latency[nb * 99 / 100], ost->latency[nb - 1]);
+    }
+    av_bprintf(bp, "}");
+    ost->nb_latency = 0;
+}
+
+/**
+ * Write one line of JSON with the cumulative time spent in each stage of
+ * the pipeline, the current queue depths and the latencies seen since the
+ * previous line.
+ */
+static void write_telemetry(int is_last_report, int64_t timer_start, int64_t cur_time)
+{
+    static int64_t last_time = -1;
+    AVBPrint bp;
+    int i, j;
+
+    if (!telemetry_avio)
+        return;
+    if (!is_last_report) {
+        if (last_time == -1) {
+            last_time = cur_time;
+            return;
+        }
+        if (cur_time - last_time < telemetry_period * 1000000)
+            return;
+        last_time = cur_time;
+    }
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&bp, "{\"time\":%"PRId64",\"final\":%d,\"inputs\":[",
+               cur_time - timer_start, is_last_report);
+    for (i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+        int queued = 0;
+
+#if HAVE_THREADS
+        if (f->in_thread_queue)
+            queued = av_thread_message_queue_nb_elems(f->in_thread_queue);
+#endif
+        av_bprintf(&bp, "%s{\"file\":%d,\"demux_time\":%"PRId64",\"queued_packets\":%d,\"streams\":[",
+                   i ? "," : "", i, (int64_t)atomic_load(&f->demux_time), queued);
+        for (j = 0; j < f->nb_streams; j++) {
+            InputStream *ist = input_streams[f->ist_index + j];
+
+            av_bprintf(&bp, "%s{\"index\":%d,\"type\":\"%s\",\"packets\":%"PRIu64
+                       ",\"frames_decoded\":%"PRIu64",\"decode_time\":%"PRId64"}",
+                       j ? "," : "", ist->st->index,
+                       av_get_media_type_string(ist->st->codecpar->codec_type),
+                       ist->nb_packets, ist->frames_decoded, ist->decode_time);
+        }
+        av_bprintf(&bp, "]}");
+    }
+
+    av_bprintf(&bp, "],\"filtergraphs\":[");
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+        int queued = 0;
+
+        for (j = 0; j < fg->nb_inputs; j++)
+            queued += av_fifo_size(fg->inputs[j]->frame_queue) / sizeof(AVFrame *);
+        av_bprintf(&bp, "%s{\"index\":%d,\"filter_time\":%"PRId64",\"queued_frames\":%d}",
+                   i ? "," : "", i, fg->filter_time, queued);
+    }
+
+    av_bprintf(&bp, "],\"outputs\":[");
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        int queued = ost->muxing_queue ? av_fifo_size(ost->muxing_queue) / sizeof(AVPacket) : 0;
+
+        av_bprintf(&bp, "%s{\"file\":%d,\"index\":%d,\"type\":\"%s\",\"frames_encoded\":%"PRIu64
+                   ",\"packets_encoded\":%"PRIu64",\"packets_written\":%"PRIu64
+                   ",\"encode_time\":%"PRId64",\"mux_time\":%"PRId64
+                   ",\"encoder_frames_in_flight\":%"PRId64",\"queued_packets\":%d,",
+                   i ? "," : "", ost->file_index, ost->index,
+                   av_get_media_type_string(ost->st->codecpar->codec_type),
+                   ost->frames_encoded, ost->packets_encoded, ost->packets_written,
+                   ost->encode_time, ost->mux_time,
+                   ost->encoding_needed ? FFMAX((int64_t)(ost->frames_encoded - ost->packets_encoded), 0) : 0,
+                   queued);
+        telemetry_print_latency(&bp, ost);
+        av_bprintf(&bp, "}");
+    }
+    av_bprintf(&bp, "]}\n");
+
+    if (av_bprint_is_complete(&bp)) {
+        avio_write(telemetry_avio, bp.str, bp.len);
+        avio_flush(telemetry_avio);
+    }
+    av_bprint_finalize(&bp, NULL);
+
+    if (is_last_report) {
+        int ret;
+        if ((ret = avio_closep(&telemetry_avio)) < 0)
+            av_log(NULL, AV_LOG_ERROR,
+                   "Error closing telemetry log, loss of information possible: %s\n", av_err2str(ret));
+    }
+}
+
 /*
  * The following code is the main loop of the file converter
  */
@@ -4697,6 +4892,7 @@ static int transcode(void)
 
         /* dump report by using the output first video and audio streams */
         print_report(0, timer_start, cur_time);
+        write_telemetry(0, timer_start, cur_time);
     }
 #if HAVE_THREADS
     free_input_threads();
@@ -4732,6 +4928,7 @@ static int transcode(void)
 
     /* dump report by using the first video and audio streams */
     print_report(1, timer_start, av_gettime_relative());
+    write_telemetry(1, timer_start, av_gettime_relative());
 
     /* close each encoder */
     for (i = 0; i < nb_output_streams; i++) {
@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
@@ -119,6 +120,7 @@ typedef struct OptionsContext {
     int loop;
     int rate_emu;
     int accurate_seek;
+    int skip_nonkey_demux;
     int thread_queue_size;
 
     SpecifierOpt *ts_scale;
@@ -290,6 +292,9 @@ typedef struct FilterGraph {
     int          nb_inputs;
     OutputFilter **outputs;
     int         nb_outputs;
+
+    /* telemetry: time spent feeding and draining the graph, in microseconds */
+    int64_t filter_time;
 } FilterGraph;
 
 typedef struct InputStream {
@@ -388,6 +393,9 @@ typedef struct InputStream {
     int nb_dts_buffer;
 
     int got_output;
+
+    /* telemetry: time spent decoding, in microseconds */
+    int64_t decode_time;
 } InputStream;
 
 typedef struct InputFile {
@@ -419,6 +427,10 @@ typedef struct InputFile {
     int joined;                 /* the thread has been joined */
     int thread_queue_size;      /* maximum number of queued packets */
 #endif
+
+    /* telemetry: time spent reading packets, in microseconds; updated by the
+     * input thread when there is one */
+    atomic_int_least64_t demux_time;
 } InputFile;
 
 enum forced_keyframes_const {
@@ -535,6 +547,15 @@ typedef struct OutputStream {
     // number of frames/samples sent to the encoder
     uint64_t frames_encoded;
     uint64_t samples_encoded;
+    // number of packets received from the encoder
+    uint64_t packets_encoded;
+
+    /* telemetry: time spent encoding and muxing, in microseconds */
+    int64_t encode_time;
+    int64_t mux_time;
+    /* demuxer to encoder input latencies collected since the last report */
+    int64_t *latency;
+    int nb_latency;
 
     /* packet quality factor */
     int quality;
@@ -604,11 +625,14 @@ extern int qp_hist;
 extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
 extern AVIOContext *progress_avio;
+extern AVIOContext *telemetry_avio;
+extern float telemetry_period;
 extern float max_error_rate;
 extern char *videotoolbox_pixfmt;
 
 extern int filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern int filter_stats;
 extern int vstats_version;
 
 extern const AVIOInterruptCB int_cb;
@@ -639,6 +663,7 @@ enum AVPixelFormat choose_pixel_fmt(AVStream *st, AVCodecContext *avctx, AVCodec
 void choose_sample_fmt(AVStream *st, AVCodec *codec);
 
 int configure_filtergraph(FilterGraph *fg);
+void print_filtergraph_stats(FilterGraph *fg);
 int configure_output_filter(FilterGraph *fg, OutputFilter *ofilter, AVFilterInOut *out);
 void check_filter_outputs(void);
 int ist_in_filtergraph(FilterGraph *fg, InputStream *ist);
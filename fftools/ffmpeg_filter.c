@@ -992,9 +992,33 @@ static int configure_input_filter(FilterGraph *fg, InputFilter *ifilter,
     }
 }
 
+void print_filtergraph_stats(FilterGraph *fg)
+{
+    AVFilterStats *stats;
+    int i, nb_stats;
+
+    if (!filter_stats || !fg->graph)
+        return;
+    nb_stats = avfilter_graph_get_stats(fg->graph, &stats);
+    if (nb_stats < 0)
+        return;
+
+    av_log(NULL, AV_LOG_INFO, "Filtergraph #%d statistics:\n", fg->index);
+    for (i = 0; i < nb_stats; i++) {
+        const AVFilterStats *st = &stats[i];
+        av_log(NULL, AV_LOG_INFO, "  %-32s activations:%-8"PRId64" wall:%10.3fms cpu:%10.3fms "
+               "frames in:%-7"PRId64" out:%-7"PRId64" buffers:%-7"PRId64" max queued:%"PRId64"\n",
+               st->filter->name, st->nb_activations, st->wall_time / 1000000.0,
+               st->cpu_time / 1000000.0, st->frames_in, st->frames_out,
+               st->nb_buffers, st->max_queued);
+    }
+    av_free(stats);
+}
+
 static void cleanup_filtergraph(FilterGraph *fg)
 {
     int i;
+    print_filtergraph_stats(fg);
     for (i = 0; i < fg->nb_outputs; i++)
         fg->outputs[i]->filter = (AVFilterContext *)NULL;
     for (i = 0; i < fg->nb_inputs; i++)
@@ -1053,6 +1077,9 @@ int configure_filtergraph(FilterGraph *fg)
         fg->graph->nb_threads = filter_complex_nbthreads;
     }
 
+    if (filter_stats)
+        av_opt_set_int(fg->graph, "stats", 1, 0);
+
     if ((ret = avfilter_graph_parse2(fg->graph, graph_desc, &inputs, &outputs)) < 0)
         goto fail;
 
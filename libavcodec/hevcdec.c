@@ -3493,6 +3493,17 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
     else
         s->threads_number = 1;
 
+#if HAVE_THREADS
+    if (avctx->active_thread_type & FF_THREAD_FRAME && s->wpp_threads > 1) {
+        ret = ff_slice_thread_init_nested(avctx, s->wpp_threads);
+        if (ret < 0) {
+            hevc_decode_free(avctx);
+            return ret;
+        }
+        s->threads_number = ret;
+    }
+#endif
+
     if (avctx->extradata_size > 0 && avctx->extradata) {
         ret = hevc_decode_extradata(s, avctx->extradata, avctx->extradata_size, 1);
         if (ret < 0) {
@@ -3513,14 +3524,23 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
 static av_cold int hevc_init_thread_copy(AVCodecContext *avctx)
 {
     HEVCContext *s = avctx->priv_data;
+    int wpp_threads = s->wpp_threads;
     int ret;
 
     memset(s, 0, sizeof(*s));
+    s->wpp_threads = wpp_threads;
 
     ret = hevc_init_context(avctx);
     if (ret < 0)
         return ret;
 
+    if (wpp_threads > 1) {
+        ret = ff_slice_thread_init_nested(avctx, wpp_threads);
+        if (ret < 0)
+            return ret;
+        s->threads_number = ret;
+    }
+
     return 0;
 }
 #endif
@@ -3541,6 +3561,8 @@ static const AVOption options[] = {
         AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
     { "strict-displaywin", "stricly apply default display window size", OFFSET(apply_defdispwin),
         AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "wpp_threads", "number of wavefront threads per frame thread when frame threading is used", OFFSET(wpp_threads),
+        AV_OPT_TYPE_INT, {.i64 = 0}, 0, MAX_NB_THREADS, PAR },
     { NULL },
 };
 
@@ -162,6 +162,13 @@ typedef struct AVCodecInternal {
 
     void *thread_ctx;
 
+    /**
+     * Slice threading context. Equal to thread_ctx when slice threading is
+     * the active threading mode; set separately on frame thread copies
+     * which run their own slice threads, see ff_slice_thread_init_nested().
+     */
+    void *slice_thread_ctx;
+
     DecodeSimpleContext ds;
     DecodeFilterContext filter;
 
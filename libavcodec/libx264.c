@@ -325,7 +325,9 @@ static int X264_frame(AVCodecContext *ctx, AVPacket *pkt, const AVFrame *frame,
             x4->pic.i_type = X264_TYPE_B;
             break;
         default:
-            x4->pic.i_type = X264_TYPE_AUTO;
+            x4->pic.i_type = av_frame_get_side_data(frame, AV_FRAME_DATA_SCENE_CHANGE) ?
+                             (x4->forced_idr > 0 ? X264_TYPE_IDR : X264_TYPE_KEYFRAME) :
+                             X264_TYPE_AUTO;
             break;
         }
         reconfig_encoder(ctx, frame);
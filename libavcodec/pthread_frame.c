@@ -571,7 +571,10 @@ void ff_thread_report_progress(ThreadFrame *f, int n, int field)
 
     pthread_mutex_lock(&p->progress_mutex);
 
-    atomic_store_explicit(&progress[field], n, memory_order_release);
+    /* Several slice threads of the same frame thread may report concurrently,
+     * never let the progress go backwards. */
+    if (atomic_load_explicit(&progress[field], memory_order_relaxed) < n)
+        atomic_store_explicit(&progress[field], n, memory_order_release);
 
     pthread_cond_broadcast(&p->progress_cond);
     pthread_mutex_unlock(&p->progress_mutex);
@@ -678,6 +681,8 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 
         if (codec->close && p->avctx)
             codec->close(p->avctx);
+        if (p->avctx && p->avctx->internal)
+            ff_slice_thread_free(p->avctx);
 
         release_delayed_buffers(p);
         av_frame_free(&p->frame);
@@ -799,6 +804,9 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         }
         *copy->internal = *src->internal;
         copy->internal->thread_ctx = p;
+        copy->internal->slice_thread_ctx = NULL;
+        copy->execute  = avctx->execute;
+        copy->execute2 = avctx->execute2;
         copy->internal->last_pkt_props = &p->avpkt;
 
         if (!i) {
@@ -136,6 +136,21 @@ int ff_slice_thread_execute_with_mainfunc(AVCodecContext *avctx,
         int (*action_func2)(AVCodecContext *c, void *arg, int jobnr, int threadnr),
         int (*main_func)(AVCodecContext *c), void *arg, int *ret, int job_count);
 void ff_thread_free(AVCodecContext *s);
+
+/**
+ * Start a private pool of slice threads on a frame thread copy, so that
+ * a codec can combine frame threading with slice/wavefront threading.
+ * Must be called from the codec init() or init_thread_copy() callback
+ * of a frame-threaded context. The pool is freed together with the
+ * frame threads.
+ *
+ * @param avctx       the frame thread copy of the codec context
+ * @param thread_count number of slice threads for this frame thread
+ * @return the number of slice threads actually started (1 meaning that
+ *         slice threading is not used), or a negative error code
+ */
+int ff_slice_thread_init_nested(AVCodecContext *avctx, int thread_count);
+
 int ff_alloc_entries(AVCodecContext *avctx, int count);
 void ff_reset_entries(AVCodecContext *avctx);
 void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, int n);
@@ -52,6 +52,12 @@
 #define DURATION_SHORTEST 1
 #define DURATION_FIRST    2
 
+/**
+ * Number of samples per plane mixed at once. All inputs are summed into one
+ * block of the output before moving on to the next one, so the output block
+ * stays in cache however many inputs there are.
+ */
+#define MIX_BLOCK_SIZE 4096
 
 typedef struct FrameInfo {
     int nb_samples;
@@ -173,6 +179,9 @@ typedef struct MixContext {
     float *weights;             /**< custom weights for every input */
     float weight_sum;           /**< sum of custom weights for every input */
     float *scale_norm;          /**< normalization factor for every input */
+    int scales_settled;         /**< input_scale is final until an input state changes */
+    uint8_t **block;            /**< buffer for one block of one input */
+    int block_samples;          /**< number of samples held by block */
     int64_t next_pts;           /**< calculated pts for next output frame */
     FrameList *frame_list;      /**< list of frame info for the first input */
 } MixContext;
@@ -210,6 +219,9 @@ static void calculate_scales(MixContext *s, int nb_samples)
     float weight_sum = 0.f;
     int i;
 
+    if (s->scales_settled)
+        return;
+
     for (i = 0; i < s->nb_inputs; i++)
         if (s->input_state[i] & INPUT_ON)
             weight_sum += s->weights[i];
@@ -224,11 +236,15 @@ static void calculate_scales(MixContext *s, int nb_samples)
         }
     }
 
+    s->scales_settled = 1;
     for (i = 0; i < s->nb_inputs; i++) {
-        if (s->input_state[i] & INPUT_ON)
+        if (s->input_state[i] & INPUT_ON) {
             s->input_scale[i] = 1.0f / s->scale_norm[i];
-        else
+            if (s->scale_norm[i] > weight_sum / s->weights[i])
+                s->scales_settled = 0;
+        } else {
             s->input_scale[i] = 0.0f;
+        }
     }
 }
 
@@ -273,6 +289,14 @@ static int config_output(AVFilterLink *outlink)
         s->scale_norm[i] = s->weight_sum / s->weights[i];
     calculate_scales(s, 0);
 
+    /* keep every block a multiple of 16 elements so it can be passed to the
+     * float DSP functions at any offset inside the frame */
+    s->block_samples = s->planar ? MIX_BLOCK_SIZE :
+                       FFMAX(MIX_BLOCK_SIZE / s->nb_channels & ~15, 16);
+    if (av_samples_alloc_array_and_samples(&s->block, NULL, s->nb_channels,
+                                           s->block_samples, outlink->format, 0) < 0)
+        return AVERROR(ENOMEM);
+
     av_get_channel_layout_string(buf, sizeof(buf), -1, outlink->channel_layout);
 
     av_log(ctx, AV_LOG_VERBOSE,
@@ -289,8 +313,8 @@ static int output_frame(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
-    AVFrame *out_buf, *in_buf;
-    int nb_samples, ns, i;
+    AVFrame *out_buf;
+    int nb_samples, ns, i, offset;
 
     if (s->input_state[0] & INPUT_ON) {
         /* first input live: use the corresponding frame size */
@@ -334,40 +358,36 @@ static int output_frame(AVFilterLink *outlink)
     if (!out_buf)
         return AVERROR(ENOMEM);
 
-    in_buf = ff_get_audio_buffer(outlink, nb_samples);
-    if (!in_buf) {
-        av_frame_free(&out_buf);
-        return AVERROR(ENOMEM);
-    }
+    for (offset = 0; offset < nb_samples; offset += s->block_samples) {
+        const int block_samples = FFMIN(nb_samples - offset, s->block_samples);
+        const int planes        = s->planar ? s->nb_channels : 1;
+        const int stride        = s->planar ? 1 : s->nb_channels;
+        const int plane_size    = FFALIGN(block_samples * stride, 16);
 
-    for (i = 0; i < s->nb_inputs; i++) {
-        if (s->input_state[i] & INPUT_ON) {
-            int planes, plane_size, p;
+        for (i = 0; i < s->nb_inputs; i++) {
+            int p;
 
-            av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
-                               nb_samples);
+            if (!(s->input_state[i] & INPUT_ON))
+                continue;
 
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
+            av_audio_fifo_read(s->fifos[i], (void **)s->block, block_samples);
 
             if (out_buf->format == AV_SAMPLE_FMT_FLT ||
                 out_buf->format == AV_SAMPLE_FMT_FLTP) {
                 for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                                (float *) in_buf->extended_data[p],
+                    s->fdsp->vector_fmac_scalar((float *)out_buf->extended_data[p] + offset * stride,
+                                                (float *)s->block[p],
                                                 s->input_scale[i], plane_size);
                 }
             } else {
                 for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_dmac_scalar((double *)out_buf->extended_data[p],
-                                                (double *) in_buf->extended_data[p],
+                    s->fdsp->vector_dmac_scalar((double *)out_buf->extended_data[p] + offset * stride,
+                                                (double *)s->block[p],
                                                 s->input_scale[i], plane_size);
                 }
             }
         }
     }
-    av_frame_free(&in_buf);
 
     out_buf->pts = s->next_pts;
     if (s->next_pts != AV_NOPTS_VALUE)
@@ -462,6 +482,7 @@ static int activate(AVFilterContext *ctx)
 
         if (ff_inlink_acknowledge_status(ctx->inputs[i], &status, &pts)) {
             if (status == AVERROR_EOF) {
+                s->scales_settled = 0;
                 if (i == 0) {
                     s->input_state[i] = 0;
                     if (s->nb_inputs == 1) {
@@ -566,6 +587,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->input_state);
     av_freep(&s->input_scale);
     av_freep(&s->scale_norm);
+    if (s->block)
+        av_freep(&s->block[0]);
+    av_freep(&s->block);
     av_freep(&s->weights);
     av_freep(&s->fdsp);
 
@@ -21,6 +21,10 @@
 /* http://k.ylo.ph/2016/04/04/loudnorm.html */
 
 #include "libavutil/opt.h"
+#if CONFIG_AVFORMAT && CONFIG_SWRESAMPLE
+#include "libavformat/avformat.h"
+#include "libswresample/swresample.h"
+#endif
 #include "avfilter.h"
 #include "internal.h"
 #include "audio.h"
@@ -62,7 +66,10 @@ typedef struct LoudNormContext {
     int linear;
     int dual_mono;
     enum PrintFormat print_format;
+    int64_t lookahead;
+    char *measure_file;
 
+    int lookahead_size;
     double *buf;
     int buf_size;
     int buf_index;
@@ -119,6 +126,8 @@ static const AVOption loudnorm_options[] = {
     {     "none",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  NONE},     0,         0,  FLAGS, "print_format" },
     {     "json",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  JSON},     0,         0,  FLAGS, "print_format" },
     {     "summary",      0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  SUMMARY},  0,         0,  FLAGS, "print_format" },
+    { "lookahead",        "set the first analysis window",     OFFSET(lookahead),        AV_OPT_TYPE_DURATION, {.i64 = 3000000}, 3000000, 30000000, FLAGS },
+    { "measure_file",     "measure this file before filtering", OFFSET(measure_file),    AV_OPT_TYPE_STRING,  {.str =  NULL},     0,         0,  FLAGS },
     { NULL }
 };
 
@@ -406,7 +415,7 @@ static void true_peak_limiter(LoudNormContext *s, double *out, int nb_samples, i
     }
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+static int process_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
     LoudNormContext *s = ctx->priv;
@@ -442,7 +451,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 
     ff_ebur128_add_frames_double(s->r128_in, src, in->nb_samples);
 
-    if (s->frame_type == FIRST_FRAME && in->nb_samples < frame_size(inlink->sample_rate, 3000)) {
+    if (s->frame_type == FIRST_FRAME && in->nb_samples < s->lookahead_size) {
         double offset, offset_tp, true_peak;
 
         ff_ebur128_loudness_global(s->r128_in, &global);
@@ -638,6 +647,71 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     return ff_filter_frame(outlink, out);
 }
 
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    LoudNormContext *s = ctx->priv;
+    const int first_size = frame_size(inlink->sample_rate, 3000);
+    const int subframe_size = frame_size(inlink->sample_rate, 100);
+    int offset, ret = 0;
+
+    /* A short first frame means the whole input fits in the lookahead
+     * window, which process_frame() normalizes linearly from an exact
+     * measurement. */
+    if (s->frame_type != FIRST_FRAME || in->nb_samples < s->lookahead_size ||
+        s->lookahead_size == first_size)
+        return process_frame(inlink, in);
+
+    /* Otherwise the window serves as a partial first pass: its integrated
+     * loudness and threshold stand in for the measured values unless they
+     * were given. */
+    if (s->measured_i == 0. && s->measured_thresh == -70.) {
+        FFEBUR128State *r128 = ff_ebur128_init(inlink->channels, inlink->sample_rate, 0, FF_EBUR128_MODE_I);
+        double global, relative_threshold;
+
+        if (!r128) {
+            av_frame_free(&in);
+            return AVERROR(ENOMEM);
+        }
+        if (inlink->channels == 1 && s->dual_mono)
+            ff_ebur128_set_channel(r128, 0, FF_EBUR128_DUAL_MONO);
+        ff_ebur128_add_frames_double(r128, (const double *)in->data[0], in->nb_samples);
+        ff_ebur128_loudness_global(r128, &global);
+        ff_ebur128_relative_threshold(r128, &relative_threshold);
+        ff_ebur128_destroy(&r128);
+
+        if (global > -70.) {
+            s->measured_i      = global;
+            s->measured_thresh = relative_threshold;
+            av_log(ctx, AV_LOG_VERBOSE, "Lookahead: I %.2f LUFS, threshold %.2f LUFS\n",
+                   global, relative_threshold);
+        }
+    }
+
+    /* replay the window as the usual 3s frame followed by 100ms frames */
+    s->lookahead_size = first_size;
+    for (offset = 0; offset < in->nb_samples && ret >= 0; ) {
+        const int nb_samples = FFMIN(offset ? subframe_size : first_size, in->nb_samples - offset);
+        AVFrame *frame = ff_get_audio_buffer(ctx->outputs[0], nb_samples);
+
+        if (!frame) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        av_frame_copy_props(frame, in);
+        if (in->pts != AV_NOPTS_VALUE)
+            frame->pts = in->pts + av_rescale_q(offset, (AVRational){ 1, inlink->sample_rate },
+                                                inlink->time_base);
+        memcpy(frame->data[0], in->data[0] + offset * inlink->channels * sizeof(double),
+               nb_samples * inlink->channels * sizeof(double));
+        offset += nb_samples;
+        ret = process_frame(inlink, frame);
+    }
+
+    av_frame_free(&in);
+    return ret;
+}
+
 static int request_frame(AVFilterLink *outlink)
 {
     int ret;
@@ -760,10 +834,14 @@ static int config_input(AVFilterLink *inlink)
 
     init_gaussian_filter(s);
 
+    /* the lookahead is a 3s first frame extended in 100ms steps */
+    s->lookahead_size = frame_size(inlink->sample_rate, 3000) +
+                        (s->lookahead - 3000000) / 100000 * frame_size(inlink->sample_rate, 100);
+
     if (s->frame_type != LINEAR_MODE) {
         inlink->min_samples =
         inlink->max_samples =
-        inlink->partial_buf_size = frame_size(inlink->sample_rate, 3000);
+        inlink->partial_buf_size = s->lookahead_size;
     }
 
     s->pts = AV_NOPTS_VALUE;
@@ -781,17 +859,188 @@ static int config_input(AVFilterLink *inlink)
     return 0;
 }
 
+#if CONFIG_AVFORMAT && CONFIG_SWRESAMPLE
+static int measure_frames(AVCodecContext *dec_ctx, const AVPacket *pkt, AVFrame *frame,
+                          SwrContext *swr, FFEBUR128State *r128,
+                          uint8_t **buf, unsigned *buf_size)
+{
+    int ret = avcodec_send_packet(dec_ctx, pkt);
+
+    while (ret >= 0) {
+        int nb_samples;
+
+        ret = avcodec_receive_frame(dec_ctx, frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            return 0;
+        if (ret < 0)
+            return ret;
+
+        nb_samples = swr_get_out_samples(swr, frame->nb_samples);
+        av_fast_malloc(buf, buf_size, nb_samples * dec_ctx->channels * sizeof(double));
+        if (!*buf) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        ret = swr_convert(swr, buf, nb_samples,
+                          (const uint8_t **)frame->extended_data, frame->nb_samples);
+        av_frame_unref(frame);
+        if (ret > 0)
+            ff_ebur128_add_frames_double(r128, (const double *)*buf, ret);
+    }
+
+    return ret;
+}
+
+/**
+ * Decode the best audio stream of a file and measure it the way the first
+ * pass of a two-pass normalization does, at 192kHz.
+ */
+static int measure_input_file(AVFilterContext *ctx)
+{
+    LoudNormContext *s = ctx->priv;
+    AVFormatContext *fmt_ctx = NULL;
+    AVCodecContext *dec_ctx = NULL;
+    AVCodec *codec = NULL;
+    AVPacket *pkt = NULL;
+    AVFrame *frame = NULL;
+    SwrContext *swr = NULL;
+    FFEBUR128State *r128 = NULL;
+    uint8_t *buf = NULL;
+    unsigned buf_size = 0;
+    int64_t layout;
+    double global, lra, thresh, peak = 0.;
+    int i, ret, stream_index;
+
+    ret = avformat_open_input(&fmt_ctx, s->measure_file, NULL, NULL);
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to open '%s'\n", s->measure_file);
+        return ret;
+    }
+    ret = avformat_find_stream_info(fmt_ctx, NULL);
+    if (ret < 0)
+        goto end;
+    ret = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "No audio stream found in '%s'\n", s->measure_file);
+        goto end;
+    }
+    stream_index = ret;
+    for (i = 0; i < fmt_ctx->nb_streams; i++)
+        fmt_ctx->streams[i]->discard = i == stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    dec_ctx = avcodec_alloc_context3(codec);
+    pkt     = av_packet_alloc();
+    frame   = av_frame_alloc();
+    if (!dec_ctx || !pkt || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avcodec_parameters_to_context(dec_ctx, fmt_ctx->streams[stream_index]->codecpar);
+    if (ret < 0)
+        goto end;
+    ret = avcodec_open2(dec_ctx, codec, NULL);
+    if (ret < 0)
+        goto end;
+
+    layout = dec_ctx->channel_layout ? dec_ctx->channel_layout
+                                     : av_get_default_channel_layout(dec_ctx->channels);
+    swr = swr_alloc_set_opts(NULL, layout, AV_SAMPLE_FMT_DBL, 192000,
+                             layout, dec_ctx->sample_fmt, dec_ctx->sample_rate, 0, ctx);
+    r128 = ff_ebur128_init(dec_ctx->channels, 192000, 0,
+                           FF_EBUR128_MODE_I | FF_EBUR128_MODE_S | FF_EBUR128_MODE_LRA | FF_EBUR128_MODE_SAMPLE_PEAK);
+    if (!swr || !r128) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = swr_init(swr);
+    if (ret < 0)
+        goto end;
+    if (dec_ctx->channels == 1 && s->dual_mono)
+        ff_ebur128_set_channel(r128, 0, FF_EBUR128_DUAL_MONO);
+
+    while ((ret = av_read_frame(fmt_ctx, pkt)) >= 0) {
+        if (pkt->stream_index == stream_index)
+            ret = measure_frames(dec_ctx, pkt, frame, swr, r128, &buf, &buf_size);
+        av_packet_unref(pkt);
+        if (ret < 0)
+            goto end;
+    }
+    if (ret != AVERROR_EOF)
+        goto end;
+
+    /* drain the decoder and the resampler */
+    ret = measure_frames(dec_ctx, NULL, frame, swr, r128, &buf, &buf_size);
+    while (ret >= 0) {
+        const int nb_samples = swr_get_out_samples(swr, 0);
+
+        if (nb_samples <= 0)
+            break;
+        av_fast_malloc(&buf, &buf_size, nb_samples * dec_ctx->channels * sizeof(double));
+        if (!buf) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        ret = swr_convert(swr, &buf, nb_samples, NULL, 0);
+        if (ret <= 0)
+            break;
+        ff_ebur128_add_frames_double(r128, (const double *)buf, ret);
+    }
+    if (ret < 0)
+        goto end;
+
+    ff_ebur128_loudness_global(r128, &global);
+    ff_ebur128_loudness_range(r128, &lra);
+    ff_ebur128_relative_threshold(r128, &thresh);
+    for (i = 0; i < dec_ctx->channels; i++) {
+        double tmp;
+        ff_ebur128_sample_peak(r128, i, &tmp);
+        peak = FFMAX(peak, tmp);
+    }
+
+    s->measured_i      = av_clipd(global, -99., 0.);
+    s->measured_lra    = av_clipd(lra, 0., 99.);
+    s->measured_tp     = av_clipd(20. * log10(peak), -99., 99.);
+    s->measured_thresh = av_clipd(thresh, -99., 0.);
+    av_log(ctx, AV_LOG_VERBOSE, "Measured '%s': I %.2f LUFS, LRA %.2f LU, TP %.2f dBTP, threshold %.2f LUFS\n",
+           s->measure_file, s->measured_i, s->measured_lra, s->measured_tp, s->measured_thresh);
+    ret = 0;
+
+end:
+    if (r128)
+        ff_ebur128_destroy(&r128);
+    swr_free(&swr);
+    av_freep(&buf);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&dec_ctx);
+    avformat_close_input(&fmt_ctx);
+    return ret;
+}
+#endif
+
 static av_cold int init(AVFilterContext *ctx)
 {
     LoudNormContext *s = ctx->priv;
     s->frame_type = FIRST_FRAME;
 
+    if (s->measure_file) {
+#if CONFIG_AVFORMAT && CONFIG_SWRESAMPLE
+        int ret = measure_input_file(ctx);
+        if (ret < 0)
+            return ret;
+#else
+        av_log(ctx, AV_LOG_ERROR, "measure_file requires libavformat and libswresample\n");
+        return AVERROR(ENOSYS);
+#endif
+    }
+
     if (s->linear) {
         double offset, offset_tp;
         offset    = s->target_i - s->measured_i;
         offset_tp = s->measured_tp + offset;
 
-        if (s->measured_tp != 99 && s->measured_thresh != -70 && s->measured_lra != 0 && s->measured_i != 0) {
+        if (s->measure_file ||
+            (s->measured_tp != 99 && s->measured_thresh != -70 && s->measured_lra != 0 && s->measured_i != 0)) {
             if ((offset_tp <= s->target_tp) && (s->measured_lra <= s->target_lra)) {
                 s->frame_type = LINEAR_MODE;
                 s->offset = offset;
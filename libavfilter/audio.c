@@ -23,6 +23,9 @@
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
 
+#define FF_INTERNAL_FIELDS 1
+#include "framequeue.h"
+
 #include "audio.h"
 #include "avfilter.h"
 #include "internal.h"
@@ -73,6 +76,7 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
     frame = ff_frame_pool_get(link->frame_pool);
     if (!frame)
         return NULL;
+    link->nb_pool_frames++;
 
     frame->nb_samples = nb_samples;
     frame->channel_layout = link->channel_layout;
@@ -616,6 +616,16 @@ struct AVFilterLink {
      */
     FFFrameQueue fifo;
 
+    /**
+     * Highest number of frames queued in fifo at once.
+     */
+    size_t max_queued;
+
+    /**
+     * Number of frames allocated from frame_pool.
+     */
+    int64_t nb_pool_frames;
+
     /**
      * If set, the source filter can not generate a frame as is.
      * The goal is to avoid repeatedly calling the request_frame() method on
@@ -907,6 +917,12 @@ typedef struct AVFilterGraph {
     int sink_links_count;
 
     unsigned disable_auto_convert;
+
+    /**
+     * Collect activation counts and times for avfilter_graph_get_stats(),
+     * set through the "stats" option.
+     */
+    int stats;
 } AVFilterGraph;
 
 /**
@@ -1141,6 +1157,50 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
  */
 char *avfilter_graph_dump(AVFilterGraph *graph, const char *options);
 
+/**
+ * Performance statistics of one filter, see avfilter_graph_get_stats().
+ */
+typedef struct AVFilterStats {
+    const AVFilterContext *filter;
+
+    /**
+     * Number of times the filter was activated by the graph scheduler, and
+     * the wall clock and CPU time spent in these activations, in
+     * nanoseconds. Only collected when the graph "stats" option is set.
+     * The CPU time is the one of the thread that activated the filter and
+     * does not include slice threads; it is 0 if not supported.
+     */
+    int64_t nb_activations;
+    int64_t wall_time;
+    int64_t cpu_time;
+
+    /**
+     * Number of frames consumed from all inputs and sent to all outputs.
+     */
+    int64_t frames_in;
+    int64_t frames_out;
+
+    /**
+     * Number of frames allocated from the frame pools of the output links.
+     */
+    int64_t nb_buffers;
+
+    /**
+     * Highest number of frames queued at once on any of the inputs.
+     */
+    int64_t max_queued;
+} AVFilterStats;
+
+/**
+ * Get the performance statistics of all the filters of a graph.
+ *
+ * @param graph  the graph
+ * @param stats  set to an array of graph->nb_filters entries, in the order of
+ *               graph->filters, which must be freed using av_free()
+ * @return  the number of entries, or a negative AVERROR code on failure
+ */
+int avfilter_graph_get_stats(AVFilterGraph *graph, AVFilterStats **stats);
+
 /**
  * Request a frame on the oldest sink link.
  *
@@ -56,6 +56,8 @@ static const AVOption filtergraph_options[] = {
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "stats",       "Collect per filter activation statistics", OFFSET(stats),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V|A },
     { NULL },
 };
 
@@ -99,14 +101,107 @@ AVFilterGraph *avfilter_graph_alloc(void)
     return ret;
 }
 
+static int ready_before(const AVFilterContext *a, const AVFilterContext *b)
+{
+    if (a->ready != b->ready)
+        return a->ready > b->ready;
+    return a->internal->graph_index < b->internal->graph_index;
+}
+
+static void ready_queue_set(AVFilterGraphInternal *gi, unsigned pos,
+                            AVFilterContext *filter)
+{
+    gi->ready_queue[pos] = filter;
+    filter->internal->ready_index = pos;
+}
+
+static void ready_queue_sift(AVFilterGraphInternal *gi, unsigned pos)
+{
+    AVFilterContext *filter = gi->ready_queue[pos];
+
+    while (pos > 0) {
+        unsigned parent = (pos - 1) >> 1;
+        if (!ready_before(filter, gi->ready_queue[parent]))
+            break;
+        ready_queue_set(gi, pos, gi->ready_queue[parent]);
+        pos = parent;
+    }
+    while (2 * pos + 1 < gi->nb_ready) {
+        unsigned child = 2 * pos + 1;
+        if (child + 1 < gi->nb_ready &&
+            ready_before(gi->ready_queue[child + 1], gi->ready_queue[child]))
+            child++;
+        if (!ready_before(gi->ready_queue[child], filter))
+            break;
+        ready_queue_set(gi, pos, gi->ready_queue[child]);
+        pos = child;
+    }
+    ready_queue_set(gi, pos, filter);
+}
+
+static void ready_queue_remove(AVFilterGraphInternal *gi, AVFilterContext *filter)
+{
+    unsigned pos = filter->internal->ready_index;
+
+    filter->internal->ready_index = -1;
+    if (pos < --gi->nb_ready) {
+        ready_queue_set(gi, pos, gi->ready_queue[gi->nb_ready]);
+        ready_queue_sift(gi, pos);
+    }
+}
+
+void ff_filter_graph_update_ready(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+
+    if (filter->internal->ready_index < 0) {
+        if (!filter->ready)
+            return;
+        av_assert1(gi->nb_ready < graph->nb_filters);
+        ready_queue_set(gi, gi->nb_ready++, filter);
+        ready_queue_sift(gi, filter->internal->ready_index);
+    } else if (!filter->ready) {
+        ready_queue_remove(gi, filter);
+    } else {
+        ready_queue_sift(gi, filter->internal->ready_index);
+    }
+}
+
+/**
+ * Number the filters in the order of the filters array and rebuild the
+ * ready queue; the array may have been reordered by the caller.
+ */
+static void graph_init_ready_queue(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    unsigned i;
+
+    gi->nb_ready = 0;
+    for (i = 0; i < graph->nb_filters; i++) {
+        graph->filters[i]->internal->graph_index = i;
+        graph->filters[i]->internal->ready_index = -1;
+    }
+    for (i = 0; i < graph->nb_filters; i++)
+        ff_filter_graph_update_ready(graph, graph->filters[i]);
+}
+
 void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter)
 {
     int i, j;
     for (i = 0; i < graph->nb_filters; i++) {
         if (graph->filters[i] == filter) {
+            AVFilterContext *last = graph->filters[graph->nb_filters - 1];
+
+            if (filter->internal->ready_index >= 0)
+                ready_queue_remove(graph->internal, filter);
             FFSWAP(AVFilterContext*, graph->filters[i],
                    graph->filters[graph->nb_filters - 1]);
             graph->nb_filters--;
+            if (last != filter) {
+                last->internal->graph_index = i;
+                if (last->internal->ready_index >= 0)
+                    ready_queue_sift(graph->internal, last->internal->ready_index);
+            }
             filter->graph = NULL;
             for (j = 0; j<filter->nb_outputs; j++)
                 if (filter->outputs[j])
@@ -135,6 +230,7 @@ void avfilter_graph_free(AVFilterGraph **graph)
     av_freep(&(*graph)->resample_lavr_opts);
 #endif
     av_freep(&(*graph)->filters);
+    av_freep(&(*graph)->internal->ready_queue);
     av_freep(&(*graph)->internal);
     av_freep(graph);
 }
@@ -196,6 +292,16 @@ AVFilterContext *avfilter_graph_alloc_filter(AVFilterGraph *graph,
     }
 
     graph->filters = filters;
+
+    filters = av_realloc_array(graph->internal->ready_queue, graph->nb_filters + 1,
+                               sizeof(*filters));
+    if (!filters) {
+        avfilter_free(s);
+        return NULL;
+    }
+    graph->internal->ready_queue = filters;
+
+    s->internal->graph_index = graph->nb_filters;
     graph->filters[graph->nb_filters++] = s;
 
     s->graph = graph;
@@ -1281,6 +1387,8 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
 
+    graph_init_ready_queue(graphctx);
+
     return 0;
 }
 
@@ -1439,17 +1547,46 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
-int ff_filter_graph_run_once(AVFilterGraph *graph)
+int avfilter_graph_get_stats(AVFilterGraph *graph, AVFilterStats **stats)
 {
-    AVFilterContext *filter;
-    unsigned i;
+    AVFilterStats *st;
+    unsigned i, j;
+
+    st = av_mallocz_array(FFMAX(graph->nb_filters, 1), sizeof(*st));
+    if (!st)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
 
+        st[i].filter         = filter;
+        st[i].nb_activations = filter->internal->nb_activations;
+        st[i].wall_time      = filter->internal->wall_time;
+        st[i].cpu_time       = filter->internal->cpu_time;
+        for (j = 0; j < filter->nb_inputs; j++) {
+            AVFilterLink *link = filter->inputs[j];
+            if (!link)
+                continue;
+            st[i].frames_in += link->frame_count_out;
+            st[i].max_queued = FFMAX(st[i].max_queued, link->max_queued);
+        }
+        for (j = 0; j < filter->nb_outputs; j++) {
+            AVFilterLink *link = filter->outputs[j];
+            if (!link)
+                continue;
+            st[i].frames_out += link->frame_count_in;
+            st[i].nb_buffers += link->nb_pool_frames;
+        }
+    }
+
+    *stats = st;
+    return graph->nb_filters;
+}
+
+int ff_filter_graph_run_once(AVFilterGraph *graph)
+{
     av_assert0(graph->nb_filters);
-    filter = graph->filters[0];
-    for (i = 1; i < graph->nb_filters; i++)
-        if (graph->filters[i]->ready > filter->ready)
-            filter = graph->filters[i];
-    if (!filter->ready)
+    if (!graph->internal->nb_ready)
         return AVERROR(EAGAIN);
-    return ff_filter_activate(filter);
+    return ff_filter_activate(graph->internal->ready_queue[0]);
 }
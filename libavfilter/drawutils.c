@@ -522,9 +522,9 @@ void ff_blend_rectangle(FFDrawContext *draw, FFDrawColor *color,
     }
 }
 
-static void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
-                          const uint8_t *mask, int mask_linesize, int l2depth,
-                          unsigned w, unsigned h, unsigned shift, unsigned xm0)
+static av_always_inline void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
+                                           const uint8_t *mask, int mask_linesize, int l2depth,
+                                           unsigned w, unsigned h, unsigned shift, unsigned xm0)
 {
     unsigned xm, x, y, t = 0;
     unsigned xmshf = 3 - l2depth;
@@ -546,9 +546,9 @@ static void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
     AV_WL16(dst, ((0x10001 - alpha) * value + alpha * src) >> 16);
 }
 
-static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
-                        const uint8_t *mask, int mask_linesize, int l2depth,
-                        unsigned w, unsigned h, unsigned shift, unsigned xm0)
+static av_always_inline void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
+                                         const uint8_t *mask, int mask_linesize, int l2depth,
+                                         unsigned w, unsigned h, unsigned shift, unsigned xm0)
 {
     unsigned xm, x, y, t = 0;
     unsigned xmshf = 3 - l2depth;
@@ -569,11 +569,11 @@ static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
     *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
 }
 
-static void blend_line_hv16(uint8_t *dst, int dst_delta,
-                            unsigned src, unsigned alpha,
-                            const uint8_t *mask, int mask_linesize, int l2depth, int w,
-                            unsigned hsub, unsigned vsub,
-                            int xm, int left, int right, int hband)
+static av_always_inline void blend_line_hv16_c(uint8_t *dst, int dst_delta,
+                                               unsigned src, unsigned alpha,
+                                               const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                                               unsigned hsub, unsigned vsub,
+                                               int xm, int left, int right, int hband)
 {
     int x;
 
@@ -594,11 +594,27 @@ static void blend_line_hv16(uint8_t *dst, int dst_delta,
                       right, hband, hsub + vsub, xm);
 }
 
-static void blend_line_hv(uint8_t *dst, int dst_delta,
-                          unsigned src, unsigned alpha,
-                          const uint8_t *mask, int mask_linesize, int l2depth, int w,
-                          unsigned hsub, unsigned vsub,
-                          int xm, int left, int right, int hband)
+/* 8-bit gray masks are by far the most common (antialiased glyphs),
+   give them a version where the mask unpacking is constant */
+static void blend_line_hv16(uint8_t *dst, int dst_delta,
+                            unsigned src, unsigned alpha,
+                            const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                            unsigned hsub, unsigned vsub,
+                            int xm, int left, int right, int hband)
+{
+    if (l2depth == 3)
+        blend_line_hv16_c(dst, dst_delta, src, alpha, mask, mask_linesize, 3, w,
+                          hsub, vsub, xm, left, right, hband);
+    else
+        blend_line_hv16_c(dst, dst_delta, src, alpha, mask, mask_linesize, l2depth, w,
+                          hsub, vsub, xm, left, right, hband);
+}
+
+static av_always_inline void blend_line_hv_c(uint8_t *dst, int dst_delta,
+                                             unsigned src, unsigned alpha,
+                                             const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                                             unsigned hsub, unsigned vsub,
+                                             int xm, int left, int right, int hband)
 {
     int x;
 
@@ -619,6 +635,20 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
                     right, hband, hsub + vsub, xm);
 }
 
+static void blend_line_hv(uint8_t *dst, int dst_delta,
+                          unsigned src, unsigned alpha,
+                          const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                          unsigned hsub, unsigned vsub,
+                          int xm, int left, int right, int hband)
+{
+    if (l2depth == 3)
+        blend_line_hv_c(dst, dst_delta, src, alpha, mask, mask_linesize, 3, w,
+                        hsub, vsub, xm, left, right, hband);
+    else
+        blend_line_hv_c(dst, dst_delta, src, alpha, mask, mask_linesize, l2depth, w,
+                        hsub, vsub, xm, left, right, hband);
+}
+
 void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                    uint8_t *dst[], int dst_linesize[], int dst_w, int dst_h,
                    const uint8_t *mask,  int mask_linesize, int mask_w, int mask_h,
@@ -124,10 +124,10 @@ typedef struct EBUR128Context {
     int sample_count;               ///< sample count used for refresh frequency, reset at refresh
 
     /* Filter caches.
-     * The mult by 3 in the following is for X[i], X[i-1] and X[i-2] */
-    double x[MAX_CHANNELS * 3];     ///< 3 input samples cache for each channel
-    double y[MAX_CHANNELS * 3];     ///< 3 pre-filter samples cache for each channel
-    double z[MAX_CHANNELS * 3];     ///< 3 RLB-filter samples cache for each channel
+     * The mult by 2 in the following is for X[i-1] and X[i-2] */
+    double x[MAX_CHANNELS * 2];     ///< 2 input samples cache for each channel
+    double y[MAX_CHANNELS * 2];     ///< 2 pre-filter samples cache for each channel
+    double z[MAX_CHANNELS * 2];     ///< 2 RLB-filter samples cache for each channel
 
 #define I400_BINS  (48000 * 4 / 10)
 #define I3000_BINS (48000 * 3)
@@ -585,6 +585,86 @@ static int gate_update(struct integrator *integ, double power,
     return gate_hist_pos;
 }
 
+typedef struct ThreadData {
+    const double *samples;          ///< first sample of the chunk, interleaved
+    int nb_samples;                 ///< chunk length, never crossing a 100ms boundary
+} ThreadData;
+
+/**
+ * K-weight a chunk of samples and update the integrator windows, one
+ * channel at a time. The filter state lives in registers for the whole
+ * chunk, and since channels are independent until the 100ms block
+ * computation, they are spread over the slice threads.
+ */
+static int filter_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    EBUR128Context *ebur128 = ctx->priv;
+    ThreadData *td = arg;
+    const int nb_channels = ebur128->nb_channels;
+    const int nb_samples  = td->nb_samples;
+    const int start = (nb_channels *  jobnr   ) / nb_jobs;
+    const int end   = (nb_channels * (jobnr+1)) / nb_jobs;
+    int ch, i;
+
+    for (ch = start; ch < end; ch++) {
+        const double *src = td->samples + ch;
+        double *cache_400  = ebur128->i400.cache[ch];
+        double *cache_3000 = ebur128->i3000.cache[ch];
+        int bin_id_400  = ebur128->i400.cache_pos;
+        int bin_id_3000 = ebur128->i3000.cache_pos;
+        double sum_400, sum_3000;
+        double x1, x2, y1, y2, z1, z2;
+
+        if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
+            double peak = ebur128->sample_peaks[ch];
+            for (i = 0; i < nb_samples; i++)
+                peak = FFMAX(peak, fabs(src[i * nb_channels]));
+            ebur128->sample_peaks[ch] = peak;
+        }
+
+        if (!ebur128->ch_weighting[ch])
+            continue;
+
+        x1 = ebur128->x[ch * 2];  x2 = ebur128->x[ch * 2 + 1];
+        y1 = ebur128->y[ch * 2];  y2 = ebur128->y[ch * 2 + 1];
+        z1 = ebur128->z[ch * 2];  z2 = ebur128->z[ch * 2 + 1];
+        sum_400  = ebur128->i400.sum [ch];
+        sum_3000 = ebur128->i3000.sum[ch];
+
+        for (i = 0; i < nb_samples; i++) {
+            const double x0 = src[i * nb_channels];
+
+            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
+            const double y0 = x0*PRE_B0 + x1*PRE_B1 + x2*PRE_B2 - y1*PRE_A1 - y2*PRE_A2;
+            const double z0 = y0*RLB_B0 + y1*RLB_B1 + y2*RLB_B2 - z1*RLB_A1 - z2*RLB_A2;
+            const double bin = z0 * z0;
+
+            /* add the new value, and limit the sum to the cache size (400ms or 3s)
+             * by removing the oldest one */
+            sum_400  = sum_400  + bin - cache_400 [bin_id_400];
+            sum_3000 = sum_3000 + bin - cache_3000[bin_id_3000];
+
+            /* override old cache entry with the new value */
+            cache_400 [bin_id_400 ] = bin;
+            cache_3000[bin_id_3000] = bin;
+            if (++bin_id_400  == I400_BINS)  bin_id_400  = 0;
+            if (++bin_id_3000 == I3000_BINS) bin_id_3000 = 0;
+
+            x2 = x1;  x1 = x0;
+            y2 = y1;  y1 = y0;
+            z2 = z1;  z1 = z0;
+        }
+
+        ebur128->x[ch * 2] = x1;  ebur128->x[ch * 2 + 1] = x2;
+        ebur128->y[ch * 2] = y1;  ebur128->y[ch * 2 + 1] = y2;
+        ebur128->z[ch * 2] = z1;  ebur128->z[ch * 2 + 1] = z2;
+        ebur128->i400.sum [ch] = sum_400;
+        ebur128->i3000.sum[ch] = sum_3000;
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
 {
     int i, ch, idx_insample;
@@ -615,69 +695,41 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
     }
 #endif
 
-    for (idx_insample = 0; idx_insample < nb_samples; idx_insample++) {
-        const int bin_id_400  = ebur128->i400.cache_pos;
-        const int bin_id_3000 = ebur128->i3000.cache_pos;
-
-#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
-    ebur128->i##time.cache_pos++;                           \
-    if (ebur128->i##time.cache_pos == I##time##_BINS) {     \
-        ebur128->i##time.filled    = 1;                     \
-        ebur128->i##time.cache_pos = 0;                     \
-    }                                                       \
-} while (0)
-
-        MOVE_TO_NEXT_CACHED_ENTRY(400);
-        MOVE_TO_NEXT_CACHED_ENTRY(3000);
-
-        for (ch = 0; ch < nb_channels; ch++) {
-            double bin;
-
-            if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS)
-                ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch], fabs(*samples));
-
-            ebur128->x[ch * 3] = *samples++; // set X[i]
+    for (idx_insample = 0; idx_insample < nb_samples; ) {
+        ThreadData td;
 
-            if (!ebur128->ch_weighting[ch])
-                continue;
+        /* process up to the next 100ms boundary */
+        td.samples    = samples + idx_insample * nb_channels;
+        td.nb_samples = FFMIN(nb_samples - idx_insample, 4800 - ebur128->sample_count);
+        /* short chunks are not worth waking up the threads for */
+        if (td.nb_samples >= 1024 && nb_channels > 1)
+            ctx->internal->execute(ctx, filter_channels, &td, NULL,
+                                   FFMIN(nb_channels, ff_filter_get_nb_threads(ctx)));
+        else
+            filter_channels(ctx, &td, 0, 1);
 
-            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
-#define FILTER(Y, X, name) do {                                                 \
-            double *dst = ebur128->Y + ch*3;                                    \
-            double *src = ebur128->X + ch*3;                                    \
-            dst[2] = dst[1];                                                    \
-            dst[1] = dst[0];                                                    \
-            dst[0] = src[0]*name##_B0 + src[1]*name##_B1 + src[2]*name##_B2     \
-                                      - dst[1]*name##_A1 - dst[2]*name##_A2;    \
+#define MOVE_TO_NEXT_CACHED_ENTRIES(time, n) do {           \
+    ebur128->i##time.cache_pos += n;                        \
+    if (ebur128->i##time.cache_pos >= I##time##_BINS) {     \
+        ebur128->i##time.filled     = 1;                    \
+        ebur128->i##time.cache_pos -= I##time##_BINS;       \
+    }                                                       \
 } while (0)
 
-            // TODO: merge both filters in one?
-            FILTER(y, x, PRE);  // apply pre-filter
-            ebur128->x[ch * 3 + 2] = ebur128->x[ch * 3 + 1];
-            ebur128->x[ch * 3 + 1] = ebur128->x[ch * 3    ];
-            FILTER(z, y, RLB);  // apply RLB-filter
-
-            bin = ebur128->z[ch * 3] * ebur128->z[ch * 3];
-
-            /* add the new value, and limit the sum to the cache size (400ms or 3s)
-             * by removing the oldest one */
-            ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
-            ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
-
-            /* override old cache entry with the new value */
-            ebur128->i400.cache [ch][bin_id_400 ] = bin;
-            ebur128->i3000.cache[ch][bin_id_3000] = bin;
-        }
+        MOVE_TO_NEXT_CACHED_ENTRIES(400,  td.nb_samples);
+        MOVE_TO_NEXT_CACHED_ENTRIES(3000, td.nb_samples);
+        idx_insample          += td.nb_samples;
+        ebur128->sample_count += td.nb_samples;
 
         /* For integrated loudness, gating blocks are 400ms long with 75%
          * overlap (see BS.1770-2 p5), so a re-computation is needed each 100ms
          * (4800 samples at 48kHz). */
-        if (++ebur128->sample_count == 4800) {
+        if (ebur128->sample_count == 4800) {
             double loudness_400, loudness_3000;
             double power_400 = 1e-12, power_3000 = 1e-12;
             AVFilterLink *outlink = ctx->outputs[0];
             const int64_t pts = insamples->pts +
-                av_rescale_q(idx_insample, (AVRational){ 1, inlink->sample_rate },
+                av_rescale_q(idx_insample - 1, (AVRational){ 1, inlink->sample_rate },
                              outlink->time_base);
 
             ebur128->sample_count = 0;
@@ -1015,5 +1067,5 @@ AVFilter ff_af_ebur128 = {
     .inputs        = ebur128_inputs,
     .outputs       = NULL,
     .priv_class    = &ebur128_class,
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
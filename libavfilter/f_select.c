@@ -83,6 +83,8 @@ static const char *const var_names[] = {
     "pos",               ///< original position in the file of the frame
 
     "scene",
+    "scene_hist",        ///< luma histogram difference to the previous frame (thumbnail scene mode only)
+    "scene_cut",         ///< 1 if the frame passed the adaptive scene cut threshold, 0 otherwise
 
     "concatdec_select",  ///< frame is within the interval set by the concat demuxer
 
@@ -135,6 +137,8 @@ enum var_name {
     VAR_POS,
 
     VAR_SCENE,
+    VAR_SCENE_HIST,
+    VAR_SCENE_CUT,
 
     VAR_CONCATDEC_SELECT,
 
@@ -154,20 +158,36 @@ typedef struct SelectContext {
     ff_scene_sad_fn sad;            ///< Sum of the absolute difference function (scene detect only)
     double prev_mafd;               ///< previous MAFD                           (scene detect only)
     AVFrame *prev_picref;           ///< previous frame                          (scene detect only)
+    int scene_mode;                 ///< SceneMode
+    int scene_window;               ///< number of past scores the adaptive threshold is built from
+    double scene_factor;            ///< standard deviations above the mean a cut must reach
+    double scene_threshold;         ///< lower bound of the adaptive threshold
+    int scene_sidedata;             ///< attach AV_FRAME_DATA_SCENE_CHANGE to detected cuts
+    ff_scene_box_fn box;            ///< thumbnail downsampling function    (thumbnail scene mode only)
+    int thumb_w, thumb_h;           ///< thumbnail dimensions               (thumbnail scene mode only)
+    uint8_t *thumb[2];              ///< current and previous thumbnail     (thumbnail scene mode only)
+    unsigned hist[2][64];           ///< current and previous histogram     (thumbnail scene mode only)
+    int has_prev_thumb;
+    double *scores;                 ///< ring buffer of the last scene_window decision values
+    int nb_scores;
+    int score_pos;
     double select;
     int select_out;                 ///< mark the selected output pad index
     int nb_outputs;
 } SelectContext;
 
+enum SceneMode {
+    SCENE_MODE_FULL,
+    SCENE_MODE_THUMB,
+    SCENE_MODE_NB
+};
+
 #define OFFSET(x) offsetof(SelectContext, x)
-#define DEFINE_OPTIONS(filt_name, FLAGS)                            \
-static const AVOption filt_name##_options[] = {                     \
+#define COMMON_OPTIONS(FLAGS)                                       \
     { "expr", "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "e",    "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "outputs", "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
-    { "n",       "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
-    { NULL }                                                            \
-}
+    { "n",       "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS },
 
 static int request_frame(AVFilterLink *outlink);
 
@@ -182,7 +202,13 @@ static av_cold int init(AVFilterContext *ctx)
                select->expr_str);
         return ret;
     }
-    select->do_scene_detect = !!strstr(select->expr_str, "scene");
+    select->do_scene_detect = !!strstr(select->expr_str, "scene") || select->scene_sidedata;
+
+    if (select->do_scene_detect && select->scene_window) {
+        select->scores = av_malloc_array(select->scene_window, sizeof(*select->scores));
+        if (!select->scores)
+            return AVERROR(ENOMEM);
+    }
 
     for (i = 0; i < select->nb_outputs; i++) {
         AVFilterPad pad = { 0 };
@@ -256,6 +282,8 @@ static int config_input(AVFilterLink *inlink)
     select->var_values[VAR_PICT_TYPE]         = NAN;
     select->var_values[VAR_INTERLACE_TYPE]    = NAN;
     select->var_values[VAR_SCENE]             = NAN;
+    select->var_values[VAR_SCENE_HIST]        = NAN;
+    select->var_values[VAR_SCENE_CUT]         = NAN;
     select->var_values[VAR_CONSUMED_SAMPLES_N] = NAN;
     select->var_values[VAR_SAMPLES_N]          = NAN;
 
@@ -266,10 +294,108 @@ static int config_input(AVFilterLink *inlink)
         select->sad = ff_scene_sad_get_fn(select->bitdepth == 8 ? 8 : 16);
         if (!select->sad)
             return AVERROR(EINVAL);
+
+        if (select->scene_mode == SCENE_MODE_THUMB &&
+            (inlink->w < 8 || inlink->h < 8)) {
+            av_log(inlink->dst, AV_LOG_WARNING,
+                   "Input too small for a thumbnail, using full scene mode\n");
+            select->scene_mode = SCENE_MODE_FULL;
+        }
+        if (select->scene_mode == SCENE_MODE_THUMB) {
+            select->box = ff_scene_box_get_fn(select->bitdepth == 8 ? 8 : 16);
+            select->sad = ff_scene_sad_get_fn(8);
+            if (!select->box || !select->sad)
+                return AVERROR(EINVAL);
+            select->thumb_w = select->width[0] / 8;
+            select->thumb_h = select->height[0] / 8;
+            av_freep(&select->thumb[0]);
+            av_freep(&select->thumb[1]);
+            select->thumb[0] = av_malloc_array(select->thumb_h, select->thumb_w);
+            select->thumb[1] = av_malloc_array(select->thumb_h, select->thumb_w);
+            if (!select->thumb[0] || !select->thumb[1])
+                return AVERROR(ENOMEM);
+            select->has_prev_thumb = 0;
+        }
     }
     return 0;
 }
 
+static double get_thumb_score(AVFilterContext *ctx, AVFrame *frame)
+{
+    SelectContext *select = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    const int tw = select->thumb_w, th = select->thumb_h;
+    uint8_t *thumb = select->thumb[0];
+    unsigned *hist = select->hist[0];
+    double ret = 0;
+    int x, y;
+
+    if (frame->width != inlink->w || frame->height != inlink->h) {
+        select->has_prev_thumb = 0;
+        return 0;
+    }
+
+    for (y = 0; y < th; y++)
+        select->box(thumb + y * tw, frame->data[0] + 8 * y * frame->linesize[0],
+                    frame->linesize[0], tw, select->bitdepth - 8);
+
+    memset(hist, 0, sizeof(select->hist[0]));
+    for (x = 0; x < tw * th; x++)
+        hist[thumb[x] >> 2]++;
+
+    if (select->has_prev_thumb) {
+        uint64_t sad, hist_diff = 0;
+        double mafd, diff;
+
+        select->sad(select->thumb[1], tw, thumb, tw, tw, th, &sad);
+        emms_c();
+        for (x = 0; x < FF_ARRAY_ELEMS(select->hist[0]); x++)
+            hist_diff += FFABS((int)hist[x] - (int)select->hist[1][x]);
+
+        mafd = (double)sad / (tw * th);
+        diff = fabs(mafd - select->prev_mafd);
+        ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
+        select->prev_mafd = mafd;
+        select->var_values[VAR_SCENE_HIST] = hist_diff / (2. * tw * th);
+    }
+
+    FFSWAP(uint8_t *, select->thumb[0], select->thumb[1]);
+    memcpy(select->hist[1], hist, sizeof(select->hist[0]));
+    select->has_prev_thumb = 1;
+    return ret;
+}
+
+/**
+ * Compare the scene score against the mean plus scene_factor standard
+ * deviations of the previous scene_window scores, and against the fixed
+ * scene_threshold floor.
+ */
+static int detect_scene_cut(SelectContext *select, double score)
+{
+    double thresh = select->scene_threshold;
+    int i, cut;
+
+    if (select->nb_scores) {
+        double sum = 0, sum2 = 0, mean;
+
+        for (i = 0; i < select->nb_scores; i++) {
+            sum  += select->scores[i];
+            sum2 += select->scores[i] * select->scores[i];
+        }
+        mean   = sum / select->nb_scores;
+        thresh = FFMAX(thresh, mean + select->scene_factor *
+                       sqrt(FFMAX(sum2 / select->nb_scores - mean * mean, 0)));
+    }
+    cut = score > thresh;
+
+    if (select->scene_window) {
+        select->scores[select->score_pos] = score;
+        select->score_pos = (select->score_pos + 1) % select->scene_window;
+        select->nb_scores = FFMIN(select->nb_scores + 1, select->scene_window);
+    }
+    return cut;
+}
+
 static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
 {
     double ret = 0;
@@ -358,10 +484,34 @@ static void select_frame(AVFilterContext *ctx, AVFrame *frame)
         select->var_values[VAR_PICT_TYPE] = frame->pict_type;
         if (select->do_scene_detect) {
             char buf[32];
-            select->var_values[VAR_SCENE] = get_scene_score(ctx, frame);
+            double score;
+
+            if (select->scene_mode == SCENE_MODE_THUMB) {
+                select->var_values[VAR_SCENE] = get_thumb_score(ctx, frame);
+                /* weigh down motion which keeps the overall histogram */
+                score = isnan(select->var_values[VAR_SCENE_HIST]) ? 0 :
+                        sqrt(select->var_values[VAR_SCENE] * select->var_values[VAR_SCENE_HIST]);
+            } else {
+                score = select->var_values[VAR_SCENE] = get_scene_score(ctx, frame);
+            }
+            select->var_values[VAR_SCENE_CUT] = detect_scene_cut(select, score);
+
             // TODO: document metadata
             snprintf(buf, sizeof(buf), "%f", select->var_values[VAR_SCENE]);
             av_dict_set(&frame->metadata, "lavfi.scene_score", buf, 0);
+            if (select->scene_mode == SCENE_MODE_THUMB && !isnan(select->var_values[VAR_SCENE_HIST])) {
+                snprintf(buf, sizeof(buf), "%f", select->var_values[VAR_SCENE_HIST]);
+                av_dict_set(&frame->metadata, "lavfi.scene_hist", buf, 0);
+            }
+            if (select->var_values[VAR_SCENE_CUT]) {
+                av_dict_set(&frame->metadata, "lavfi.scene_cut", "1", 0);
+                if (select->scene_sidedata) {
+                    AVFrameSideData *sd = av_frame_new_side_data(frame, AV_FRAME_DATA_SCENE_CHANGE,
+                                                                 sizeof(double));
+                    if (sd)
+                        memcpy(sd->data, &score, sizeof(score));
+                }
+            }
         }
         break;
     }
@@ -376,11 +526,12 @@ static void select_frame(AVFilterContext *ctx, AVFrame *frame)
 
     switch (inlink->type) {
     case AVMEDIA_TYPE_VIDEO:
-        av_log(inlink->dst, AV_LOG_DEBUG, " interlace_type:%c pict_type:%c scene:%f",
+        av_log(inlink->dst, AV_LOG_DEBUG, " interlace_type:%c pict_type:%c scene:%f scene_cut:%f",
                (!frame->interlaced_frame) ? 'P' :
                frame->top_field_first     ? 'T' : 'B',
                av_get_picture_type_char(frame->pict_type),
-               select->var_values[VAR_SCENE]);
+               select->var_values[VAR_SCENE],
+               select->var_values[VAR_SCENE_CUT]);
         break;
     case AVMEDIA_TYPE_AUDIO:
         av_log(inlink->dst, AV_LOG_DEBUG, " samples_n:%d consumed_samples_n:%f",
@@ -445,12 +596,18 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     if (select->do_scene_detect) {
         av_frame_free(&select->prev_picref);
+        av_freep(&select->thumb[0]);
+        av_freep(&select->thumb[1]);
+        av_freep(&select->scores);
     }
 }
 
 #if CONFIG_ASELECT_FILTER
 
-DEFINE_OPTIONS(aselect, AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
+static const AVOption aselect_options[] = {
+    COMMON_OPTIONS(AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM)
+    { NULL }
+};
 AVFILTER_DEFINE_CLASS(aselect);
 
 static av_cold int aselect_init(AVFilterContext *ctx)
@@ -520,7 +677,19 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
-DEFINE_OPTIONS(select, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+static const AVOption select_options[] = {
+    COMMON_OPTIONS(FLAGS)
+    { "scene_mode", "set how the scene score is computed", OFFSET(scene_mode), AV_OPT_TYPE_INT, {.i64 = SCENE_MODE_FULL}, 0, SCENE_MODE_NB-1, FLAGS, "scene_mode" },
+        { "full",  "compare all samples of the frames",          0, AV_OPT_TYPE_CONST, {.i64 = SCENE_MODE_FULL},  0, 0, FLAGS, "scene_mode" },
+        { "thumb", "compare thumbnails of the first plane",      0, AV_OPT_TYPE_CONST, {.i64 = SCENE_MODE_THUMB}, 0, 0, FLAGS, "scene_mode" },
+    { "scene_window",    "set the number of past scores for the adaptive cut threshold", OFFSET(scene_window), AV_OPT_TYPE_INT, {.i64 = 25}, 0, 1000, FLAGS },
+    { "scene_factor",    "set the standard deviations above the mean score for a cut", OFFSET(scene_factor), AV_OPT_TYPE_DOUBLE, {.dbl = 3}, 0, 100, FLAGS },
+    { "scene_threshold", "set the minimum score for a cut", OFFSET(scene_threshold), AV_OPT_TYPE_DOUBLE, {.dbl = 0.3}, 0, 1, FLAGS },
+    { "scene_sidedata",  "attach scene change side data to cut frames", OFFSET(scene_sidedata), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, FLAGS },
+    { NULL }
+};
+
 AVFILTER_DEFINE_CLASS(select);
 
 static av_cold int select_init(AVFilterContext *ctx)
@@ -41,6 +41,7 @@ typedef struct FrameRateContext {
     double scene_score;                 ///< score that denotes a scene change has happened
     int interp_start;                   ///< start of range to apply linear interpolation
     int interp_end;                     ///< end of range to apply linear interpolation
+    int exact_cadence;                  ///< decimate without blending on integer rate ratios
 
     int line_size[4];                   ///< bytes of pixel data per line for each plane
     int vsub;
@@ -64,6 +65,7 @@ typedef struct FrameRateContext {
     int flush;                          ///< 1 if the filter is being flushed
     int64_t start_pts;                  ///< pts of the first output frame
     int64_t n;                          ///< output frame counter
+    int cadence;                        ///< input frames per output frame, 0 if not an integer
 
     blend_func blend;
 } FrameRateContext;
@@ -149,10 +149,36 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Binary heap of the filters with a non-zero ready value, highest ready
+     * first, then lowest graph_index first.
+     */
+    AVFilterContext **ready_queue;
+    unsigned nb_ready;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+
+    /**
+     * Position of the filter in the graph filters array, used to break ties
+     * between filters with the same ready value.
+     */
+    unsigned graph_index;
+
+    /**
+     * Position of the filter in the graph ready queue, -1 if not queued.
+     */
+    int ready_index;
+
+    /**
+     * Statistics collected when the graph "stats" option is set, see
+     * AVFilterStats.
+     */
+    int64_t nb_activations;
+    int64_t wall_time;
+    int64_t cpu_time;
 };
 
 /**
@@ -378,6 +404,12 @@ int ff_filter_activate(AVFilterContext *filter);
  */
 void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter);
 
+/**
+ * Update the ready queue of a graph after the ready field of one of its
+ * filters changed.
+ */
+void ff_filter_graph_update_ready(AVFilterGraph *graph, AVFilterContext *filter);
+
 /**
  * The filter is aware of hardware frames, and any hardware frame context
  * should not be automatically propagated through it.
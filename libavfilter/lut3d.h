@@ -0,0 +1,55 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_LUT3D_H
+#define AVFILTER_LUT3D_H
+
+#include <stdint.h>
+
+enum interp_mode {
+    INTERPOLATE_NEAREST,
+    INTERPOLATE_TRILINEAR,
+    INTERPOLATE_TETRAHEDRAL,
+    NB_INTERP_MODE
+};
+
+/* fractional bits of the lattice position in the input scale factors */
+#define LUT3D_POS_BITS  24
+/* fractional bits of the interpolation weights */
+#define LUT3D_FRAC_BITS 15
+
+typedef struct LUT3DDSPContext {
+    /**
+     * Interpolate one row of planar 9 to 12 bit RGB in fixed point.
+     *
+     * @param lut     lutsize^3 entries of interleaved r, g, b values, b
+     *                varying fastest, scaled to the full 16 bit range of
+     *                the output depth (value << (16 - depth))
+     * @param scale   per component factor mapping an input sample to its
+     *                lattice position with LUT3D_POS_BITS fractional bits
+     */
+    void (*interp_fixed[NB_INTERP_MODE])(uint16_t *dstr, uint16_t *dstg, uint16_t *dstb,
+                                         const uint16_t *srcr, const uint16_t *srcg,
+                                         const uint16_t *srcb, int width,
+                                         const uint16_t *lut, int lutsize,
+                                         const uint32_t scale[3], int depth);
+} LUT3DDSPContext;
+
+void ff_lut3d_dsp_init(LUT3DDSPContext *dsp);
+
+#endif /* AVFILTER_LUT3D_H */
@@ -0,0 +1,174 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "qcdetect.h"
+
+static unsigned count_black8_c(const uint8_t *src, ptrdiff_t width, unsigned threshold)
+{
+    unsigned count = 0;
+    int x;
+
+    for (x = 0; x < width; x++)
+        count += src[x] <= threshold;
+    return count;
+}
+
+static unsigned count_black16_c(const uint8_t *src8, ptrdiff_t width, unsigned threshold)
+{
+    const uint16_t *src = (const uint16_t *)src8;
+    unsigned count = 0;
+    int x;
+
+    for (x = 0; x < width; x++)
+        count += src[x] <= threshold;
+    return count;
+}
+
+static uint32_t row_sum8_c(const uint8_t *src, ptrdiff_t width)
+{
+    uint32_t sum = 0;
+    int x;
+
+    for (x = 0; x < width; x++)
+        sum += src[x];
+    return sum;
+}
+
+static uint32_t row_sum16_c(const uint8_t *src8, ptrdiff_t width)
+{
+    const uint16_t *src = (const uint16_t *)src8;
+    uint32_t sum = 0;
+    int x;
+
+    for (x = 0; x < width; x++)
+        sum += src[x];
+    return sum;
+}
+
+#define DEFINE_RGB(bpp)                                                       \
+static uint32_t row_sum_rgb##bpp##_c(const uint8_t *src, ptrdiff_t width)     \
+{                                                                             \
+    uint32_t sum = 0;                                                         \
+    int x;                                                                    \
+                                                                              \
+    for (x = 0; x < width; x++)                                               \
+        sum += src[bpp * x] + src[bpp * x + 1] + src[bpp * x + 2];            \
+    return sum;                                                               \
+}                                                                             \
+                                                                              \
+static void col_sum_rgb##bpp##_c(uint32_t *sum, const uint8_t *src,           \
+                                 ptrdiff_t width)                             \
+{                                                                             \
+    int x;                                                                    \
+                                                                              \
+    for (x = 0; x < width; x++)                                               \
+        sum[x] += src[bpp * x] + src[bpp * x + 1] + src[bpp * x + 2];         \
+}
+
+DEFINE_RGB(3)
+DEFINE_RGB(4)
+
+static void col_sum8_c(uint32_t *sum, const uint8_t *src, ptrdiff_t width)
+{
+    int x;
+
+    for (x = 0; x < width; x++)
+        sum[x] += src[x];
+}
+
+static void col_sum16_c(uint32_t *sum, const uint8_t *src8, ptrdiff_t width)
+{
+    const uint16_t *src = (const uint16_t *)src8;
+    int x;
+
+    for (x = 0; x < width; x++)
+        sum[x] += src[x];
+}
+
+av_cold void ff_qcdetect_init(QCDetectDSPContext *dsp, int bpp)
+{
+    switch (bpp) {
+    case 1:
+        dsp->count_black = count_black8_c;
+        dsp->row_sum     = row_sum8_c;
+        dsp->col_sum     = col_sum8_c;
+        break;
+    case 2:
+        dsp->count_black = count_black16_c;
+        dsp->row_sum     = row_sum16_c;
+        dsp->col_sum     = col_sum16_c;
+        break;
+    case 3:
+        dsp->count_black = NULL;
+        dsp->row_sum     = row_sum_rgb3_c;
+        dsp->col_sum     = col_sum_rgb3_c;
+        break;
+    case 4:
+        dsp->count_black = NULL;
+        dsp->row_sum     = row_sum_rgb4_c;
+        dsp->col_sum     = col_sum_rgb4_c;
+        break;
+    }
+}
+
+int ff_qcdetect_find_edge(const uint32_t *sum, unsigned div, int limit,
+                          int max_outliers, int first, int last,
+                          int *outliers, int *edge)
+{
+    const int inc = first < last ? 1 : -1;
+    int y;
+
+    for (y = first; y != last; y += inc) {
+        if ((int)(sum[y] / div) > limit) {
+            if (++*outliers > max_outliers)
+                return 1;
+        } else
+            *edge = y + inc;
+    }
+    return 0;
+}
+
+void ff_qcdetect_crop_area(int x1, int y1, int x2, int y2, int round,
+                           int *x, int *y, int *w, int *h)
+{
+    int shrink_by;
+
+    // round x and y (up), important for yuv colorspaces
+    // make sure they stay rounded!
+    *x = (x1 + 1) & ~1;
+    *y = (y1 + 1) & ~1;
+
+    *w = x2 - *x + 1;
+    *h = y2 - *y + 1;
+
+    // w and h must be divisible by 2 as well because of yuv
+    // colorspace problems.
+    if (round <= 1)
+        round = 16;
+    if (round % 2)
+        round *= 2;
+
+    shrink_by = *w % round;
+    *w -= shrink_by;
+    *x += (shrink_by / 2 + 1) & ~1;
+
+    shrink_by = *h % round;
+    *h -= shrink_by;
+    *y += (shrink_by / 2 + 1) & ~1;
+}
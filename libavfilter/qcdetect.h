@@ -0,0 +1,73 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_QCDETECT_H
+#define AVFILTER_QCDETECT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Row kernels shared by the blackdetect, cropdetect and qcdetect filters.
+ * Widths are in pixels; for packed RGB the first three components of each
+ * pixel are summed.
+ */
+typedef struct QCDetectDSPContext {
+    /**
+     * Return the number of samples of a row which are at most threshold.
+     */
+    unsigned (*count_black)(const uint8_t *src, ptrdiff_t width, unsigned threshold);
+
+    /**
+     * Return the sum of the samples of a row.
+     */
+    uint32_t (*row_sum)(const uint8_t *src, ptrdiff_t width);
+
+    /**
+     * Add the samples of a row to the per column sums.
+     */
+    void (*col_sum)(uint32_t *sum, const uint8_t *src, ptrdiff_t width);
+} QCDetectDSPContext;
+
+/**
+ * @param bpp bytes per pixel of the first plane, 1 to 4
+ */
+void ff_qcdetect_init(QCDetectDSPContext *dsp, int bpp);
+
+/**
+ * Walk the line sums from first towards last (exclusive) and look for the
+ * first run of more than max_outliers lines whose average sample value
+ * exceeds limit. The search can be resumed over consecutive ranges by
+ * keeping outliers and edge, which must start at 0 and first.
+ *
+ * @param div   number of samples summed per line
+ * @param edge  set to the line before the run
+ * @return 1 if the run was found, 0 otherwise
+ */
+int ff_qcdetect_find_edge(const uint32_t *sum, unsigned div, int limit,
+                          int max_outliers, int first, int last,
+                          int *outliers, int *edge);
+
+/**
+ * Compute the crop area from the detected borders, aligned to even
+ * offsets and with dimensions which are multiples of round.
+ */
+void ff_qcdetect_crop_area(int x1, int y1, int x2, int y2, int round,
+                           int *x, int *y, int *w, int *h);
+
+#endif /* AVFILTER_QCDETECT_H */
@@ -70,3 +70,44 @@ ff_scene_sad_fn ff_scene_sad_get_fn(int depth)
     return sad;
 }
 
+
+void ff_scene_box8_c(SCENE_BOX_PARAMS)
+{
+    int x, i, j;
+
+    for (x = 0; x < width; x++) {
+        const uint8_t *s = src + 8 * x;
+        unsigned sum = 0;
+
+        for (j = 0; j < 8; j++)
+            for (i = 0; i < 8; i++)
+                sum += s[j * stride + i];
+        dst[x] = (sum + 32) >> 6;
+    }
+}
+
+void ff_scene_box8_16_c(SCENE_BOX_PARAMS)
+{
+    int x, i, j;
+
+    stride /= 2;
+
+    for (x = 0; x < width; x++) {
+        const uint16_t *s = (const uint16_t *)src + 8 * x;
+        unsigned sum = 0;
+
+        for (j = 0; j < 8; j++)
+            for (i = 0; i < 8; i++)
+                sum += s[j * stride + i];
+        dst[x] = FFMIN((sum + (32 << shift)) >> (6 + shift), 255);
+    }
+}
+
+ff_scene_box_fn ff_scene_box_get_fn(int depth)
+{
+    if (depth == 8)
+        return ff_scene_box8_c;
+    if (depth == 16)
+        return ff_scene_box8_16_c;
+    return NULL;
+}
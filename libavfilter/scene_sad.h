@@ -41,4 +41,24 @@ ff_scene_sad_fn ff_scene_sad_get_fn_x86(int depth);
 
 ff_scene_sad_fn ff_scene_sad_get_fn(int depth);
 
+/**
+ * Average 8x8 blocks of samples into one row of an 8 bit thumbnail.
+ *
+ * @param dst    output row of width samples
+ * @param src    top left of the first block, 8 rows of 8 * width samples
+ * @param stride source line size in bytes
+ * @param width  number of blocks
+ * @param shift  bit depth of the source minus 8
+ */
+#define SCENE_BOX_PARAMS uint8_t *dst, const uint8_t *src, ptrdiff_t stride, \
+                         ptrdiff_t width, int shift
+
+typedef void (*ff_scene_box_fn)(SCENE_BOX_PARAMS);
+
+void ff_scene_box8_c(SCENE_BOX_PARAMS);
+
+void ff_scene_box8_16_c(SCENE_BOX_PARAMS);
+
+ff_scene_box_fn ff_scene_box_get_fn(int depth);
+
 #endif /* AVFILTER_SCENE_SAD_H */
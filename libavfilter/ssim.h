@@ -31,6 +31,31 @@ typedef struct SSIMDSPContext {
     float (*ssim_end_line)(const int (*sum0)[4], const int (*sum1)[4], int w);
 } SSIMDSPContext;
 
+#define SSIM_TEMP_SIZE(w, depth) (2 * (((w) >> 2) + 3) * \
+                                  ((depth) > 8 ? sizeof(int64_t[4]) : sizeof(int[4])))
+
+void ff_ssim_init(SSIMDSPContext *dsp);
 void ff_ssim_init_x86(SSIMDSPContext *dsp);
 
+/**
+ * Compute the SSIM of the rows [y_start, y_end) of 4x4 blocks of a plane,
+ * with 1 <= y_start <= y_end <= height / 4. The sum over the blocks of row
+ * y is stored in row_ssim[y]; rows do not depend on each other, so a plane
+ * can be split across threads as long as each one has its own temp buffer.
+ *
+ * @param temp scratch buffer of SSIM_TEMP_SIZE(width, depth) bytes
+ */
+void ff_ssim_plane_rows(const SSIMDSPContext *dsp, int depth,
+                        const uint8_t *main, int main_stride,
+                        const uint8_t *ref, int ref_stride,
+                        int width, void *temp,
+                        int y_start, int y_end, float *row_ssim);
+
+/**
+ * Reduce the row sums filled by ff_ssim_plane_rows() to the SSIM of the
+ * whole plane. The summation order is fixed, so the result does not depend
+ * on how the rows were distributed.
+ */
+float ff_ssim_plane_sum(const float *row_ssim, int width, int height);
+
 #endif /* AVFILTER_SSIM_H */
@@ -29,6 +29,7 @@
 #include "libavutil/timestamp.h"
 #include "avfilter.h"
 #include "internal.h"
+#include "qcdetect.h"
 
 typedef struct BlackDetectContext {
     const AVClass *class;
@@ -43,7 +44,9 @@ typedef struct BlackDetectContext {
     double       pixel_black_th;
     unsigned int pixel_black_th_i;
 
-    unsigned int nb_black_pixels;   ///< number of black pixels counted so far
+    unsigned int *counts;           ///< number of black pixels counted by each job
+    int nb_jobs;
+    QCDetectDSPContext dsp;
 } BlackDetectContext;
 
 #define OFFSET(x) offsetof(BlackDetectContext, x)
@@ -104,6 +107,38 @@ static int config_input(AVFilterLink *inlink)
            av_ts2timestr(blackdetect->black_min_duration, &inlink->time_base),
            blackdetect->pixel_black_th, blackdetect->pixel_black_th_i,
            blackdetect->picture_black_ratio_th);
+
+    ff_qcdetect_init(&blackdetect->dsp, 1);
+    blackdetect->nb_jobs = FFMAX(1, FFMIN(inlink->h, ff_filter_get_nb_threads(ctx)));
+    av_freep(&blackdetect->counts);
+    blackdetect->counts = av_calloc(blackdetect->nb_jobs, sizeof(*blackdetect->counts));
+    if (!blackdetect->counts)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    BlackDetectContext *blackdetect = ctx->priv;
+
+    av_freep(&blackdetect->counts);
+}
+
+static int black_counter(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BlackDetectContext *blackdetect = ctx->priv;
+    AVFrame *in = arg;
+    const int slice_start = (in->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (in->height * (jobnr + 1)) / nb_jobs;
+    const uint8_t *p = in->data[0] + slice_start * in->linesize[0];
+    unsigned int count = 0;
+    int i;
+
+    for (i = slice_start; i < slice_end; i++) {
+        count += blackdetect->dsp.count_black(p, in->width, blackdetect->pixel_black_th_i);
+        p += in->linesize[0];
+    }
+    blackdetect->counts[jobnr] = count;
     return 0;
 }
 
@@ -142,16 +177,14 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     AVFilterContext *ctx = inlink->dst;
     BlackDetectContext *blackdetect = ctx->priv;
     double picture_black_ratio = 0;
-    const uint8_t *p = picref->data[0];
-    int x, i;
+    unsigned int nb_black_pixels = 0;
+    int i;
 
-    for (i = 0; i < inlink->h; i++) {
-        for (x = 0; x < inlink->w; x++)
-            blackdetect->nb_black_pixels += p[x] <= blackdetect->pixel_black_th_i;
-        p += picref->linesize[0];
-    }
+    ctx->internal->execute(ctx, black_counter, picref, NULL, blackdetect->nb_jobs);
+    for (i = 0; i < blackdetect->nb_jobs; i++)
+        nb_black_pixels += blackdetect->counts[i];
 
-    picture_black_ratio = (double)blackdetect->nb_black_pixels / (inlink->w * inlink->h);
+    picture_black_ratio = (double)nb_black_pixels / (inlink->w * inlink->h);
 
     av_log(ctx, AV_LOG_DEBUG,
            "frame:%"PRId64" picture_black_ratio:%f pts:%s t:%s type:%c\n",
@@ -177,7 +210,6 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     }
 
     blackdetect->last_picref_pts = picref->pts;
-    blackdetect->nb_black_pixels = 0;
     return ff_filter_frame(inlink->dst->outputs[0], picref);
 }
 
@@ -204,8 +236,10 @@ AVFilter ff_vf_blackdetect = {
     .name          = "blackdetect",
     .description   = NULL_IF_CONFIG_SMALL("Detect video intervals that are (almost) black."),
     .priv_size     = sizeof(BlackDetectContext),
+    .uninit        = uninit,
     .query_formats = query_formats,
     .inputs        = blackdetect_inputs,
     .outputs       = blackdetect_outputs,
     .priv_class    = &blackdetect_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
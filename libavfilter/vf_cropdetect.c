@@ -30,6 +30,7 @@
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
+#include "qcdetect.h"
 #include "video.h"
 
 typedef struct CropDetectContext {
@@ -41,8 +42,17 @@ typedef struct CropDetectContext {
     int frame_nb;
     int max_pixsteps[4];
     int max_outliers;
+    QCDetectDSPContext dsp;
+    uint32_t *row_sums;
+    uint32_t *col_sums;             ///< per job column sums, the first job holds the total
+    int nb_jobs;
 } CropDetectContext;
 
+typedef struct ThreadData {
+    AVFrame *frame;
+    int start, end;                 ///< column range to sum
+} ThreadData;
+
 static int query_formats(AVFilterContext *ctx)
 {
     static const enum AVPixelFormat pix_fmts[] = {
@@ -68,61 +78,6 @@ static int query_formats(AVFilterContext *ctx)
     return ff_set_common_formats(ctx, fmts_list);
 }
 
-static int checkline(void *ctx, const unsigned char *src, int stride, int len, int bpp)
-{
-    int total = 0;
-    int div = len;
-    const uint16_t *src16 = (const uint16_t *)src;
-
-    switch (bpp) {
-    case 1:
-        while (len >= 8) {
-            total += src[       0] + src[  stride] + src[2*stride] + src[3*stride]
-                  +  src[4*stride] + src[5*stride] + src[6*stride] + src[7*stride];
-            src += 8*stride;
-            len -= 8;
-        }
-        while (--len >= 0) {
-            total += src[0];
-            src += stride;
-        }
-        break;
-    case 2:
-        stride >>= 1;
-        while (len >= 8) {
-            total += src16[       0] + src16[  stride] + src16[2*stride] + src16[3*stride]
-                  +  src16[4*stride] + src16[5*stride] + src16[6*stride] + src16[7*stride];
-            src16 += 8*stride;
-            len -= 8;
-        }
-        while (--len >= 0) {
-            total += src16[0];
-            src16 += stride;
-        }
-        break;
-    case 3:
-    case 4:
-        while (len >= 4) {
-            total += src[0]        + src[1         ] + src[2         ]
-                  +  src[  stride] + src[1+  stride] + src[2+  stride]
-                  +  src[2*stride] + src[1+2*stride] + src[2+2*stride]
-                  +  src[3*stride] + src[1+3*stride] + src[2+3*stride];
-            src += 4*stride;
-            len -= 4;
-        }
-        while (--len >= 0) {
-            total += src[0] + src[1] + src[2];
-            src += stride;
-        }
-        div *= 3;
-        break;
-    }
-    total /= div;
-
-    av_log(ctx, AV_LOG_DEBUG, "total:%d\n", total);
-    return total;
-}
-
 static av_cold int init(AVFilterContext *ctx)
 {
     CropDetectContext *s = ctx->priv;
@@ -142,6 +97,7 @@ static int config_input(AVFilterLink *inlink)
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
 
     av_image_fill_max_pixsteps(s->max_pixsteps, NULL, desc);
+    ff_qcdetect_init(&s->dsp, s->max_pixsteps[0]);
 
     if (s->limit < 1.0)
         s->limit *= (1 << desc->comp[0].depth) - 1;
@@ -151,9 +107,112 @@ static int config_input(AVFilterLink *inlink)
     s->x2 = 0;
     s->y2 = 0;
 
+    s->nb_jobs = FFMAX(1, FFMIN(inlink->h, ff_filter_get_nb_threads(ctx)));
+    av_freep(&s->row_sums);
+    av_freep(&s->col_sums);
+    s->row_sums = av_malloc_array(inlink->h, sizeof(*s->row_sums));
+    s->col_sums = av_malloc_array(s->nb_jobs, inlink->w * sizeof(*s->col_sums));
+    if (!s->row_sums || !s->col_sums)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    CropDetectContext *s = ctx->priv;
+
+    av_freep(&s->row_sums);
+    av_freep(&s->col_sums);
+}
+
+static int sum_columns(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    CropDetectContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    const int bpp = s->max_pixsteps[0];
+    const int slice_start = (frame->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (frame->height * (jobnr + 1)) / nb_jobs;
+    uint32_t *sum = s->col_sums + jobnr * frame->width + td->start;
+    const uint8_t *src = frame->data[0] + slice_start * frame->linesize[0] + td->start * bpp;
+    int y;
+
+    memset(sum, 0, (td->end - td->start) * sizeof(*sum));
+    for (y = slice_start; y < slice_end; y++) {
+        s->dsp.col_sum(sum, src, td->end - td->start);
+        src += frame->linesize[0];
+    }
+    return 0;
+}
+
+/**
+ * Sum the columns [start, end) row by row instead of walking each column,
+ * which keeps the accesses sequential.
+ */
+static void get_col_sums(AVFilterContext *ctx, AVFrame *frame, int start, int end)
+{
+    CropDetectContext *s = ctx->priv;
+    ThreadData td = { frame, start, end };
+    int i, x;
+
+    if (start >= end)
+        return;
+
+    ctx->internal->execute(ctx, sum_columns, &td, NULL, s->nb_jobs);
+    for (i = 1; i < s->nb_jobs; i++) {
+        const uint32_t *sum = s->col_sums + i * frame->width;
+        for (x = start; x < end; x++)
+            s->col_sums[x] += sum[x];
+    }
+}
+
+static void get_row_sums(CropDetectContext *s, AVFrame *frame, int start, int end)
+{
+    int y;
+
+    for (y = start; y < end; y++)
+        s->row_sums[y] = s->dsp.row_sum(frame->data[0] + y * frame->linesize[0], frame->width);
+}
+
+#define ROW_CHUNK 16
+#define COL_CHUNK 64
+
+/**
+ * Search the border between first and last (exclusive), summing the lines
+ * chunk by chunk so that the search stops reading at the first content.
+ */
+static int find_edge(AVFilterContext *ctx, AVFrame *frame, int cols,
+                     int first, int last, int edge)
+{
+    CropDetectContext *s = ctx->priv;
+    const int div   = s->max_pixsteps[0] >= 3 ? 3 : 1;
+    const int inc   = first < last ? 1 : -1;
+    const int chunk = cols ? COL_CHUNK : ROW_CHUNK;
+    int limit = lrint(s->limit);
+    int outliers = 0, prev = first;
+    int pos = first;
+
+    while (pos != last) {
+        int n  = FFMIN(chunk, FFABS(last - pos));
+        int lo = inc > 0 ? pos : pos - n + 1;
+
+        if (cols) {
+            get_col_sums(ctx, frame, lo, lo + n);
+            if (ff_qcdetect_find_edge(s->col_sums, div * frame->height, limit, s->max_outliers,
+                                      pos, pos + n * inc, &outliers, &prev))
+                return prev;
+        } else {
+            get_row_sums(s, frame, lo, lo + n);
+            if (ff_qcdetect_find_edge(s->row_sums, div * frame->width, limit, s->max_outliers,
+                                      pos, pos + n * inc, &outliers, &prev))
+                return prev;
+        }
+        pos += n * inc;
+    }
+    return edge;
+}
+
 #define SET_META(key, value) \
     av_dict_set_int(metadata, key, value, 0)
 
@@ -161,11 +220,8 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 {
     AVFilterContext *ctx = inlink->dst;
     CropDetectContext *s = ctx->priv;
-    int bpp = s->max_pixsteps[0];
-    int w, h, x, y, shrink_by;
+    int w, h, x, y;
     AVDictionary **metadata;
-    int outliers, last_y;
-    int limit = lrint(s->limit);
 
     // ignore first 2 frames - they may be empty
     if (++s->frame_nb > 0) {
@@ -180,46 +236,12 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
             s->frame_nb = 1;
         }
 
-#define FIND(DST, FROM, NOEND, INC, STEP0, STEP1, LEN) \
-        outliers = 0;\
-        for (last_y = y = FROM; NOEND; y = y INC) {\
-            if (checkline(ctx, frame->data[0] + STEP0 * y, STEP1, LEN, bpp) > limit) {\
-                if (++outliers > s->max_outliers) { \
-                    DST = last_y;\
-                    break;\
-                }\
-            } else\
-                last_y = y INC;\
-        }
-
-        FIND(s->y1,                 0,               y < s->y1, +1, frame->linesize[0], bpp, frame->width);
-        FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, frame->linesize[0], bpp, frame->width);
-        FIND(s->x1,                 0,               y < s->x1, +1, bpp, frame->linesize[0], frame->height);
-        FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, bpp, frame->linesize[0], frame->height);
-
-
-        // round x and y (up), important for yuv colorspaces
-        // make sure they stay rounded!
-        x = (s->x1+1) & ~1;
-        y = (s->y1+1) & ~1;
-
-        w = s->x2 - x + 1;
-        h = s->y2 - y + 1;
-
-        // w and h must be divisible by 2 as well because of yuv
-        // colorspace problems.
-        if (s->round <= 1)
-            s->round = 16;
-        if (s->round % 2)
-            s->round *= 2;
-
-        shrink_by = w % s->round;
-        w -= shrink_by;
-        x += (shrink_by/2 + 1) & ~1;
+        s->y1 = find_edge(ctx, frame, 0, 0, s->y1, s->y1);
+        s->y2 = find_edge(ctx, frame, 0, frame->height - 1, FFMAX(s->y2, s->y1), s->y2);
+        s->x1 = find_edge(ctx, frame, 1, 0, s->x1, s->x1);
+        s->x2 = find_edge(ctx, frame, 1, frame->width - 1, FFMAX(s->x2, s->x1), s->x2);
 
-        shrink_by = h % s->round;
-        h -= shrink_by;
-        y += (shrink_by/2 + 1) & ~1;
+        ff_qcdetect_crop_area(s->x1, s->y1, s->x2, s->y2, s->round, &x, &y, &w, &h);
 
         SET_META("lavfi.cropdetect.x1", s->x1);
         SET_META("lavfi.cropdetect.x2", s->x2);
@@ -278,8 +300,9 @@ AVFilter ff_vf_cropdetect = {
     .priv_size     = sizeof(CropDetectContext),
     .priv_class    = &cropdetect_class,
     .init          = init,
+    .uninit        = uninit,
     .query_formats = query_formats,
     .inputs        = avfilter_vf_cropdetect_inputs,
     .outputs       = avfilter_vf_cropdetect_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -52,6 +52,7 @@ static const AVOption framerate_options[] = {
     {"interp_start",        "point to start linear interpolation",    OFFSET(interp_start),    AV_OPT_TYPE_INT,      {.i64=15},                 0,       255,     V|F },
     {"interp_end",          "point to end linear interpolation",      OFFSET(interp_end),      AV_OPT_TYPE_INT,      {.i64=240},                0,       255,     V|F },
     {"scene",               "scene change level",                     OFFSET(scene_score),     AV_OPT_TYPE_DOUBLE,   {.dbl=8.2},                0,       INT_MAX, V|F },
+    {"exact_cadence",       "drop frames instead of blending on integer rate ratios", OFFSET(exact_cadence), AV_OPT_TYPE_BOOL, {.i64=1},      0,       1,       V|F },
 
     {"flags",               "set flags",                              OFFSET(flags),           AV_OPT_TYPE_FLAGS,    {.i64=1},                  0,       INT_MAX, V|F, "flags" },
     {"scene_change_detect", "enable scene change detection",          0,                       AV_OPT_TYPE_CONST,    {.i64=FRAMERATE_FLAG_SCD}, INT_MIN, INT_MAX, V|F, "flags" },
@@ -130,6 +131,13 @@ static int blend_frames(AVFilterContext *ctx, int interpolate)
     AVFilterLink *outlink = ctx->outputs[0];
     double interpolate_scene_score = 0;
 
+    // both frames reference the same picture, blending would return it unchanged
+    if (s->f0->data[0] == s->f1->data[0]) {
+        if ((s->flags & FRAMERATE_FLAG_SCD) && s->score < 0.0)
+            s->score = s->prev_mafd = 0.0;
+        return 0;
+    }
+
     if ((s->flags & FRAMERATE_FLAG_SCD)) {
         if (s->score >= 0.0)
             interpolate_scene_score = s->score;
@@ -185,7 +193,10 @@ static int process_work_frame(AVFilterContext *ctx)
         interpolate = av_rescale(work_pts - s->pts0, s->blend_factor_max, s->delta);
         interpolate8 = av_rescale(work_pts - s->pts0, 256, s->delta);
         ff_dlog(ctx, "process_work_frame() interpolate: %"PRId64"/256\n", interpolate8);
-        if (interpolate >= s->blend_factor_max || interpolate8 > s->interp_end) {
+        if (s->cadence) {
+            // every output frame lines up with an input frame, up to timestamp jitter
+            s->work = av_frame_clone(interpolate > (s->blend_factor_max >> 1) ? s->f1 : s->f0);
+        } else if (interpolate >= s->blend_factor_max || interpolate8 > s->interp_end) {
             s->work = av_frame_clone(s->f1);
         } else if (interpolate <= 0 || interpolate8 < s->interp_start) {
             s->work = av_frame_clone(s->f0);
@@ -420,6 +431,15 @@ static int config_output(AVFilterLink *outlink)
     outlink->frame_rate = s->dest_frame_rate;
     outlink->time_base = s->dest_time_base;
 
+    s->cadence = 0;
+    if (s->exact_cadence && ctx->inputs[0]->frame_rate.num > 0 && ctx->inputs[0]->frame_rate.den > 0) {
+        AVRational ratio = av_div_q(ctx->inputs[0]->frame_rate, s->dest_frame_rate);
+        if (ratio.den == 1 && ratio.num > 0) {
+            s->cadence = ratio.num;
+            av_log(ctx, AV_LOG_VERBOSE, "exact cadence: keeping 1 frame out of %d\n", s->cadence);
+        }
+    }
+
     ff_dlog(ctx,
            "config_output() output time base:%u/%u (%f) w:%d h:%d\n",
            outlink->time_base.num, outlink->time_base.den,
@@ -29,6 +29,7 @@
 
 #include "avfilter.h"
 #include "filters.h"
+#include "internal.h"
 #include "scene_sad.h"
 
 typedef struct FreezeDetectContext {
@@ -42,6 +43,8 @@ typedef struct FreezeDetectContext {
     int64_t n;
     int64_t reference_n;
     int frozen;
+    uint64_t *sads;              ///< sum of absolute differences of each job
+    int nb_jobs;
 
     double noise;
     int64_t duration;            ///< minimum duration of frozen frame until notification
@@ -115,6 +118,12 @@ static int config_input(AVFilterLink *inlink)
     if (!s->sad)
         return AVERROR(EINVAL);
 
+    s->nb_jobs = FFMAX(1, FFMIN(s->height[0], ff_filter_get_nb_threads(ctx)));
+    av_freep(&s->sads);
+    s->sads = av_calloc(s->nb_jobs, sizeof(*s->sads));
+    if (!s->sads)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
@@ -122,24 +131,51 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     FreezeDetectContext *s = ctx->priv;
     av_frame_free(&s->reference_frame);
+    av_freep(&s->sads);
 }
 
-static int is_frozen(FreezeDetectContext *s, AVFrame *reference, AVFrame *frame)
+typedef struct ThreadData {
+    AVFrame *reference, *frame;
+} ThreadData;
+
+static int compute_sad(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    FreezeDetectContext *s = ctx->priv;
+    ThreadData *td = arg;
     uint64_t sad = 0;
-    uint64_t count = 0;
-    double mafd;
+
     for (int plane = 0; plane < 4; plane++) {
-        if (s->width[plane]) {
-            uint64_t plane_sad;
-            s->sad(frame->data[plane], frame->linesize[plane],
-                   reference->data[plane], reference->linesize[plane],
-                   s->width[plane], s->height[plane], &plane_sad);
-            sad += plane_sad;
-            count += s->width[plane] * s->height[plane];
-        }
+        const int slice_start = (s->height[plane] *  jobnr     ) / nb_jobs;
+        const int slice_end   = (s->height[plane] * (jobnr + 1)) / nb_jobs;
+        uint64_t plane_sad;
+
+        if (!s->width[plane] || slice_start == slice_end)
+            continue;
+        s->sad(td->frame->data[plane] + slice_start * td->frame->linesize[plane],
+               td->frame->linesize[plane],
+               td->reference->data[plane] + slice_start * td->reference->linesize[plane],
+               td->reference->linesize[plane],
+               s->width[plane], slice_end - slice_start, &plane_sad);
+        sad += plane_sad;
     }
     emms_c();
+    s->sads[jobnr] = sad;
+    return 0;
+}
+
+static int is_frozen(AVFilterContext *ctx, AVFrame *reference, AVFrame *frame)
+{
+    FreezeDetectContext *s = ctx->priv;
+    ThreadData td = { reference, frame };
+    uint64_t sad = 0;
+    uint64_t count = 0;
+    double mafd;
+
+    ctx->internal->execute(ctx, compute_sad, &td, NULL, s->nb_jobs);
+    for (int i = 0; i < s->nb_jobs; i++)
+        sad += s->sads[i];
+    for (int plane = 0; plane < 4; plane++)
+        count += s->width[plane] * s->height[plane];
     mafd = (double)sad / count / (1ULL << s->bitdepth);
     return (mafd <= s->noise);
 }
@@ -175,7 +211,7 @@ static int activate(AVFilterContext *ctx)
             else
                 duration = av_rescale_q(frame->pts - s->reference_frame->pts, inlink->time_base, AV_TIME_BASE_Q);
 
-            frozen = is_frozen(s, s->reference_frame, frame);
+            frozen = is_frozen(ctx, s->reference_frame, frame);
             if (duration >= s->duration) {
                 if (!s->frozen)
                     set_meta(s, frame, "lavfi.freezedetect.freeze_start", av_ts2timestr(s->reference_frame->pts, &inlink->time_base));
@@ -232,4 +268,5 @@ AVFilter ff_vf_freezedetect = {
     .inputs        = freezedetect_inputs,
     .outputs       = freezedetect_outputs,
     .activate      = activate,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -35,6 +35,7 @@
 #include "formats.h"
 #include "framesync.h"
 #include "internal.h"
+#include "lut3d.h"
 #include "video.h"
 
 #define R 0
@@ -42,13 +43,6 @@
 #define B 2
 #define A 3
 
-enum interp_mode {
-    INTERPOLATE_NEAREST,
-    INTERPOLATE_TRILINEAR,
-    INTERPOLATE_TETRAHEDRAL,
-    NB_INTERP_MODE
-};
-
 struct rgbvec {
     float r, g, b;
 };
@@ -67,6 +61,14 @@ typedef struct LUT3DContext {
     struct rgbvec scale;
     struct rgbvec lut[MAX_LEVEL][MAX_LEVEL][MAX_LEVEL];
     int lutsize;
+    LUT3DDSPContext dsp;
+    int fixed;                  ///< use the fixed point path for the current input
+    int depth;
+    uint32_t fixed_scale[3];
+    uint16_t *lut16;            ///< fixed point copy of lut, see LUT3DDSPContext
+    int lut16_size;
+    int lut16_depth;
+    int lut16_dirty;
 #if CONFIG_HALDCLUT_FILTER
     uint8_t clut_rgba_map[4];
     int clut_step;
@@ -280,6 +282,250 @@ DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 16)
 DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 16)
 DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 16)
 
+/**
+ * Fixed point interpolation for planar 9 to 12 bit input. The lattice
+ * position is computed with LUT3D_POS_BITS fractional bits, and the lut
+ * entries are 16 bit so that the weighted sums fit in 32 bit.
+ */
+static av_always_inline void fixed_pos(unsigned v, uint32_t scale, int maxval, int lutmax,
+                                       int *prev, int *next, int *frac)
+{
+    const uint32_t pos = FFMIN(v, maxval) * scale;
+
+    *prev = FFMIN(pos >> LUT3D_POS_BITS, lutmax);
+    *next = FFMIN(*prev + 1, lutmax);
+    *frac = (pos >> (LUT3D_POS_BITS - LUT3D_FRAC_BITS)) & ((1 << LUT3D_FRAC_BITS) - 1);
+}
+
+static void interp_fixed_nearest_c(uint16_t *dstr, uint16_t *dstg, uint16_t *dstb,
+                                   const uint16_t *srcr, const uint16_t *srcg,
+                                   const uint16_t *srcb, int width,
+                                   const uint16_t *lut, int lutsize,
+                                   const uint32_t scale[3], int depth)
+{
+    const int maxval = (1 << depth) - 1;
+    const int shift = 16 - depth;
+    const int rnd = 1 << (LUT3D_POS_BITS - 1);
+    const int lutmax = lutsize - 1;
+    int x;
+
+    for (x = 0; x < width; x++) {
+        const int r = FFMIN((FFMIN(srcr[x], maxval) * scale[0] + rnd) >> LUT3D_POS_BITS, lutmax);
+        const int g = FFMIN((FFMIN(srcg[x], maxval) * scale[1] + rnd) >> LUT3D_POS_BITS, lutmax);
+        const int b = FFMIN((FFMIN(srcb[x], maxval) * scale[2] + rnd) >> LUT3D_POS_BITS, lutmax);
+        const uint16_t *c = lut + ((r * lutsize + g) * lutsize + b) * 3;
+
+        dstr[x] = (c[0] + (1 << shift >> 1)) >> shift;
+        dstg[x] = (c[1] + (1 << shift >> 1)) >> shift;
+        dstb[x] = (c[2] + (1 << shift >> 1)) >> shift;
+    }
+}
+
+static void interp_fixed_trilinear_c(uint16_t *dstr, uint16_t *dstg, uint16_t *dstb,
+                                     const uint16_t *srcr, const uint16_t *srcg,
+                                     const uint16_t *srcb, int width,
+                                     const uint16_t *lut, int lutsize,
+                                     const uint32_t scale[3], int depth)
+{
+    const int maxval = (1 << depth) - 1;
+    const int shift = LUT3D_FRAC_BITS + 16 - depth;
+    const unsigned one = 1 << LUT3D_FRAC_BITS;
+    const int lutmax = lutsize - 1;
+    const int sr = lutsize * lutsize * 3, sg = lutsize * 3, sb = 3;
+    int x;
+
+    for (x = 0; x < width; x++) {
+        int pr, pg, pb, nr, ng, nb, fr, fg, fb;
+        unsigned w00, w01, w10, w11;
+        unsigned w000, w001, w010, w011, w100, w101, w110, w111;
+        const uint16_t *c000, *c001, *c010, *c011, *c100, *c101, *c110, *c111;
+
+        fixed_pos(srcr[x], scale[0], maxval, lutmax, &pr, &nr, &fr);
+        fixed_pos(srcg[x], scale[1], maxval, lutmax, &pg, &ng, &fg);
+        fixed_pos(srcb[x], scale[2], maxval, lutmax, &pb, &nb, &fb);
+
+        c000 = lut + pr * sr + pg * sg + pb * sb;
+        c001 = lut + pr * sr + pg * sg + nb * sb;
+        c010 = lut + pr * sr + ng * sg + pb * sb;
+        c011 = lut + pr * sr + ng * sg + nb * sb;
+        c100 = lut + nr * sr + pg * sg + pb * sb;
+        c101 = lut + nr * sr + pg * sg + nb * sb;
+        c110 = lut + nr * sr + ng * sg + pb * sb;
+        c111 = lut + nr * sr + ng * sg + nb * sb;
+
+        /* the weights of the 8 vertices sum to exactly one */
+        w00  = (one - fr) * (one - fg) >> LUT3D_FRAC_BITS;
+        w10  = fr         * (one - fg) >> LUT3D_FRAC_BITS;
+        w01  = (one - fr) * fg         >> LUT3D_FRAC_BITS;
+        w11  = fr         * fg         >> LUT3D_FRAC_BITS;
+        w000 = w00 * (one - fb) >> LUT3D_FRAC_BITS;
+        w001 = w00 * fb         >> LUT3D_FRAC_BITS;
+        w100 = w10 * (one - fb) >> LUT3D_FRAC_BITS;
+        w101 = w10 * fb         >> LUT3D_FRAC_BITS;
+        w010 = w01 * (one - fb) >> LUT3D_FRAC_BITS;
+        w011 = w01 * fb         >> LUT3D_FRAC_BITS;
+        w110 = w11 * (one - fb) >> LUT3D_FRAC_BITS;
+        w111 = one - w000 - w001 - w010 - w011 - w100 - w101 - w110;
+
+#define TRILINEAR(i) ((w000 * c000[i] + w001 * c001[i] + w010 * c010[i] + w011 * c011[i] + \
+                       w100 * c100[i] + w101 * c101[i] + w110 * c110[i] + w111 * c111[i] + \
+                       (1U << (shift - 1))) >> shift)
+        dstr[x] = TRILINEAR(0);
+        dstg[x] = TRILINEAR(1);
+        dstb[x] = TRILINEAR(2);
+#undef TRILINEAR
+    }
+}
+
+static void interp_fixed_tetrahedral_c(uint16_t *dstr, uint16_t *dstg, uint16_t *dstb,
+                                       const uint16_t *srcr, const uint16_t *srcg,
+                                       const uint16_t *srcb, int width,
+                                       const uint16_t *lut, int lutsize,
+                                       const uint32_t scale[3], int depth)
+{
+    const int maxval = (1 << depth) - 1;
+    const int shift = LUT3D_FRAC_BITS + 16 - depth;
+    const int one = 1 << LUT3D_FRAC_BITS;
+    const int lutmax = lutsize - 1;
+    const int sr = lutsize * lutsize * 3, sg = lutsize * 3, sb = 3;
+    int x;
+
+    for (x = 0; x < width; x++) {
+        int pr, pg, pb, nr, ng, nb, fr, fg, fb;
+        int w0, w1, w2, w3;
+        const uint16_t *c000, *c111, *c1, *c2;
+
+        fixed_pos(srcr[x], scale[0], maxval, lutmax, &pr, &nr, &fr);
+        fixed_pos(srcg[x], scale[1], maxval, lutmax, &pg, &ng, &fg);
+        fixed_pos(srcb[x], scale[2], maxval, lutmax, &pb, &nb, &fb);
+
+        c000 = lut + pr * sr + pg * sg + pb * sb;
+        c111 = lut + nr * sr + ng * sg + nb * sb;
+        if (fr > fg) {
+            if (fg > fb) {
+                c1 = lut + nr * sr + pg * sg + pb * sb;
+                c2 = lut + nr * sr + ng * sg + pb * sb;
+                w0 = one - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+            } else if (fr > fb) {
+                c1 = lut + nr * sr + pg * sg + pb * sb;
+                c2 = lut + nr * sr + pg * sg + nb * sb;
+                w0 = one - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+            } else {
+                c1 = lut + pr * sr + pg * sg + nb * sb;
+                c2 = lut + nr * sr + pg * sg + nb * sb;
+                w0 = one - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+            }
+        } else {
+            if (fb > fg) {
+                c1 = lut + pr * sr + pg * sg + nb * sb;
+                c2 = lut + pr * sr + ng * sg + nb * sb;
+                w0 = one - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+            } else if (fb > fr) {
+                c1 = lut + pr * sr + ng * sg + pb * sb;
+                c2 = lut + pr * sr + ng * sg + nb * sb;
+                w0 = one - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+            } else {
+                c1 = lut + pr * sr + ng * sg + pb * sb;
+                c2 = lut + nr * sr + ng * sg + pb * sb;
+                w0 = one - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+            }
+        }
+
+        dstr[x] = (w0 * c000[0] + w1 * c1[0] + w2 * c2[0] + w3 * c111[0] + (1 << (shift - 1))) >> shift;
+        dstg[x] = (w0 * c000[1] + w1 * c1[1] + w2 * c2[1] + w3 * c111[1] + (1 << (shift - 1))) >> shift;
+        dstb[x] = (w0 * c000[2] + w1 * c1[2] + w2 * c2[2] + w3 * c111[2] + (1 << (shift - 1))) >> shift;
+    }
+}
+
+void ff_lut3d_dsp_init(LUT3DDSPContext *dsp)
+{
+    dsp->interp_fixed[INTERPOLATE_NEAREST]     = interp_fixed_nearest_c;
+    dsp->interp_fixed[INTERPOLATE_TRILINEAR]   = interp_fixed_trilinear_c;
+    dsp->interp_fixed[INTERPOLATE_TETRAHEDRAL] = interp_fixed_tetrahedral_c;
+}
+
+static int interp_16_fixed_planar(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    int y;
+    const LUT3DContext *lut3d = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *in  = td->in;
+    const AVFrame *out = td->out;
+    const int direct = out == in;
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;
+    uint8_t *grow = out->data[0] + slice_start * out->linesize[0];
+    uint8_t *brow = out->data[1] + slice_start * out->linesize[1];
+    uint8_t *rrow = out->data[2] + slice_start * out->linesize[2];
+    uint8_t *arow = out->data[3] + slice_start * out->linesize[3];
+    const uint8_t *srcgrow = in->data[0] + slice_start * in->linesize[0];
+    const uint8_t *srcbrow = in->data[1] + slice_start * in->linesize[1];
+    const uint8_t *srcrrow = in->data[2] + slice_start * in->linesize[2];
+    const uint8_t *srcarow = in->data[3] + slice_start * in->linesize[3];
+
+    for (y = slice_start; y < slice_end; y++) {
+        lut3d->dsp.interp_fixed[lut3d->interpolation]((uint16_t *)rrow, (uint16_t *)grow, (uint16_t *)brow,
+                                                      (const uint16_t *)srcrrow, (const uint16_t *)srcgrow,
+                                                      (const uint16_t *)srcbrow, in->width,
+                                                      lut3d->lut16, lut3d->lutsize,
+                                                      lut3d->fixed_scale, lut3d->depth);
+        if (!direct && in->linesize[3])
+            memcpy(arow, srcarow, in->width * 2);
+        grow += out->linesize[0];
+        brow += out->linesize[1];
+        rrow += out->linesize[2];
+        arow += out->linesize[3];
+        srcgrow += in->linesize[0];
+        srcbrow += in->linesize[1];
+        srcrrow += in->linesize[2];
+        srcarow += in->linesize[3];
+    }
+    return 0;
+}
+
+static int update_lut16(LUT3DContext *lut3d)
+{
+    const int size  = lut3d->lutsize;
+    const int depth = lut3d->depth;
+    const float mult = ((1 << depth) - 1) << (16 - depth);
+    double scale;
+    uint16_t *dst;
+    int i, j, k;
+
+    if (lut3d->lut16 && lut3d->lut16_size == size &&
+        lut3d->lut16_depth == depth && !lut3d->lut16_dirty)
+        return 0;
+
+    if (lut3d->lut16_size != size) {
+        av_freep(&lut3d->lut16);
+        lut3d->lut16 = av_malloc_array(size * size * size, 3 * sizeof(*lut3d->lut16));
+        if (!lut3d->lut16)
+            return AVERROR(ENOMEM);
+        lut3d->lut16_size = size;
+    }
+
+    scale = (double)(size - 1) / ((1 << depth) - 1) * (1 << LUT3D_POS_BITS);
+    lut3d->fixed_scale[0] = lut3d->scale.r * scale;
+    lut3d->fixed_scale[1] = lut3d->scale.g * scale;
+    lut3d->fixed_scale[2] = lut3d->scale.b * scale;
+
+    dst = lut3d->lut16;
+    for (i = 0; i < size; i++) {
+        for (j = 0; j < size; j++) {
+            for (k = 0; k < size; k++) {
+                const struct rgbvec *vec = &lut3d->lut[i][j][k];
+                *dst++ = lrintf(av_clipf(vec->r, 0.f, 1.f) * mult);
+                *dst++ = lrintf(av_clipf(vec->g, 0.f, 1.f) * mult);
+                *dst++ = lrintf(av_clipf(vec->b, 0.f, 1.f) * mult);
+            }
+        }
+    }
+    lut3d->lut16_depth = depth;
+    lut3d->lut16_dirty = 0;
+
+    return 0;
+}
+
 #define DEFINE_INTERP_FUNC(name, nbits)                                                             \
 static int interp_##nbits##_##name(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)         \
 {                                                                                                   \
@@ -721,6 +967,16 @@ static int config_input(AVFilterLink *inlink)
         av_assert0(0);
     }
 
+    /* 9 to 12 bit planar input is interpolated in fixed point; the domain
+     * scale must not exceed 1 for the lattice position to fit in 32 bit */
+    lut3d->depth = depth;
+    lut3d->fixed = planar && is16bit && depth <= 12 &&
+                   lut3d->scale.r <= 1.f && lut3d->scale.g <= 1.f && lut3d->scale.b <= 1.f;
+    if (lut3d->fixed) {
+        lut3d->interp = interp_16_fixed_planar;
+        ff_lut3d_dsp_init(&lut3d->dsp);
+    }
+
     return 0;
 }
 
@@ -743,6 +999,13 @@ static AVFrame *apply_lut(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
+    if (lut3d->fixed && update_lut16(lut3d) < 0) {
+        if (out != in)
+            av_frame_free(&out);
+        av_frame_free(&in);
+        return NULL;
+    }
+
     td.in  = in;
     td.out = out;
     ctx->internal->execute(ctx, lut3d->interp, &td, NULL, FFMIN(outlink->h, ff_filter_get_nb_threads(ctx)));
@@ -824,6 +1087,12 @@ end:
     return ret;
 }
 
+static av_cold void lut3d_uninit(AVFilterContext *ctx)
+{
+    LUT3DContext *lut3d = ctx->priv;
+    av_freep(&lut3d->lut16);
+}
+
 static const AVFilterPad lut3d_inputs[] = {
     {
         .name         = "default",
@@ -847,6 +1116,7 @@ AVFilter ff_vf_lut3d = {
     .description   = NULL_IF_CONFIG_SMALL("Adjust colors using a 3D LUT."),
     .priv_size     = sizeof(LUT3DContext),
     .init          = lut3d_init,
+    .uninit        = lut3d_uninit,
     .query_formats = query_formats,
     .inputs        = lut3d_inputs,
     .outputs       = lut3d_outputs,
@@ -1023,6 +1293,7 @@ static int update_apply_clut(FFFrameSync *fs)
         update_clut_planar(ctx->priv, second);
     else
         update_clut_packed(ctx->priv, second);
+    lut3d->lut16_dirty = 1;
     out = apply_lut(inlink, master);
     return ff_filter_frame(ctx->outputs[0], out);
 }
@@ -1039,6 +1310,7 @@ static av_cold void haldclut_uninit(AVFilterContext *ctx)
 {
     LUT3DContext *lut3d = ctx->priv;
     ff_framesync_uninit(&lut3d->fs);
+    av_freep(&lut3d->lut16);
 }
 
 static const AVOption haldclut_options[] = {
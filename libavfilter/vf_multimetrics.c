@@ -0,0 +1,509 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Calculate the PSNR and SSIM of several renditions against one reference
+ * in a single pass.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "framesync.h"
+#include "internal.h"
+#include "psnr.h"
+#include "ssim.h"
+#include "video.h"
+
+typedef struct Rendition {
+    struct SwsContext *sws;
+    AVFrame *scaled;
+    float *row_ssim[4];
+    double mse_comp[4], mse;
+    double ssim_comp[4], ssim;
+} Rendition;
+
+typedef struct MultiMetricsContext {
+    const AVClass *class;
+    FFFrameSync fs;
+    int nb_renditions;
+    int do_psnr;
+    int do_ssim;
+    char *flags_str;
+    char *stats_file_str;
+
+    FILE *stats_file;
+    int sws_flags;
+    uint64_t nb_frames;
+    Rendition *renditions;
+    AVFrame **cmp;
+    uint64_t *score;
+    uint8_t *temp;
+    int temp_size;
+    int nb_jobs;
+
+    int nb_components;
+    int depth;
+    int max;
+    char comps[4];
+    int planewidth[4];
+    int planeheight[4];
+    double planeweight[4];
+    PSNRDSPContext psnr_dsp;
+    SSIMDSPContext ssim_dsp;
+} MultiMetricsContext;
+
+#define OFFSET(x) offsetof(MultiMetricsContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+
+static const AVOption multimetrics_options[] = {
+    { "renditions", "set number of renditions", OFFSET(nb_renditions), AV_OPT_TYPE_INT, {.i64=2}, 1, INT_MAX, FLAGS },
+    { "psnr", "calculate PSNR", OFFSET(do_psnr), AV_OPT_TYPE_BOOL, {.i64=1}, 0, 1, FLAGS },
+    { "ssim", "calculate SSIM", OFFSET(do_ssim), AV_OPT_TYPE_BOOL, {.i64=1}, 0, 1, FLAGS },
+    { "flags", "set libswscale flags used to upscale the renditions", OFFSET(flags_str), AV_OPT_TYPE_STRING, {.str="bicubic"}, 0, 0, FLAGS },
+    { "stats_file", "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "f",          "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(multimetrics);
+
+static inline double get_psnr(double mse, uint64_t nb_frames, int max)
+{
+    return 10.0 * log10((double)max * max / (mse / nb_frames));
+}
+
+static double ssim_db(double ssim, double weight)
+{
+    return 10 * log10(weight / (weight - ssim));
+}
+
+static void set_meta(AVDictionary **metadata, int idx, const char *key, char comp,
+                     const char *fmt, double d)
+{
+    char key2[128];
+    char value[128];
+
+    snprintf(value, sizeof(value), fmt, d);
+    if (comp)
+        snprintf(key2, sizeof(key2), "lavfi.multimetrics.%d.%s%c", idx, key, comp);
+    else
+        snprintf(key2, sizeof(key2), "lavfi.multimetrics.%d.%s", idx, key);
+    av_dict_set(metadata, key2, value, 0);
+}
+
+static int metrics_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MultiMetricsContext *s = ctx->priv;
+    const AVFrame *ref = arg;
+    void *temp = s->temp + jobnr * s->temp_size;
+    int r, c, i;
+
+    for (r = 0; r < s->nb_renditions; r++) {
+        const AVFrame *in = s->cmp[r];
+        uint64_t *score = s->score + 4 * (jobnr * s->nb_renditions + r);
+
+        for (c = 0; c < s->nb_components; c++) {
+            const int w = s->planewidth[c];
+            const int h = s->planeheight[c];
+
+            if (s->do_psnr) {
+                const int slice_start = (h *  jobnr     ) / nb_jobs;
+                const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+                const uint8_t *main_line = in->data[c]  + slice_start * in->linesize[c];
+                const uint8_t *ref_line  = ref->data[c] + slice_start * ref->linesize[c];
+                uint64_t m = 0;
+
+                for (i = slice_start; i < slice_end; i++) {
+                    m += s->psnr_dsp.sse_line(main_line, ref_line, w);
+                    main_line += in->linesize[c];
+                    ref_line  += ref->linesize[c];
+                }
+                score[c] = m;
+            }
+
+            if (s->do_ssim) {
+                const int rows = (h >> 2) - 1;
+
+                ff_ssim_plane_rows(&s->ssim_dsp, s->depth,
+                                   in->data[c], in->linesize[c],
+                                   ref->data[c], ref->linesize[c], w, temp,
+                                   1 + (rows *  jobnr     ) / nb_jobs,
+                                   1 + (rows * (jobnr + 1)) / nb_jobs,
+                                   s->renditions[r].row_ssim[c]);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int do_metrics(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    MultiMetricsContext *s = ctx->priv;
+    AVFrame *ref, *in;
+    int ret, r, c, i;
+
+    if ((ret = ff_framesync_get_frame(fs, 0, &ref, 1)) < 0)
+        return ret;
+
+    /* upscale every rendition once; the reference planes are shared by all */
+    for (r = 0; r < s->nb_renditions; r++) {
+        Rendition *rd = &s->renditions[r];
+
+        if ((ret = ff_framesync_get_frame(fs, r + 1, &in, 0)) < 0)
+            goto fail;
+        if (rd->sws) {
+            sws_scale(rd->sws, (const uint8_t *const *)in->data, in->linesize,
+                      0, in->height, rd->scaled->data, rd->scaled->linesize);
+            s->cmp[r] = rd->scaled;
+        } else {
+            s->cmp[r] = in;
+        }
+    }
+
+    ctx->internal->execute(ctx, metrics_slice, ref, NULL, s->nb_jobs);
+
+    s->nb_frames++;
+
+    for (r = 0; r < s->nb_renditions; r++) {
+        Rendition *rd = &s->renditions[r];
+        double comp_mse[4], mse = 0;
+        float comp_ssim[4], ssim = 0;
+
+        if (s->do_psnr) {
+            for (c = 0; c < s->nb_components; c++) {
+                uint64_t m = 0;
+
+                for (i = 0; i < s->nb_jobs; i++)
+                    m += s->score[4 * (i * s->nb_renditions + r) + c];
+                comp_mse[c] = m / (double)(s->planewidth[c] * s->planeheight[c]);
+                mse += comp_mse[c] * s->planeweight[c];
+                rd->mse_comp[c] += comp_mse[c];
+                set_meta(&ref->metadata, r, "psnr.", s->comps[c], "%0.2f",
+                         get_psnr(comp_mse[c], 1, s->max));
+            }
+            rd->mse += mse;
+            set_meta(&ref->metadata, r, "mse_avg", 0, "%0.2f", mse);
+            set_meta(&ref->metadata, r, "psnr_avg", 0, "%0.2f", get_psnr(mse, 1, s->max));
+        }
+
+        if (s->do_ssim) {
+            for (c = 0; c < s->nb_components; c++) {
+                comp_ssim[c] = ff_ssim_plane_sum(rd->row_ssim[c], s->planewidth[c],
+                                                 s->planeheight[c]);
+                ssim += s->planeweight[c] * comp_ssim[c];
+                rd->ssim_comp[c] += comp_ssim[c];
+                set_meta(&ref->metadata, r, "ssim.", s->comps[c], "%f", comp_ssim[c]);
+            }
+            rd->ssim += ssim;
+            set_meta(&ref->metadata, r, "ssim_all", 0, "%f", ssim);
+            set_meta(&ref->metadata, r, "ssim_db", 0, "%0.2f", ssim_db(ssim, 1.0));
+        }
+
+        if (s->stats_file) {
+            fprintf(s->stats_file, "n:%"PRId64" rendition:%d", s->nb_frames, r);
+            if (s->do_psnr) {
+                fprintf(s->stats_file, " mse_avg:%0.2f psnr_avg:%0.2f",
+                        mse, get_psnr(mse, 1, s->max));
+                for (c = 0; c < s->nb_components; c++)
+                    fprintf(s->stats_file, " psnr_%c:%0.2f", s->comps[c],
+                            get_psnr(comp_mse[c], 1, s->max));
+            }
+            if (s->do_ssim) {
+                fprintf(s->stats_file, " ssim_all:%f", ssim);
+                for (c = 0; c < s->nb_components; c++)
+                    fprintf(s->stats_file, " ssim_%c:%f", s->comps[c], comp_ssim[c]);
+            }
+            fprintf(s->stats_file, "\n");
+        }
+    }
+
+    return ff_filter_frame(ctx->outputs[0], ref);
+
+fail:
+    av_frame_free(&ref);
+    return ret;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MultiMetricsContext *s = ctx->priv;
+    AVFilterPad pad = { 0 };
+    int i, ret;
+
+    if (!s->do_psnr && !s->do_ssim) {
+        av_log(ctx, AV_LOG_ERROR, "At least one metric must be enabled.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        ret = av_opt_eval_flags(&class, o, s->flags_str, &s->sws_flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (s->stats_file_str) {
+        if (!strcmp(s->stats_file_str, "-")) {
+            s->stats_file = stdout;
+        } else {
+            s->stats_file = fopen(s->stats_file_str, "w");
+            if (!s->stats_file) {
+                int err = AVERROR(errno);
+                char buf[128];
+                av_strerror(err, buf, sizeof(buf));
+                av_log(ctx, AV_LOG_ERROR, "Could not open stats file %s: %s\n",
+                       s->stats_file_str, buf);
+                return err;
+            }
+        }
+    }
+
+    s->renditions = av_calloc(s->nb_renditions, sizeof(*s->renditions));
+    s->cmp        = av_calloc(s->nb_renditions, sizeof(*s->cmp));
+    if (!s->renditions || !s->cmp)
+        return AVERROR(ENOMEM);
+
+    pad.type = AVMEDIA_TYPE_VIDEO;
+    pad.name = av_strdup("reference");
+    if (!pad.name)
+        return AVERROR(ENOMEM);
+    if ((ret = ff_insert_inpad(ctx, 0, &pad)) < 0) {
+        av_freep(&pad.name);
+        return ret;
+    }
+
+    for (i = 0; i < s->nb_renditions; i++) {
+        pad.name = av_asprintf("rendition%d", i);
+        if (!pad.name)
+            return AVERROR(ENOMEM);
+
+        if ((ret = ff_insert_inpad(ctx, i + 1, &pad)) < 0) {
+            av_freep(&pad.name);
+            return ret;
+        }
+    }
+
+    s->fs.on_event = do_metrics;
+    return 0;
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY9, AV_PIX_FMT_GRAY10,
+        AV_PIX_FMT_GRAY12, AV_PIX_FMT_GRAY14, AV_PIX_FMT_GRAY16,
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P,
+        AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV410P,
+        AV_PIX_FMT_YUVJ411P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P,
+        AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_YUVJ444P,
+        AV_PIX_FMT_GBRP,
+#define PF(suf) AV_PIX_FMT_YUV420##suf,  AV_PIX_FMT_YUV422##suf,  AV_PIX_FMT_YUV444##suf, AV_PIX_FMT_GBR##suf
+        PF(P9), PF(P10), PF(P12), PF(P14), PF(P16),
+        AV_PIX_FMT_NONE
+    };
+
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    MultiMetricsContext *s = ctx->priv;
+    AVFilterLink *reflink = ctx->inputs[0];
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(reflink->format);
+    FFFrameSyncIn *in;
+    unsigned sum = 0;
+    int i, ret;
+
+    s->nb_components = desc->nb_components;
+    s->depth = desc->comp[0].depth;
+    s->max = (1 << s->depth) - 1;
+
+    if (desc->flags & AV_PIX_FMT_FLAG_RGB) {
+        s->comps[0] = 'g';
+        s->comps[1] = 'b';
+        s->comps[2] = 'r';
+    } else {
+        s->comps[0] = 'y';
+        s->comps[1] = 'u';
+        s->comps[2] = 'v';
+    }
+
+    s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(reflink->h, desc->log2_chroma_h);
+    s->planeheight[0] = s->planeheight[3] = reflink->h;
+    s->planewidth[1]  = s->planewidth[2]  = AV_CEIL_RSHIFT(reflink->w, desc->log2_chroma_w);
+    s->planewidth[0]  = s->planewidth[3]  = reflink->w;
+    for (i = 0; i < s->nb_components; i++)
+        sum += s->planeheight[i] * s->planewidth[i];
+    for (i = 0; i < s->nb_components; i++)
+        s->planeweight[i] = (double) s->planeheight[i] * s->planewidth[i] / sum;
+
+    ff_psnr_init(&s->psnr_dsp, s->depth);
+    ff_ssim_init(&s->ssim_dsp);
+
+    s->nb_jobs = av_clip(ff_filter_get_nb_threads(ctx), 1,
+                         FFMAX((reflink->h >> 2) - 1, 1));
+    s->score = av_calloc(s->nb_jobs * s->nb_renditions, 4 * sizeof(*s->score));
+    s->temp_size = SSIM_TEMP_SIZE(reflink->w, s->depth);
+    s->temp = av_mallocz_array(s->nb_jobs, s->temp_size);
+    if (!s->score || !s->temp)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->nb_renditions; i++) {
+        AVFilterLink *inlink = ctx->inputs[i + 1];
+        Rendition *rd = &s->renditions[i];
+        int c;
+
+        for (c = 0; c < s->nb_components; c++) {
+            rd->row_ssim[c] = av_mallocz_array(FFMAX(s->planeheight[c] >> 2, 1),
+                                               sizeof(*rd->row_ssim[c]));
+            if (!rd->row_ssim[c])
+                return AVERROR(ENOMEM);
+        }
+
+        if (inlink->w == reflink->w && inlink->h == reflink->h)
+            continue;
+
+        av_log(ctx, AV_LOG_VERBOSE, "Upscaling rendition %d from %dx%d to %dx%d.\n",
+               i, inlink->w, inlink->h, reflink->w, reflink->h);
+        rd->sws = sws_getContext(inlink->w, inlink->h, inlink->format,
+                                 reflink->w, reflink->h, reflink->format,
+                                 s->sws_flags, NULL, NULL, NULL);
+        if (!rd->sws)
+            return AVERROR(EINVAL);
+
+        rd->scaled = av_frame_alloc();
+        if (!rd->scaled)
+            return AVERROR(ENOMEM);
+        rd->scaled->format = reflink->format;
+        rd->scaled->width  = reflink->w;
+        rd->scaled->height = reflink->h;
+        if ((ret = av_frame_get_buffer(rd->scaled, 32)) < 0)
+            return ret;
+    }
+
+    if ((ret = ff_framesync_init(&s->fs, ctx, s->nb_renditions + 1)) < 0)
+        return ret;
+
+    in = s->fs.in;
+    for (i = 0; i < ctx->nb_inputs; i++) {
+        in[i].time_base = ctx->inputs[i]->time_base;
+        in[i].sync   = 1;
+        in[i].before = EXT_STOP;
+        in[i].after  = EXT_STOP;
+    }
+
+    outlink->w = reflink->w;
+    outlink->h = reflink->h;
+    outlink->time_base = reflink->time_base;
+    outlink->sample_aspect_ratio = reflink->sample_aspect_ratio;
+    outlink->frame_rate = reflink->frame_rate;
+
+    return ff_framesync_configure(&s->fs);
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    MultiMetricsContext *s = ctx->priv;
+    return ff_framesync_activate(&s->fs);
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiMetricsContext *s = ctx->priv;
+    int i, c;
+
+    for (i = 0; s->renditions && i < s->nb_renditions; i++) {
+        Rendition *rd = &s->renditions[i];
+
+        if (s->nb_frames > 0) {
+            char buf[256];
+
+            buf[0] = 0;
+            if (s->do_psnr) {
+                av_strlcatf(buf, sizeof(buf), " PSNR");
+                for (c = 0; c < s->nb_components; c++)
+                    av_strlcatf(buf, sizeof(buf), " %c:%f", s->comps[c],
+                                get_psnr(rd->mse_comp[c], s->nb_frames, s->max));
+                av_strlcatf(buf, sizeof(buf), " average:%f",
+                            get_psnr(rd->mse, s->nb_frames, s->max));
+            }
+            if (s->do_ssim) {
+                av_strlcatf(buf, sizeof(buf), " SSIM");
+                for (c = 0; c < s->nb_components; c++)
+                    av_strlcatf(buf, sizeof(buf), " %c:%f", s->comps[c],
+                                rd->ssim_comp[c] / s->nb_frames);
+                av_strlcatf(buf, sizeof(buf), " All:%f (%f)", rd->ssim / s->nb_frames,
+                            ssim_db(rd->ssim, s->nb_frames));
+            }
+            av_log(ctx, AV_LOG_INFO, "rendition%d%s\n", i, buf);
+        }
+
+        sws_freeContext(rd->sws);
+        av_frame_free(&rd->scaled);
+        for (c = 0; c < 4; c++)
+            av_freep(&rd->row_ssim[c]);
+    }
+
+    ff_framesync_uninit(&s->fs);
+
+    if (s->stats_file && s->stats_file != stdout)
+        fclose(s->stats_file);
+
+    av_freep(&s->renditions);
+    av_freep(&s->cmp);
+    av_freep(&s->score);
+    av_freep(&s->temp);
+
+    for (i = 0; i < ctx->nb_inputs; i++)
+        av_freep(&ctx->input_pads[i].name);
+}
+
+static const AVFilterPad multimetrics_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_multimetrics = {
+    .name          = "multimetrics",
+    .description   = NULL_IF_CONFIG_SMALL("Calculate the PSNR and SSIM of several renditions against a reference."),
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .activate      = activate,
+    .priv_size     = sizeof(MultiMetricsContext),
+    .priv_class    = &multimetrics_class,
+    .outputs       = multimetrics_outputs,
+    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
+};
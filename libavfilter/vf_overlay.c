@@ -172,6 +172,13 @@ static int query_formats(AVFilterContext *ctx)
         AV_PIX_FMT_YUVA420P, AV_PIX_FMT_NONE
     };
 
+    static const enum AVPixelFormat main_pix_fmts_yuv420p10[] = {
+        AV_PIX_FMT_YUV420P10, AV_PIX_FMT_NONE
+    };
+    static const enum AVPixelFormat overlay_pix_fmts_yuv420p10[] = {
+        AV_PIX_FMT_YUVA420P10, AV_PIX_FMT_NONE
+    };
+
     static const enum AVPixelFormat main_pix_fmts_yuv422[] = {
         AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUVJ422P, AV_PIX_FMT_YUVA422P, AV_PIX_FMT_NONE
     };
@@ -179,6 +186,13 @@ static int query_formats(AVFilterContext *ctx)
         AV_PIX_FMT_YUVA422P, AV_PIX_FMT_NONE
     };
 
+    static const enum AVPixelFormat main_pix_fmts_yuv422p10[] = {
+        AV_PIX_FMT_YUV422P10, AV_PIX_FMT_NONE
+    };
+    static const enum AVPixelFormat overlay_pix_fmts_yuv422p10[] = {
+        AV_PIX_FMT_YUVA422P10, AV_PIX_FMT_NONE
+    };
+
     static const enum AVPixelFormat main_pix_fmts_yuv444[] = {
         AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUVJ444P, AV_PIX_FMT_YUVA444P, AV_PIX_FMT_NONE
     };
@@ -217,6 +231,13 @@ static int query_formats(AVFilterContext *ctx)
                 goto fail;
             }
         break;
+    case OVERLAY_FORMAT_YUV420P10:
+        if (!(main_formats    = ff_make_format_list(main_pix_fmts_yuv420p10)) ||
+            !(overlay_formats = ff_make_format_list(overlay_pix_fmts_yuv420p10))) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+        break;
     case OVERLAY_FORMAT_YUV422:
         if (!(main_formats    = ff_make_format_list(main_pix_fmts_yuv422)) ||
             !(overlay_formats = ff_make_format_list(overlay_pix_fmts_yuv422))) {
@@ -224,6 +245,13 @@ static int query_formats(AVFilterContext *ctx)
                 goto fail;
             }
         break;
+    case OVERLAY_FORMAT_YUV422P10:
+        if (!(main_formats    = ff_make_format_list(main_pix_fmts_yuv422p10)) ||
+            !(overlay_formats = ff_make_format_list(overlay_pix_fmts_yuv422p10))) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+        break;
     case OVERLAY_FORMAT_YUV444:
         if (!(main_formats    = ff_make_format_list(main_pix_fmts_yuv444)) ||
             !(overlay_formats = ff_make_format_list(overlay_pix_fmts_yuv444))) {
@@ -350,6 +378,50 @@ static int config_output(AVFilterLink *outlink)
 // ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)) is a faster version of: 255 * (x + y)
 #define UNPREMULTIPLY_ALPHA(x, y) ((((x) << 16) - ((x) << 9) + (x)) / ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)))
 
+/**
+ * Straight alpha blending of one row of an 8-bit plane, without alpha
+ * in the main input. The chroma variants average the alpha of the
+ * 2x2 (20) or 2x1 (22) luma block and leave the last pixel of the row
+ * to the generic code. Return the number of pixels processed.
+ */
+static int overlay_row_44_c(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                            int w, ptrdiff_t alinesize)
+{
+    int x;
+
+    for (x = 0; x < w; x++)
+        d[x] = FAST_DIV255(d[x] * (255 - a[x]) + s[x] * a[x]);
+
+    return w;
+}
+
+static int overlay_row_20_c(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                            int w, ptrdiff_t alinesize)
+{
+    int x;
+
+    for (x = 0; x < w - 1; x++) {
+        int alpha = (a[2 * x] + a[2 * x + alinesize] +
+                     a[2 * x + 1] + a[2 * x + alinesize + 1]) >> 2;
+        d[x] = FAST_DIV255(d[x] * (255 - alpha) + s[x] * alpha);
+    }
+
+    return FFMAX(w - 1, 0);
+}
+
+static int overlay_row_22_c(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                            int w, ptrdiff_t alinesize)
+{
+    int x;
+
+    for (x = 0; x < w - 1; x++) {
+        int alpha = (a[2 * x] + ((a[2 * x] + a[2 * x + 1]) >> 1)) >> 1;
+        d[x] = FAST_DIV255(d[x] * (255 - alpha) + s[x] * alpha);
+    }
+
+    return FFMAX(w - 1, 0);
+}
+
 /**
  * Blend image in src to destination buffer dst at position (x, y).
  */
@@ -550,6 +622,93 @@ static av_always_inline void blend_plane(AVFilterContext *ctx,
     }
 }
 
+static av_always_inline void blend_plane16(AVFilterContext *ctx,
+                                           AVFrame *dst, const AVFrame *src,
+                                           int src_w, int src_h,
+                                           int dst_w, int dst_h,
+                                           int i, int hsub, int vsub,
+                                           int x, int y,
+                                           int dst_plane,
+                                           int dst_offset,
+                                           int dst_step,
+                                           int straight,
+                                           int yuv,
+                                           int depth,
+                                           int jobnr,
+                                           int nb_jobs)
+{
+    const int max = (1 << depth) - 1;
+    const int mid = 1 << (depth - 1);
+    const ptrdiff_t alinesize = src->linesize[3] / 2;
+    int src_wp = AV_CEIL_RSHIFT(src_w, hsub);
+    int src_hp = AV_CEIL_RSHIFT(src_h, vsub);
+    int dst_wp = AV_CEIL_RSHIFT(dst_w, hsub);
+    int dst_hp = AV_CEIL_RSHIFT(dst_h, vsub);
+    int yp = y>>vsub;
+    int xp = x>>hsub;
+    const uint8_t *sp, *ap;
+    uint8_t *dp;
+    int jmax, j, k, kmax;
+    int slice_start, slice_end;
+
+    dst_step /= 2;
+
+    j = FFMAX(-yp, 0);
+    jmax = FFMIN3(-yp + dst_hp, FFMIN(src_hp, dst_hp), yp + src_hp);
+
+    slice_start = j + (jmax * jobnr) / nb_jobs;
+    slice_end = j + (jmax * (jobnr+1)) / nb_jobs;
+
+    sp = src->data[i] + (slice_start) * src->linesize[i];
+    dp = dst->data[dst_plane]
+                      + (yp + slice_start) * dst->linesize[dst_plane]
+                      + dst_offset;
+    ap = src->data[3] + (slice_start << vsub) * src->linesize[3];
+
+    for (j = slice_start; j < slice_end; j++) {
+        const uint16_t *s, *a;
+        uint16_t *d;
+
+        k = FFMAX(-xp, 0);
+        d = (uint16_t *)dp + (xp+k) * dst_step;
+        s = (const uint16_t *)sp + k;
+        a = (const uint16_t *)ap + (k<<hsub);
+        kmax = FFMIN(-xp + dst_wp, src_wp);
+
+        for (; k < kmax; k++) {
+            int alpha_v, alpha_h, alpha;
+
+            // average alpha for color components, improve quality
+            if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {
+                alpha = (a[0] + a[alinesize] +
+                         a[1] + a[alinesize+1]) >> 2;
+            } else if (hsub || vsub) {
+                alpha_h = hsub && k+1 < src_wp ?
+                    (a[0] + a[1]) >> 1 : a[0];
+                alpha_v = vsub && j+1 < src_hp ?
+                    (a[0] + a[alinesize]) >> 1 : a[0];
+                alpha = (alpha_v + alpha_h) >> 1;
+            } else
+                alpha = a[0];
+
+            if (straight) {
+                *d = (*d * (max - alpha) + *s * alpha + (max >> 1)) / max;
+            } else {
+                if (i && yuv)
+                    *d = av_clip_uintp2((*d - mid) * (max - alpha) / max + *s, depth);
+                else
+                    *d = FFMIN((*d * (max - alpha) + (max >> 1)) / max + *s, max);
+            }
+            s++;
+            d += dst_step;
+            a += 1 << hsub;
+        }
+        dp += dst->linesize[dst_plane];
+        sp += src->linesize[i];
+        ap += (1 << vsub) * src->linesize[3];
+    }
+}
+
 static inline void alpha_composite(const AVFrame *src, const AVFrame *dst,
                                    int src_w, int src_h,
                                    int dst_w, int dst_h,
@@ -626,6 +785,31 @@ static av_always_inline void blend_slice_yuv(AVFilterContext *ctx,
         alpha_composite(src, dst, src_w, src_h, dst_w, dst_h, x, y, jobnr, nb_jobs);
 }
 
+static av_always_inline void blend_slice_yuv16(AVFilterContext *ctx,
+                                               AVFrame *dst, const AVFrame *src,
+                                               int hsub, int vsub,
+                                               int x, int y,
+                                               int is_straight,
+                                               int depth,
+                                               int jobnr, int nb_jobs)
+{
+    OverlayContext *s = ctx->priv;
+    const int src_w = src->width;
+    const int src_h = src->height;
+    const int dst_w = dst->width;
+    const int dst_h = dst->height;
+
+    blend_plane16(ctx, dst, src, src_w, src_h, dst_w, dst_h, 0, 0,       0, x, y,
+                  s->main_desc->comp[0].plane, s->main_desc->comp[0].offset, s->main_desc->comp[0].step, is_straight, 1,
+                  depth, jobnr, nb_jobs);
+    blend_plane16(ctx, dst, src, src_w, src_h, dst_w, dst_h, 1, hsub, vsub, x, y,
+                  s->main_desc->comp[1].plane, s->main_desc->comp[1].offset, s->main_desc->comp[1].step, is_straight, 1,
+                  depth, jobnr, nb_jobs);
+    blend_plane16(ctx, dst, src, src_w, src_h, dst_w, dst_h, 2, hsub, vsub, x, y,
+                  s->main_desc->comp[2].plane, s->main_desc->comp[2].offset, s->main_desc->comp[2].step, is_straight, 1,
+                  depth, jobnr, nb_jobs);
+}
+
 static av_always_inline void blend_slice_planar_rgb(AVFilterContext *ctx,
                                                     AVFrame *dst, const AVFrame *src,
                                                     int hsub, int vsub,
@@ -671,6 +855,38 @@ static int blend_slice_yuva420(AVFilterContext *ctx, void *arg, int jobnr, int n
     return 0;
 }
 
+static int blend_slice_yuv420p10(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OverlayContext *s = ctx->priv;
+    ThreadData *td = arg;
+    blend_slice_yuv16(ctx, td->dst, td->src, 1, 1, s->x, s->y, 1, 10, jobnr, nb_jobs);
+    return 0;
+}
+
+static int blend_slice_yuv422p10(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OverlayContext *s = ctx->priv;
+    ThreadData *td = arg;
+    blend_slice_yuv16(ctx, td->dst, td->src, 1, 0, s->x, s->y, 1, 10, jobnr, nb_jobs);
+    return 0;
+}
+
+static int blend_slice_yuv420p10_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OverlayContext *s = ctx->priv;
+    ThreadData *td = arg;
+    blend_slice_yuv16(ctx, td->dst, td->src, 1, 1, s->x, s->y, 0, 10, jobnr, nb_jobs);
+    return 0;
+}
+
+static int blend_slice_yuv422p10_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OverlayContext *s = ctx->priv;
+    ThreadData *td = arg;
+    blend_slice_yuv16(ctx, td->dst, td->src, 1, 0, s->x, s->y, 0, 10, jobnr, nb_jobs);
+    return 0;
+}
+
 static int blend_slice_yuv422(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     OverlayContext *s = ctx->priv;
@@ -815,6 +1031,38 @@ static int blend_slice_rgba_pm(AVFilterContext *ctx, void *arg, int jobnr, int n
     return 0;
 }
 
+av_cold void ff_overlay_init(OverlayContext *s, int format, int pix_format,
+                             int alpha_format, int main_has_alpha)
+{
+    memset(s->blend_row, 0, sizeof(s->blend_row));
+
+    if (!alpha_format && !main_has_alpha) {
+        switch (format) {
+        case OVERLAY_FORMAT_YUV420:
+            if (pix_format != AV_PIX_FMT_YUV420P)
+                break;
+            s->blend_row[0] = overlay_row_44_c;
+            s->blend_row[1] = overlay_row_20_c;
+            s->blend_row[2] = overlay_row_20_c;
+            break;
+        case OVERLAY_FORMAT_YUV422:
+            s->blend_row[0] = overlay_row_44_c;
+            s->blend_row[1] = overlay_row_22_c;
+            s->blend_row[2] = overlay_row_22_c;
+            break;
+        case OVERLAY_FORMAT_YUV444:
+        case OVERLAY_FORMAT_GBRP:
+            s->blend_row[0] = overlay_row_44_c;
+            s->blend_row[1] = overlay_row_44_c;
+            s->blend_row[2] = overlay_row_44_c;
+            break;
+        }
+    }
+
+    if (ARCH_X86)
+        ff_overlay_init_x86(s, format, pix_format, alpha_format, main_has_alpha);
+}
+
 static int config_input_main(AVFilterLink *inlink)
 {
     OverlayContext *s = inlink->dst->priv;
@@ -834,9 +1082,15 @@ static int config_input_main(AVFilterLink *inlink)
     case OVERLAY_FORMAT_YUV420:
         s->blend_slice = s->main_has_alpha ? blend_slice_yuva420 : blend_slice_yuv420;
         break;
+    case OVERLAY_FORMAT_YUV420P10:
+        s->blend_slice = blend_slice_yuv420p10;
+        break;
     case OVERLAY_FORMAT_YUV422:
         s->blend_slice = s->main_has_alpha ? blend_slice_yuva422 : blend_slice_yuv422;
         break;
+    case OVERLAY_FORMAT_YUV422P10:
+        s->blend_slice = blend_slice_yuv422p10;
+        break;
     case OVERLAY_FORMAT_YUV444:
         s->blend_slice = s->main_has_alpha ? blend_slice_yuva444 : blend_slice_yuv444;
         break;
@@ -880,9 +1134,15 @@ static int config_input_main(AVFilterLink *inlink)
     case OVERLAY_FORMAT_YUV420:
         s->blend_slice = s->main_has_alpha ? blend_slice_yuva420_pm : blend_slice_yuv420_pm;
         break;
+    case OVERLAY_FORMAT_YUV420P10:
+        s->blend_slice = blend_slice_yuv420p10_pm;
+        break;
     case OVERLAY_FORMAT_YUV422:
         s->blend_slice = s->main_has_alpha ? blend_slice_yuva422_pm : blend_slice_yuv422_pm;
         break;
+    case OVERLAY_FORMAT_YUV422P10:
+        s->blend_slice = blend_slice_yuv422p10_pm;
+        break;
     case OVERLAY_FORMAT_YUV444:
         s->blend_slice = s->main_has_alpha ? blend_slice_yuva444_pm : blend_slice_yuv444_pm;
         break;
@@ -920,9 +1180,8 @@ static int config_input_main(AVFilterLink *inlink)
     }
 
 end:
-    if (ARCH_X86)
-        ff_overlay_init_x86(s, s->format, inlink->format,
-                            s->alpha_format, s->main_has_alpha);
+    ff_overlay_init(s, s->format, inlink->format,
+                    s->alpha_format, s->main_has_alpha);
 
     return 0;
 }
@@ -1005,7 +1264,9 @@ static const AVOption overlay_options[] = {
     { "shortest", "force termination when the shortest input terminates", OFFSET(fs.opt_shortest), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
     { "format", "set output format", OFFSET(format), AV_OPT_TYPE_INT, {.i64=OVERLAY_FORMAT_YUV420}, 0, OVERLAY_FORMAT_NB-1, FLAGS, "format" },
         { "yuv420", "", 0, AV_OPT_TYPE_CONST, {.i64=OVERLAY_FORMAT_YUV420}, .flags = FLAGS, .unit = "format" },
+        { "yuv420p10", "", 0, AV_OPT_TYPE_CONST, {.i64=OVERLAY_FORMAT_YUV420P10}, .flags = FLAGS, .unit = "format" },
         { "yuv422", "", 0, AV_OPT_TYPE_CONST, {.i64=OVERLAY_FORMAT_YUV422}, .flags = FLAGS, .unit = "format" },
+        { "yuv422p10", "", 0, AV_OPT_TYPE_CONST, {.i64=OVERLAY_FORMAT_YUV422P10}, .flags = FLAGS, .unit = "format" },
         { "yuv444", "", 0, AV_OPT_TYPE_CONST, {.i64=OVERLAY_FORMAT_YUV444}, .flags = FLAGS, .unit = "format" },
         { "rgb",    "", 0, AV_OPT_TYPE_CONST, {.i64=OVERLAY_FORMAT_RGB},    .flags = FLAGS, .unit = "format" },
         { "gbrp",   "", 0, AV_OPT_TYPE_CONST, {.i64=OVERLAY_FORMAT_GBRP},   .flags = FLAGS, .unit = "format" },
@@ -45,6 +45,8 @@ enum OverlayFormat {
     OVERLAY_FORMAT_YUV444,
     OVERLAY_FORMAT_RGB,
     OVERLAY_FORMAT_GBRP,
+    OVERLAY_FORMAT_YUV420P10,
+    OVERLAY_FORMAT_YUV422P10,
     OVERLAY_FORMAT_AUTO,
     OVERLAY_FORMAT_NB
 };
@@ -80,6 +82,8 @@ typedef struct OverlayContext {
     int (*blend_slice)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 } OverlayContext;
 
+void ff_overlay_init(OverlayContext *s, int format, int pix_format,
+                     int alpha_format, int main_has_alpha);
 void ff_overlay_init_x86(OverlayContext *s, int format, int pix_format,
                          int alpha_format, int main_has_alpha);
 
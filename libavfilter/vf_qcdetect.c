@@ -0,0 +1,549 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Video quality control filter, running the black, freeze and crop
+ * detections of blackdetect, freezedetect and cropdetect in a single pass
+ * over each frame.
+ */
+
+#include <float.h>
+
+#include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/timestamp.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "qcdetect.h"
+#include "scene_sad.h"
+
+enum QCDetection {
+    QC_BLACK  = 1 << 0,
+    QC_FREEZE = 1 << 1,
+    QC_CROP   = 1 << 2,
+};
+
+typedef struct QCDetectContext {
+    const AVClass *class;
+    int detect;
+
+    /* black detection */
+    double black_min_duration_time;
+    double picture_black_ratio_th;
+    double pixel_black_th;
+    unsigned pixel_black_th_i;
+    int64_t black_min_duration;     ///< in timebase units
+    int64_t black_start;
+    int black_started;
+    int nb_black;                   ///< number of reported black intervals
+    int64_t black_total;            ///< total duration of the reported black intervals, in timebase units
+
+    /* freeze detection */
+    double noise;
+    int64_t freeze_min_duration;    ///< in AV_TIME_BASE units
+    AVFrame *reference_frame;
+    int64_t n;
+    int64_t reference_n;
+    int frozen;
+    int nb_freeze;                  ///< number of reported frozen intervals
+    int64_t freeze_total;           ///< total duration of the reported frozen intervals, in AV_TIME_BASE units
+
+    /* crop detection */
+    float limit;
+    int round;
+    int reset_count;
+    int max_outliers;
+    int x1, y1, x2, y2;
+    int frame_nb;
+
+    int depth;
+    ptrdiff_t width[4];             ///< plane widths in samples
+    int height[4];
+    int64_t last_pts;
+    int64_t last_duration;          ///< duration of the last frame, in link time base
+    QCDetectDSPContext dsp;
+    ff_scene_sad_fn sad;
+
+    int nb_jobs;
+    unsigned *black_counts;         ///< per job number of black pixels
+    uint64_t *sads;                 ///< per job sum of absolute differences to the reference frame
+    uint32_t *row_sums;
+    uint32_t *col_sums;             ///< per job column sums, the first job holds the total
+} QCDetectContext;
+
+#define OFFSET(x) offsetof(QCDetectContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption qcdetect_options[] = {
+    { "detect", "set the detections to run", OFFSET(detect), AV_OPT_TYPE_FLAGS, {.i64=QC_BLACK|QC_FREEZE|QC_CROP}, 0, QC_BLACK|QC_FREEZE|QC_CROP, FLAGS, "detect" },
+        { "black",  "detect black intervals",  0, AV_OPT_TYPE_CONST, {.i64=QC_BLACK},  0, 0, FLAGS, "detect" },
+        { "freeze", "detect frozen intervals", 0, AV_OPT_TYPE_CONST, {.i64=QC_FREEZE}, 0, 0, FLAGS, "detect" },
+        { "crop",   "detect the crop area",    0, AV_OPT_TYPE_CONST, {.i64=QC_CROP},   0, 0, FLAGS, "detect" },
+    { "black_min_duration", "set minimum detected black duration in seconds", OFFSET(black_min_duration_time), AV_OPT_TYPE_DOUBLE, {.dbl=2}, 0, DBL_MAX, FLAGS },
+    { "bd",                 "set minimum detected black duration in seconds", OFFSET(black_min_duration_time), AV_OPT_TYPE_DOUBLE, {.dbl=2}, 0, DBL_MAX, FLAGS },
+    { "picture_black_ratio_th", "set the picture black ratio threshold", OFFSET(picture_black_ratio_th), AV_OPT_TYPE_DOUBLE, {.dbl=.98}, 0, 1, FLAGS },
+    { "pic_th",                 "set the picture black ratio threshold", OFFSET(picture_black_ratio_th), AV_OPT_TYPE_DOUBLE, {.dbl=.98}, 0, 1, FLAGS },
+    { "pixel_black_th", "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
+    { "pix_th",         "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
+    { "freeze_noise", "set freeze noise tolerance", OFFSET(noise), AV_OPT_TYPE_DOUBLE, {.dbl=0.001}, 0, 1.0, FLAGS },
+    { "fn",           "set freeze noise tolerance", OFFSET(noise), AV_OPT_TYPE_DOUBLE, {.dbl=0.001}, 0, 1.0, FLAGS },
+    { "freeze_duration", "set minimum freeze duration in seconds", OFFSET(freeze_min_duration), AV_OPT_TYPE_DURATION, {.i64=2000000}, 0, INT64_MAX, FLAGS },
+    { "fd",              "set minimum freeze duration in seconds", OFFSET(freeze_min_duration), AV_OPT_TYPE_DURATION, {.i64=2000000}, 0, INT64_MAX, FLAGS },
+    { "crop_limit", "set the threshold below which the pixel is considered black", OFFSET(limit), AV_OPT_TYPE_FLOAT, {.dbl=24.0/255}, 0, 65535, FLAGS },
+    { "crop_round", "set the value by which the width/height should be divisible", OFFSET(round), AV_OPT_TYPE_INT, {.i64=16}, 0, INT_MAX, FLAGS },
+    { "crop_reset", "recalculate the crop area after this many frames", OFFSET(reset_count), AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
+    { "crop_max_outliers", "set the threshold count of outliers", OFFSET(max_outliers), AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(qcdetect);
+
+#define YUVJ_FORMATS \
+    AV_PIX_FMT_YUVJ411P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P, AV_PIX_FMT_YUVJ444P, AV_PIX_FMT_YUVJ440P
+
+static const enum AVPixelFormat yuvj_formats[] = {
+    YUVJ_FORMATS, AV_PIX_FMT_NONE
+};
+
+static int query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY9, AV_PIX_FMT_GRAY10,
+        AV_PIX_FMT_GRAY12, AV_PIX_FMT_GRAY14, AV_PIX_FMT_GRAY16,
+        AV_PIX_FMT_YUV410P, AV_PIX_FMT_YUV411P,
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P,
+        AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV444P,
+        YUVJ_FORMATS,
+        AV_PIX_FMT_YUV420P9,  AV_PIX_FMT_YUV422P9,  AV_PIX_FMT_YUV444P9,
+        AV_PIX_FMT_YUV420P10, AV_PIX_FMT_YUV422P10, AV_PIX_FMT_YUV444P10,
+        AV_PIX_FMT_YUV420P12, AV_PIX_FMT_YUV422P12, AV_PIX_FMT_YUV444P12,
+        AV_PIX_FMT_YUV420P14, AV_PIX_FMT_YUV422P14, AV_PIX_FMT_YUV444P14,
+        AV_PIX_FMT_YUV420P16, AV_PIX_FMT_YUV422P16, AV_PIX_FMT_YUV444P16,
+        AV_PIX_FMT_NONE
+    };
+
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    QCDetectContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    const int full_range = ff_fmt_is_in(inlink->format, yuvj_formats);
+    int plane;
+
+    s->depth = desc->comp[0].depth;
+    for (plane = 0; plane < 4; plane++) {
+        ptrdiff_t line_size = av_image_get_linesize(inlink->format, inlink->w, plane);
+        s->width[plane]  = FFMAX(line_size, 0) >> (s->depth > 8);
+        s->height[plane] = plane == 1 || plane == 2 ? AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h) : inlink->h;
+    }
+
+    s->black_min_duration = s->black_min_duration_time / av_q2d(inlink->time_base);
+    // luminance_minimum_value + pixel_black_th * luminance_range_size
+    s->pixel_black_th_i = full_range ? s->pixel_black_th * ((1 << s->depth) - 1) :
+                          (16 << (s->depth - 8)) + s->pixel_black_th * (219 << (s->depth - 8));
+
+    if (s->limit < 1.0)
+        s->limit *= (1 << s->depth) - 1;
+    s->x1 = inlink->w - 1;
+    s->y1 = inlink->h - 1;
+    s->x2 = 0;
+    s->y2 = 0;
+    s->frame_nb = -2;
+    s->last_pts = AV_NOPTS_VALUE;
+
+    ff_qcdetect_init(&s->dsp, s->depth > 8 ? 2 : 1);
+    s->sad = ff_scene_sad_get_fn(s->depth > 8 ? 16 : 8);
+    if (!s->sad)
+        return AVERROR(EINVAL);
+
+    s->nb_jobs = FFMAX(1, FFMIN(inlink->h, ff_filter_get_nb_threads(ctx)));
+    av_freep(&s->black_counts);
+    av_freep(&s->sads);
+    av_freep(&s->row_sums);
+    av_freep(&s->col_sums);
+    s->black_counts = av_calloc(s->nb_jobs, sizeof(*s->black_counts));
+    s->sads         = av_calloc(s->nb_jobs, sizeof(*s->sads));
+    s->row_sums     = av_malloc_array(inlink->h, sizeof(*s->row_sums));
+    s->col_sums     = av_malloc_array(s->nb_jobs, inlink->w * sizeof(*s->col_sums));
+    if (!s->black_counts || !s->sads || !s->row_sums || !s->col_sums)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+typedef struct ThreadData {
+    AVFrame *frame;
+    AVFrame *reference;
+    int crop;
+} ThreadData;
+
+static int analyze_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    QCDetectContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    AVFrame *ref = td->reference;
+    const int black = s->detect & QC_BLACK;
+    const int slice_start = (frame->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (frame->height * (jobnr + 1)) / nb_jobs;
+    uint32_t *col_sum = s->col_sums + jobnr * frame->width;
+    unsigned count = 0;
+    uint64_t sad = 0;
+    int plane, y;
+
+    if (td->crop)
+        memset(col_sum, 0, frame->width * sizeof(*col_sum));
+
+    /* all luma analyses run on a row while it is in cache */
+    for (y = slice_start; y < slice_end; y++) {
+        const uint8_t *src = frame->data[0] + y * frame->linesize[0];
+
+        if (black)
+            count += s->dsp.count_black(src, frame->width, s->pixel_black_th_i);
+        if (td->crop) {
+            s->row_sums[y] = s->dsp.row_sum(src, frame->width);
+            s->dsp.col_sum(col_sum, src, frame->width);
+        }
+        if (ref) {
+            uint64_t line_sad;
+            s->sad(src, frame->linesize[0], ref->data[0] + y * ref->linesize[0],
+                   ref->linesize[0], s->width[0], 1, &line_sad);
+            sad += line_sad;
+        }
+    }
+
+    for (plane = 1; ref && plane < 4; plane++) {
+        const int start = (s->height[plane] *  jobnr     ) / nb_jobs;
+        const int end   = (s->height[plane] * (jobnr + 1)) / nb_jobs;
+        uint64_t plane_sad;
+
+        if (!s->width[plane] || start == end)
+            continue;
+        s->sad(frame->data[plane] + start * frame->linesize[plane], frame->linesize[plane],
+               ref->data[plane] + start * ref->linesize[plane], ref->linesize[plane],
+               s->width[plane], end - start, &plane_sad);
+        sad += plane_sad;
+    }
+    emms_c();
+
+    s->black_counts[jobnr] = count;
+    s->sads[jobnr] = sad;
+    return 0;
+}
+
+static void check_black_end(AVFilterContext *ctx, int64_t black_end)
+{
+    QCDetectContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    if (black_end - s->black_start >= s->black_min_duration) {
+        av_log(ctx, AV_LOG_INFO,
+               "black_start:%s black_end:%s black_duration:%s\n",
+               av_ts2timestr(s->black_start, &inlink->time_base),
+               av_ts2timestr(black_end, &inlink->time_base),
+               av_ts2timestr(black_end - s->black_start, &inlink->time_base));
+        s->nb_black++;
+        s->black_total += black_end - s->black_start;
+    }
+}
+
+static void detect_black(AVFilterContext *ctx, AVFrame *frame, double ratio)
+{
+    QCDetectContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    char buf[32];
+
+    snprintf(buf, sizeof(buf), "%f", ratio);
+    av_dict_set(&frame->metadata, "lavfi.qcdetect.black_ratio", buf, 0);
+
+    if (ratio >= s->picture_black_ratio_th) {
+        if (!s->black_started) {
+            s->black_started = 1;
+            s->black_start = frame->pts;
+            av_dict_set(&frame->metadata, "lavfi.black_start",
+                        av_ts2timestr(s->black_start, &inlink->time_base), 0);
+        }
+    } else if (s->black_started) {
+        s->black_started = 0;
+        check_black_end(ctx, frame->pts);
+        av_dict_set(&frame->metadata, "lavfi.black_end",
+                    av_ts2timestr(frame->pts, &inlink->time_base), 0);
+    }
+}
+
+static void set_meta(AVFilterContext *ctx, AVFrame *frame, const char *key, const char *value)
+{
+    av_log(ctx, AV_LOG_INFO, "%s: %s\n", key, value);
+    av_dict_set(&frame->metadata, key, value, 0);
+}
+
+static int64_t freeze_duration(AVFilterContext *ctx, AVFrame *frame)
+{
+    QCDetectContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    if (s->reference_frame->pts == AV_NOPTS_VALUE || frame->pts == AV_NOPTS_VALUE || frame->pts < s->reference_frame->pts)
+        return inlink->frame_rate.num > 0 ? av_rescale_q(s->n - s->reference_n, av_inv_q(inlink->frame_rate), AV_TIME_BASE_Q) : 0;
+    return av_rescale_q(frame->pts - s->reference_frame->pts, inlink->time_base, AV_TIME_BASE_Q);
+}
+
+static int detect_freeze(AVFilterContext *ctx, AVFrame *frame, uint64_t sad)
+{
+    QCDetectContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    int frozen = 0;
+
+    s->n++;
+    if (s->reference_frame) {
+        int64_t duration = freeze_duration(ctx, frame);
+        uint64_t count = 0;
+        double mafd;
+        char buf[32];
+        int plane;
+
+        for (plane = 0; plane < 4; plane++)
+            count += s->width[plane] * s->height[plane];
+        mafd = (double)sad / count / (1ULL << s->depth);
+        snprintf(buf, sizeof(buf), "%f", mafd);
+        av_dict_set(&frame->metadata, "lavfi.qcdetect.mafd", buf, 0);
+
+        frozen = mafd <= s->noise;
+        if (duration >= s->freeze_min_duration) {
+            if (!s->frozen)
+                set_meta(ctx, frame, "lavfi.freezedetect.freeze_start", av_ts2timestr(s->reference_frame->pts, &inlink->time_base));
+            if (!frozen) {
+                set_meta(ctx, frame, "lavfi.freezedetect.freeze_duration", av_ts2timestr(duration, &AV_TIME_BASE_Q));
+                set_meta(ctx, frame, "lavfi.freezedetect.freeze_end", av_ts2timestr(frame->pts, &inlink->time_base));
+                s->nb_freeze++;
+                s->freeze_total += duration;
+            }
+            s->frozen = frozen;
+        }
+    }
+
+    if (!frozen) {
+        av_frame_free(&s->reference_frame);
+        s->reference_frame = av_frame_clone(frame);
+        s->reference_n = s->n;
+        if (!s->reference_frame)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+#define SET_META(key, value) \
+    av_dict_set_int(&frame->metadata, key, value, 0)
+
+static void detect_crop(AVFilterContext *ctx, AVFrame *frame)
+{
+    QCDetectContext *s = ctx->priv;
+    const int limit = lrint(s->limit);
+    int outliers, edge;
+    int i, x, y, w, h;
+
+    for (i = 1; i < s->nb_jobs; i++) {
+        const uint32_t *sum = s->col_sums + i * frame->width;
+        for (x = 0; x < frame->width; x++)
+            s->col_sums[x] += sum[x];
+    }
+
+    if (s->reset_count > 0 && s->frame_nb > s->reset_count) {
+        s->x1 = frame->width  - 1;
+        s->y1 = frame->height - 1;
+        s->x2 = 0;
+        s->y2 = 0;
+        s->frame_nb = 1;
+    }
+
+#define FIND(DST, SUMS, DIV, FROM, TO)                                        \
+    outliers = 0;                                                             \
+    edge = FROM;                                                              \
+    if (ff_qcdetect_find_edge(SUMS, DIV, limit, s->max_outliers,              \
+                              FROM, TO, &outliers, &edge))                    \
+        DST = edge;
+
+    FIND(s->y1, s->row_sums, frame->width,  0,                 s->y1);
+    FIND(s->y2, s->row_sums, frame->width,  frame->height - 1, FFMAX(s->y2, s->y1));
+    FIND(s->x1, s->col_sums, frame->height, 0,                 s->x1);
+    FIND(s->x2, s->col_sums, frame->height, frame->width - 1,  FFMAX(s->x2, s->x1));
+
+    ff_qcdetect_crop_area(s->x1, s->y1, s->x2, s->y2, s->round, &x, &y, &w, &h);
+
+    SET_META("lavfi.cropdetect.x1", s->x1);
+    SET_META("lavfi.cropdetect.x2", s->x2);
+    SET_META("lavfi.cropdetect.y1", s->y1);
+    SET_META("lavfi.cropdetect.y2", s->y2);
+    SET_META("lavfi.cropdetect.w",  w);
+    SET_META("lavfi.cropdetect.h",  h);
+    SET_META("lavfi.cropdetect.x",  x);
+    SET_META("lavfi.cropdetect.y",  y);
+
+    av_log(ctx, AV_LOG_DEBUG, "crop=%d:%d:%d:%d\n", w, h, x, y);
+}
+
+static int filter_frame(AVFilterContext *ctx, AVFrame *frame)
+{
+    QCDetectContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    ThreadData td = { 0 };
+    uint64_t sad = 0;
+    unsigned count = 0;
+    int i, ret;
+
+    td.frame     = frame;
+    td.reference = s->detect & QC_FREEZE ? s->reference_frame : NULL;
+    td.crop      = s->detect & QC_CROP && ++s->frame_nb > 0;
+
+    ctx->internal->execute(ctx, analyze_slice, &td, NULL, s->nb_jobs);
+    for (i = 0; i < s->nb_jobs; i++) {
+        count += s->black_counts[i];
+        sad   += s->sads[i];
+    }
+
+    if (s->detect & QC_BLACK)
+        detect_black(ctx, frame, (double)count / (inlink->w * inlink->h));
+    if (s->detect & QC_FREEZE) {
+        ret = detect_freeze(ctx, frame, sad);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
+    }
+    if (td.crop)
+        detect_crop(ctx, frame);
+
+    s->last_pts = frame->pts;
+    if (frame->pkt_duration > 0)
+        s->last_duration = frame->pkt_duration;
+    else if (inlink->frame_rate.num && inlink->frame_rate.den)
+        s->last_duration = av_rescale_q(1, av_inv_q(inlink->frame_rate), inlink->time_base);
+    else
+        s->last_duration = 0;
+    return ff_filter_frame(ctx->outputs[0], frame);
+}
+
+static void print_summary(AVFilterContext *ctx)
+{
+    QCDetectContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    if (s->detect & QC_BLACK) {
+        if (s->black_started) {
+            s->black_started = 0;
+            check_black_end(ctx, s->last_pts + s->last_duration);
+        }
+        av_log(ctx, AV_LOG_INFO, "Summary: black intervals:%d black_total:%s\n",
+               s->nb_black, av_ts2timestr(s->black_total, &inlink->time_base));
+    }
+    if (s->detect & QC_FREEZE) {
+        if (s->frozen && s->reference_frame && s->last_pts != AV_NOPTS_VALUE &&
+            s->reference_frame->pts != AV_NOPTS_VALUE) {
+            s->nb_freeze++;
+            s->freeze_total += av_rescale_q(s->last_pts - s->reference_frame->pts,
+                                            inlink->time_base, AV_TIME_BASE_Q);
+        }
+        av_log(ctx, AV_LOG_INFO, "Summary: freeze intervals:%d freeze_total:%s\n",
+               s->nb_freeze, av_ts2timestr(s->freeze_total, &AV_TIME_BASE_Q));
+    }
+    if (s->detect & QC_CROP && s->frame_nb > 0) {
+        int x, y, w, h;
+
+        ff_qcdetect_crop_area(s->x1, s->y1, s->x2, s->y2, s->round, &x, &y, &w, &h);
+        av_log(ctx, AV_LOG_INFO, "Summary: crop=%d:%d:%d:%d\n", w, h, x, y);
+    }
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[0];
+    AVFrame *frame;
+    int64_t pts;
+    int ret, status;
+
+    FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
+
+    ret = ff_inlink_consume_frame(inlink, &frame);
+    if (ret < 0)
+        return ret;
+    if (ret > 0)
+        return filter_frame(ctx, frame);
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        if (status == AVERROR_EOF && inlink->frame_count_out)
+            print_summary(ctx);
+        ff_outlink_set_status(outlink, status, pts);
+        return 0;
+    }
+
+    FF_FILTER_FORWARD_WANTED(outlink, inlink);
+
+    return FFERROR_NOT_READY;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    QCDetectContext *s = ctx->priv;
+
+    av_frame_free(&s->reference_frame);
+    av_freep(&s->black_counts);
+    av_freep(&s->sads);
+    av_freep(&s->row_sums);
+    av_freep(&s->col_sums);
+}
+
+static const AVFilterPad qcdetect_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
+    },
+    { NULL }
+};
+
+static const AVFilterPad qcdetect_outputs[] = {
+    {
+        .name = "default",
+        .type = AVMEDIA_TYPE_VIDEO,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_qcdetect = {
+    .name          = "qcdetect",
+    .description   = NULL_IF_CONFIG_SMALL("Detect black, frozen and cropped video in a single pass."),
+    .priv_size     = sizeof(QCDetectContext),
+    .priv_class    = &qcdetect_class,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .activate      = activate,
+    .inputs        = qcdetect_inputs,
+    .outputs       = qcdetect_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
@@ -313,6 +313,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
         case AV_FRAME_DATA_CONTENT_LIGHT_LEVEL:
             dump_content_light_metadata(ctx, sd);
             break;
+        case AV_FRAME_DATA_SCENE_CHANGE:
+            av_log(ctx, AV_LOG_INFO, "scene change: score of %f", *(double *)sd->data);
+            break;
         default:
             av_log(ctx, AV_LOG_WARNING, "unknown side data type %d (%d bytes)",
                    sd->type, sd->size);
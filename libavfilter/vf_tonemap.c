@@ -30,6 +30,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/mastering_display_metadata.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 
@@ -60,6 +61,18 @@ static const struct LumaCoefficients luma_coefficients[AVCOL_SPC_NB] = {
     [AVCOL_SPC_BT2020_CL]  = { 0.2627, 0.6780, 0.0593 },
 };
 
+static const struct PrimaryCoefficients primaries_bt709 = {
+    0.640, 0.330, 0.300, 0.600, 0.150, 0.060,
+};
+
+static const struct PrimaryCoefficients primaries_bt2020 = {
+    0.708, 0.292, 0.170, 0.797, 0.131, 0.046,
+};
+
+static const struct WhitepointCoefficients whitepoint_d65 = { 0.3127, 0.3290 };
+
+#define LUT_SIZE 4096
+
 typedef struct TonemapContext {
     const AVClass *class;
 
@@ -67,8 +80,22 @@ typedef struct TonemapContext {
     double param;
     double desat;
     double peak;
+    enum AVPixelFormat format;
 
     const struct LumaCoefficients *coeffs;
+
+    /* state of the integrated HDR YUV -> SDR YUV path */
+    enum AVColorTransferCharacteristic lut_trc;
+    double lut_peak;
+    float lut_peak_inv;
+    float yuv2rgb[3][3];        ///< input Y'CbCr -> R'G'B'
+    float rgb2rgb[3][3];        ///< input linear RGB -> BT.709 linear RGB
+    float rgb2yuv[3][3];        ///< BT.709 R'G'B' -> 8-bit limited range Y'CbCr
+    float in_yoff, in_yscale, in_cscale;
+    float lin_lut[LUT_SIZE];    ///< EOTF, indexed by the nonlinear value
+    float ootf_lut[LUT_SIZE];   ///< HLG OOTF gain, indexed by sqrt(luminance)
+    float map_lut[LUT_SIZE];    ///< tonemap gain, indexed by sqrt(sig / peak)
+    float delin_lut[LUT_SIZE];  ///< BT.709 OETF, indexed by sqrt(linear value)
 } TonemapContext;
 
 static const enum AVPixelFormat pix_fmts[] = {
@@ -77,9 +104,30 @@ static const enum AVPixelFormat pix_fmts[] = {
     AV_PIX_FMT_NONE,
 };
 
+static const enum AVPixelFormat yuv_in_fmts[] = {
+    AV_PIX_FMT_YUV420P10,
+    AV_PIX_FMT_P010,
+    AV_PIX_FMT_NONE,
+};
+
+static const enum AVPixelFormat yuv_out_fmts[] = {
+    AV_PIX_FMT_YUV420P,
+    AV_PIX_FMT_NV12,
+    AV_PIX_FMT_NONE,
+};
+
 static int query_formats(AVFilterContext *ctx)
 {
-    return ff_set_common_formats(ctx, ff_make_format_list(pix_fmts));
+    TonemapContext *s = ctx->priv;
+    enum AVPixelFormat out_fmts[] = { s->format, AV_PIX_FMT_NONE };
+    int ret;
+
+    if (s->format == AV_PIX_FMT_NONE)
+        return ff_set_common_formats(ctx, ff_make_format_list(pix_fmts));
+
+    if ((ret = ff_formats_ref(ff_make_format_list(yuv_in_fmts), &ctx->inputs[0]->out_formats)) < 0)
+        return ret;
+    return ff_formats_ref(ff_make_format_list(out_fmts), &ctx->outputs[0]->in_formats);
 }
 
 static av_cold int init(AVFilterContext *ctx)
@@ -104,6 +152,19 @@ static av_cold int init(AVFilterContext *ctx)
     if (isnan(s->param))
         s->param = 1.0f;
 
+    if (s->format != AV_PIX_FMT_NONE) {
+        int i;
+
+        for (i = 0; yuv_out_fmts[i] != AV_PIX_FMT_NONE; i++)
+            if (yuv_out_fmts[i] == s->format)
+                break;
+        if (yuv_out_fmts[i] == AV_PIX_FMT_NONE) {
+            av_log(ctx, AV_LOG_ERROR, "Unsupported output format '%s'\n",
+                   av_get_pix_fmt_name(s->format));
+            return AVERROR(EINVAL);
+        }
+    }
+
     return 0;
 }
 
@@ -126,6 +187,37 @@ static float mobius(float in, float j, double peak)
     return (b * b + 2.0f * b * j + j * j) / (b - a) * (in + a) / (in + b);
 }
 
+static av_always_inline float mapsig(const TonemapContext *s, float sig, double peak)
+{
+    switch(s->tonemap) {
+    default:
+    case TONEMAP_NONE:
+        // do nothing
+        break;
+    case TONEMAP_LINEAR:
+        sig = sig * s->param / peak;
+        break;
+    case TONEMAP_GAMMA:
+        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
+                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
+        break;
+    case TONEMAP_CLIP:
+        sig = av_clipf(sig * s->param, 0, 1.0f);
+        break;
+    case TONEMAP_HABLE:
+        sig = hable(sig) / hable(peak);
+        break;
+    case TONEMAP_REINHARD:
+        sig = sig / (sig + s->param) * (peak + s->param) / peak;
+        break;
+    case TONEMAP_MOBIUS:
+        sig = mobius(sig, s->param, peak);
+        break;
+    }
+
+    return sig;
+}
+
 #define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
 static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
                     const AVPixFmtDescriptor *desc, int x, int y, double peak)
@@ -157,32 +249,7 @@ static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
      * out-of-bounds clipping */
     sig = FFMAX(FFMAX3(*r_out, *g_out, *b_out), 1e-6);
     sig_orig = sig;
-
-    switch(s->tonemap) {
-    default:
-    case TONEMAP_NONE:
-        // do nothing
-        break;
-    case TONEMAP_LINEAR:
-        sig = sig * s->param / peak;
-        break;
-    case TONEMAP_GAMMA:
-        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
-                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
-        break;
-    case TONEMAP_CLIP:
-        sig = av_clipf(sig * s->param, 0, 1.0f);
-        break;
-    case TONEMAP_HABLE:
-        sig = hable(sig) / hable(peak);
-        break;
-    case TONEMAP_REINHARD:
-        sig = sig / (sig + s->param) * (peak + s->param) / peak;
-        break;
-    case TONEMAP_MOBIUS:
-        sig = mobius(sig, s->param, peak);
-        break;
-    }
+    sig = mapsig(s, sig, peak);
 
     /* apply the computed scale factor to the color,
      * linearly to prevent discoloration */
@@ -193,7 +260,7 @@ static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
 
 typedef struct ThreadData {
     AVFrame *in, *out;
-    const AVPixFmtDescriptor *desc;
+    const AVPixFmtDescriptor *desc, *odesc;
     double peak;
 } ThreadData;
 
@@ -215,6 +282,257 @@ static int tonemap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs
     return 0;
 }
 
+/* SMPTE ST 2084 */
+#define PQ_M1 (2610.0 / 16384.0)
+#define PQ_M2 (2523.0 / 4096.0 * 128.0)
+#define PQ_C1 (3424.0 / 4096.0)
+#define PQ_C2 (2413.0 / 4096.0 * 32.0)
+#define PQ_C3 (2392.0 / 4096.0 * 32.0)
+
+/* ARIB STD-B67 */
+#define HLG_A 0.17883277
+#define HLG_B 0.28466892
+#define HLG_C 0.55991073
+
+static double pq_eotf(double x)
+{
+    double p = pow(x, 1.0 / PQ_M2);
+    double num = FFMAX(p - PQ_C1, 0.0);
+    return pow(num / (PQ_C2 - PQ_C3 * p), 1.0 / PQ_M1) * 10000.0 / REFERENCE_WHITE;
+}
+
+static double hlg_inverse_oetf(double x)
+{
+    return x <= 0.5 ? x * x / 3.0 : (exp((x - HLG_C) / HLG_A) + HLG_B) / 12.0;
+}
+
+static double bt709_oetf(double x)
+{
+    return x < 0.018 ? x * 4.5 : 1.099 * pow(x, 0.45) - 0.099;
+}
+
+static av_always_inline int lut_index(float x)
+{
+    return (int)(av_clipf(x, 0.0f, 1.0f) * (LUT_SIZE - 1) + 0.5f);
+}
+
+static av_always_inline int lut_index_sqrt(float x)
+{
+    return lut_index(sqrtf(FFMAX(x, 0.0f)));
+}
+
+static void init_luts(TonemapContext *s, enum AVColorTransferCharacteristic trc,
+                      double peak)
+{
+    int i;
+
+    if (trc != s->lut_trc) {
+        for (i = 0; i < LUT_SIZE; i++) {
+            double x = i / (double)(LUT_SIZE - 1);
+            double y = x * x;
+
+            if (trc == AVCOL_TRC_ARIB_STD_B67) {
+                /* scene light in [0,1]; the OOTF is applied on luminance
+                 * with the system gamma of a 1000 cd/m^2 display */
+                s->lin_lut[i]  = hlg_inverse_oetf(x);
+                s->ootf_lut[i] = pow(y, 0.2) * 1000.0 / REFERENCE_WHITE;
+            } else {
+                s->lin_lut[i]  = pq_eotf(x);
+            }
+            s->delin_lut[i] = bt709_oetf(y);
+        }
+        s->lut_trc = trc;
+    }
+
+    if (peak != s->lut_peak) {
+        for (i = 0; i < LUT_SIZE; i++) {
+            double x = i / (double)(LUT_SIZE - 1);
+            float sig = FFMAX(x * x * peak, 1e-6);
+
+            s->map_lut[i] = mapsig(s, sig, peak) / sig;
+        }
+        s->lut_peak     = peak;
+        s->lut_peak_inv = 1.0 / peak;
+    }
+}
+
+static int setup_yuv(AVFilterContext *ctx, const AVFrame *in, AVFrame *out, double peak)
+{
+    TonemapContext *s = ctx->priv;
+    const struct LumaCoefficients *in_coeffs, *out_coeffs;
+    enum AVColorTransferCharacteristic trc = in->color_trc;
+    double rgb2yuv[3][3], yuv2rgb[3][3];
+    double rgb2xyz[3][3], xyz2rgb[3][3], rgb2rgb[3][3];
+    int i, j;
+
+    if (trc == AVCOL_TRC_UNSPECIFIED) {
+        av_log(s, AV_LOG_WARNING, "Untagged transfer, assuming SMPTE ST 2084\n");
+        trc = AVCOL_TRC_SMPTE2084;
+    } else if (trc != AVCOL_TRC_SMPTE2084 && trc != AVCOL_TRC_ARIB_STD_B67) {
+        av_log(s, AV_LOG_ERROR, "Unsupported transfer '%s', only smpte2084 and arib-std-b67 are supported\n",
+               av_color_transfer_name(trc));
+        return AVERROR(EINVAL);
+    }
+
+    in_coeffs = ff_get_luma_coefficients(in->colorspace);
+    if (!in_coeffs || in->colorspace == AVCOL_SPC_RGB || in->colorspace == AVCOL_SPC_YCOCG) {
+        if (in->colorspace != AVCOL_SPC_UNSPECIFIED)
+            av_log(s, AV_LOG_WARNING, "Unsupported color space '%s', ",
+                   av_color_space_name(in->colorspace));
+        else
+            av_log(s, AV_LOG_WARNING, "Missing color space information, ");
+        av_log(s, AV_LOG_WARNING, "assuming bt2020nc\n");
+        in_coeffs = ff_get_luma_coefficients(AVCOL_SPC_BT2020_NCL);
+    }
+    out_coeffs = ff_get_luma_coefficients(AVCOL_SPC_BT709);
+    s->coeffs = in_coeffs;
+
+    ff_fill_rgb2yuv_table(in_coeffs, rgb2yuv);
+    ff_matrix_invert_3x3(rgb2yuv, yuv2rgb);
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++)
+            s->yuv2rgb[i][j] = yuv2rgb[i][j];
+
+    if (in->color_primaries == AVCOL_PRI_BT709) {
+        for (i = 0; i < 3; i++)
+            for (j = 0; j < 3; j++)
+                s->rgb2rgb[i][j] = i == j;
+    } else {
+        if (in->color_primaries != AVCOL_PRI_BT2020)
+            av_log(s, AV_LOG_WARNING, "Assuming bt2020 primaries for '%s'\n",
+                   av_color_primaries_name(in->color_primaries));
+        ff_fill_rgb2xyz_table(&primaries_bt709, &whitepoint_d65, rgb2xyz);
+        ff_matrix_invert_3x3(rgb2xyz, xyz2rgb);
+        ff_fill_rgb2xyz_table(&primaries_bt2020, &whitepoint_d65, rgb2xyz);
+        ff_matrix_mul_3x3(rgb2rgb, rgb2xyz, xyz2rgb);
+        for (i = 0; i < 3; i++)
+            for (j = 0; j < 3; j++)
+                s->rgb2rgb[i][j] = rgb2rgb[i][j];
+    }
+
+    ff_fill_rgb2yuv_table(out_coeffs, rgb2yuv);
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++)
+            s->rgb2yuv[i][j] = rgb2yuv[i][j] * (i ? 224.0 : 219.0);
+
+    if (in->color_range == AVCOL_RANGE_JPEG) {
+        s->in_yoff   = 0;
+        s->in_yscale = 1.0f / 1023;
+        s->in_cscale = 1.0f / 1023;
+    } else {
+        s->in_yoff   = 64;
+        s->in_yscale = 1.0f / 876;
+        s->in_cscale = 1.0f / 896;
+    }
+
+    init_luts(s, trc, peak);
+
+    out->color_trc       = AVCOL_TRC_BT709;
+    out->color_primaries = AVCOL_PRI_BT709;
+    out->colorspace      = AVCOL_SPC_BT709;
+    out->color_range     = AVCOL_RANGE_MPEG;
+    av_frame_remove_side_data(out, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA);
+    av_frame_remove_side_data(out, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL);
+
+    return 0;
+}
+
+/* map one pixel from input Y'CbCr to BT.709 R'G'B' in [0,1] */
+static av_always_inline void tonemap_yuv_pixel(const TonemapContext *s, float y,
+                                               float u, float v, int hlg,
+                                               float desat, float rgb[3])
+{
+    const float (*m)[3] = s->yuv2rgb;
+    const float (*g)[3] = s->rgb2rgb;
+    float r = s->lin_lut[lut_index(m[0][0] * y + m[0][1] * u + m[0][2] * v)];
+    float gg = s->lin_lut[lut_index(m[1][0] * y + m[1][1] * u + m[1][2] * v)];
+    float b = s->lin_lut[lut_index(m[2][0] * y + m[2][1] * u + m[2][2] * v)];
+    float luma, sig, gain;
+
+    luma = s->coeffs->cr * r + s->coeffs->cg * gg + s->coeffs->cb * b;
+    if (hlg) {
+        gain = s->ootf_lut[lut_index_sqrt(luma)];
+        r    *= gain;
+        gg   *= gain;
+        b    *= gain;
+        luma *= gain;
+    }
+
+    if (desat > 0) {
+        float overbright = FFMAX(luma - desat, 1e-6) / FFMAX(luma, 1e-6);
+        r  = MIX(r,  luma, overbright);
+        gg = MIX(gg, luma, overbright);
+        b  = MIX(b,  luma, overbright);
+    }
+
+    sig  = FFMAX3(r, gg, b);
+    gain = s->map_lut[lut_index_sqrt(sig * s->lut_peak_inv)];
+    r  *= gain;
+    gg *= gain;
+    b  *= gain;
+
+    rgb[0] = s->delin_lut[lut_index_sqrt(g[0][0] * r + g[0][1] * gg + g[0][2] * b)];
+    rgb[1] = s->delin_lut[lut_index_sqrt(g[1][0] * r + g[1][1] * gg + g[1][2] * b)];
+    rgb[2] = s->delin_lut[lut_index_sqrt(g[2][0] * r + g[2][1] * gg + g[2][2] * b)];
+}
+
+static int tonemap_yuv_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const TonemapContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const AVFrame *in = td->in;
+    AVFrame *out = td->out;
+    const AVPixFmtDescriptor *desc = td->desc;
+    const AVPixFmtDescriptor *odesc = td->odesc;
+    const int cw = AV_CEIL_RSHIFT(in->width, 1);
+    const int ch = AV_CEIL_RSHIFT(in->height, 1);
+    const int slice_start = (ch * jobnr) / nb_jobs;
+    const int slice_end = (ch * (jobnr+1)) / nb_jobs;
+    const int shift = desc->comp[0].shift;
+    const int hlg = s->lut_trc == AVCOL_TRC_ARIB_STD_B67;
+    const float desat = s->desat;
+    const float (*m)[3] = s->rgb2yuv;
+
+    for (int cy = slice_start; cy < slice_end; cy++) {
+        const uint8_t *src_u = in->data[desc->comp[1].plane] + cy * in->linesize[desc->comp[1].plane] + desc->comp[1].offset;
+        const uint8_t *src_v = in->data[desc->comp[2].plane] + cy * in->linesize[desc->comp[2].plane] + desc->comp[2].offset;
+        uint8_t *dst_u = out->data[odesc->comp[1].plane] + cy * out->linesize[odesc->comp[1].plane] + odesc->comp[1].offset;
+        uint8_t *dst_v = out->data[odesc->comp[2].plane] + cy * out->linesize[odesc->comp[2].plane] + odesc->comp[2].offset;
+        const int rows = FFMIN(2, in->height - 2 * cy);
+
+        for (int cx = 0; cx < cw; cx++) {
+            const int cols = FFMIN(2, in->width - 2 * cx);
+            float u = ((AV_RN16(src_u + cx * desc->comp[1].step) >> shift) - 512) * s->in_cscale;
+            float v = ((AV_RN16(src_v + cx * desc->comp[2].step) >> shift) - 512) * s->in_cscale;
+            float sum[3] = { 0 }, rgb[3], cnorm;
+
+            for (int dy = 0; dy < rows; dy++) {
+                const int y = 2 * cy + dy;
+                const uint8_t *src_y = in->data[0] + y * in->linesize[0];
+                uint8_t *dst_y = out->data[0] + y * out->linesize[0];
+
+                for (int dx = 0; dx < cols; dx++) {
+                    const int x = 2 * cx + dx;
+                    float luma = ((AV_RN16(src_y + 2 * x) >> shift) - s->in_yoff) * s->in_yscale;
+
+                    tonemap_yuv_pixel(s, luma, u, v, hlg, desat, rgb);
+                    dst_y[x] = av_clip_uint8(16.5f + m[0][0] * rgb[0] + m[0][1] * rgb[1] + m[0][2] * rgb[2]);
+                    sum[0] += rgb[0];
+                    sum[1] += rgb[1];
+                    sum[2] += rgb[2];
+                }
+            }
+
+            /* chroma is computed from the average of the R'G'B' samples it covers */
+            cnorm = 1.0f / (rows * cols);
+            dst_u[cx * odesc->comp[1].step] = av_clip_uint8(128.5f + cnorm * (m[1][0] * sum[0] + m[1][1] * sum[1] + m[1][2] * sum[2]));
+            dst_v[cx * odesc->comp[2].step] = av_clip_uint8(128.5f + cnorm * (m[2][0] * sum[0] + m[2][1] * sum[1] + m[2][2] * sum[2]));
+        }
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
     AVFilterContext *ctx = link->dst;
@@ -245,6 +563,32 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         return ret;
     }
 
+    /* read peak from side data if not passed in */
+    if (!peak) {
+        peak = ff_determine_signal_peak(in);
+        av_log(s, AV_LOG_DEBUG, "Computed signal peak: %f\n", peak);
+    }
+
+    if (s->format != AV_PIX_FMT_NONE) {
+        ret = setup_yuv(ctx, in, out, peak);
+        if (ret < 0) {
+            av_frame_free(&in);
+            av_frame_free(&out);
+            return ret;
+        }
+
+        td.out = out;
+        td.in = in;
+        td.desc = desc;
+        td.odesc = odesc;
+        td.peak = peak;
+        ctx->internal->execute(ctx, tonemap_yuv_slice, &td, NULL,
+                               FFMIN(AV_CEIL_RSHIFT(in->height, 1), ff_filter_get_nb_threads(ctx)));
+
+        av_frame_free(&in);
+        return ff_filter_frame(outlink, out);
+    }
+
     /* input and output transfer will be linear */
     if (in->color_trc == AVCOL_TRC_UNSPECIFIED) {
         av_log(s, AV_LOG_WARNING, "Untagged transfer, assuming linear light\n");
@@ -252,12 +596,6 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     } else if (in->color_trc != AVCOL_TRC_LINEAR)
         av_log(s, AV_LOG_WARNING, "Tonemapping works on linear light only\n");
 
-    /* read peak from side data if not passed in */
-    if (!peak) {
-        peak = ff_determine_signal_peak(in);
-        av_log(s, AV_LOG_DEBUG, "Computed signal peak: %f\n", peak);
-    }
-
     /* load original color space even if pixel format is RGB to compute overbrights */
     s->coeffs = &luma_coefficients[in->colorspace];
     if (s->desat > 0 && (in->colorspace == AVCOL_SPC_UNSPECIFIED || !s->coeffs)) {
@@ -274,6 +612,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     td.out = out;
     td.in = in;
     td.desc = desc;
+    td.odesc = odesc;
     td.peak = peak;
     ctx->internal->execute(ctx, tonemap_slice, &td, NULL, FFMIN(in->height, ff_filter_get_nb_threads(ctx)));
 
@@ -312,6 +651,7 @@ static const AVOption tonemap_options[] = {
     { "param",        "tonemap parameter", OFFSET(param), AV_OPT_TYPE_DOUBLE, {.dbl = NAN}, DBL_MIN, DBL_MAX, FLAGS },
     { "desat",        "desaturation strength", OFFSET(desat), AV_OPT_TYPE_DOUBLE, {.dbl = 2}, 0, DBL_MAX, FLAGS },
     { "peak",         "signal peak override", OFFSET(peak), AV_OPT_TYPE_DOUBLE, {.dbl = 0}, 0, DBL_MAX, FLAGS },
+    { "format",       "output pixel format for direct HDR YUV input", OFFSET(format), AV_OPT_TYPE_PIXEL_FMT, {.i64 = AV_PIX_FMT_NONE}, AV_PIX_FMT_NONE, INT_MAX, FLAGS },
     { NULL }
 };
 
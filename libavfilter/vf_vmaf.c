@@ -0,0 +1,1045 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Calculate the VMAF features (ADM, VIF, motion) natively and fuse them
+ * with a libsvm regression model.
+ */
+
+#include <float.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/eval.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "vmaf_motion.h"
+#include "video.h"
+
+#define NB_SCALES 4
+#define VIF_MAX_TAPS 17
+#define VIF_SIGMA_NSQ 2.0f
+#define VIF_EPS 1e-10f
+#define VIF_GAIN_LIMIT 100.0f
+#define ADM_BORDER_FACTOR 0.1
+#define ADM_EPS 1e-30f
+
+enum Feature {
+    FEATURE_ADM2,
+    FEATURE_MOTION2,
+    FEATURE_VIF_SCALE0,
+    FEATURE_VIF_SCALE1,
+    FEATURE_VIF_SCALE2,
+    FEATURE_VIF_SCALE3,
+    NB_FEATURES
+};
+
+/* in the order the features are indexed in the model */
+static const char *const feature_names[NB_FEATURES] = {
+    "adm2", "motion2", "vif_scale0", "vif_scale1", "vif_scale2", "vif_scale3",
+};
+
+typedef struct VMAFContext {
+    const AVClass *class;
+    char *model_path;
+    char *slopes_str;
+    char *intercepts_str;
+    char *stats_file_str;
+    double view_dist;
+    int display_h;
+
+    FILE *stats_file;
+    int depth;
+    int nb_jobs;
+    int scale;
+
+    float vif_filter[NB_SCALES][VIF_MAX_TAPS];
+    int vif_taps[NB_SCALES];
+    int vif_w[NB_SCALES], vif_h[NB_SCALES];
+    ptrdiff_t stride;
+    /* luma of each input at every VIF scale, normalized to 8 bits */
+    float *vif_ref[NB_SCALES], *vif_dis[NB_SCALES];
+    double *vif_num[NB_SCALES], *vif_den[NB_SCALES];
+
+    float adm_rfactor[NB_SCALES][3];
+    int adm_w[NB_SCALES], adm_h[NB_SCALES];
+    ptrdiff_t band_stride;
+    /* DWT bands a, h, v, d of [scale & 1][ref, dis] */
+    float *band[2][2][4];
+    float *csf_f[3];
+    double *adm_num[3], *adm_den[3];
+    double adm_numden_limit;
+
+    float *temp;
+    int temp_size;
+
+    VMAFMotionData motion;
+    AVFrame *in[2];
+    AVFrame *pending;
+    double pending_features[NB_FEATURES];
+
+    int nb_sv;
+    double gamma, rho;
+    double *sv_coef;
+    double *sv;
+    double slopes[NB_FEATURES + 1];
+    double intercepts[NB_FEATURES + 1];
+
+    uint64_t nb_frames;
+    double feature_sum[NB_FEATURES];
+    double score_sum;
+} VMAFContext;
+
+#define OFFSET(x) offsetof(VMAFContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+
+static const AVOption vmaf_options[] = {
+    { "model_path", "set the libsvm model file",                     OFFSET(model_path),     AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "slopes",     "set the model normalization slopes",            OFFSET(slopes_str),     AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "intercepts", "set the model normalization intercepts",        OFFSET(intercepts_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "view_dist",  "set the viewing distance in display heights",   OFFSET(view_dist),      AV_OPT_TYPE_DOUBLE, {.dbl=3.0},  0.75, 24.0, FLAGS },
+    { "display_h",  "set the height of the reference display",       OFFSET(display_h),      AV_OPT_TYPE_INT,    {.i64=1080}, 1, 4320, FLAGS },
+    { "stats_file", "Set file where to store per-frame information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "f",          "Set file where to store per-frame information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(vmaf);
+
+static const float dwt_db2_lo[4] = {
+     0.482962913144690,  0.836516303737469,  0.224143868041857, -0.129409522550921,
+};
+
+static const float dwt_db2_hi[4] = {
+    -0.129409522550921, -0.224143868041857,  0.836516303737469, -0.482962913144690,
+};
+
+/* Watson et al. 1997, luma quantization model and 9/7 DWT basis amplitudes */
+static const float dwt_basis_amplitude[NB_SCALES][4] = {
+    { 0.62171,  0.67234, 0.72709, 0.67234 },
+    { 0.34537,  0.41317, 0.49428, 0.41317 },
+    { 0.18004,  0.22727, 0.28688, 0.22727 },
+    { 0.091401, 0.11792, 0.15214, 0.11792 },
+};
+
+static float dwt_quant_step(int lambda, int theta, double view_dist, int display_h)
+{
+    static const float g[4] = { 1.501, 1.0, 0.534, 1.0 };
+    /* display resolution in pixels per degree */
+    const double r = view_dist * display_h * M_PI / 180.0;
+    const double t = log10(pow(2.0, lambda + 1) * 0.401 * g[theta] / r);
+
+    return 2.0 * 0.495 * pow(10.0, 0.466 * t * t) / dwt_basis_amplitude[lambda][theta];
+}
+
+static av_always_inline int mirror(int x, int n)
+{
+    return x < 0 ? -x : x >= n ? 2 * n - x - 1 : x;
+}
+
+static int convert_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    const int w = s->vif_w[0], h = s->vif_h[0];
+    const int slice_start = (h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    const float factor = 1.0f / (1 << (s->depth - 8));
+    int i, x, y;
+
+    for (i = 0; i < 2; i++) {
+        const AVFrame *in = s->in[i];
+        float *dst = (i ? s->vif_ref[0] : s->vif_dis[0]) + slice_start * s->stride;
+
+        for (y = slice_start; y < slice_end; y++) {
+            const uint8_t *src = in->data[0] + y * in->linesize[0];
+
+            if (s->depth > 8) {
+                const uint16_t *src16 = (const uint16_t *)src;
+                for (x = 0; x < w; x++)
+                    dst[x] = src16[x] * factor - 128.0f;
+            } else {
+                for (x = 0; x < w; x++)
+                    dst[x] = src[x] - 128.0f;
+            }
+            dst += s->stride;
+        }
+    }
+
+    return 0;
+}
+
+static av_always_inline float filter_col(const float *filter, int taps,
+                                         const float *src, ptrdiff_t stride,
+                                         int x, int y, int h)
+{
+    float sum = 0.0f;
+    int k;
+
+    for (k = 0; k < taps; k++)
+        sum += filter[k] * src[mirror(y - taps / 2 + k, h) * stride + x];
+    return sum;
+}
+
+static av_always_inline float filter_row(const float *filter, int taps,
+                                         const float *src, int x, int w)
+{
+    float sum = 0.0f;
+    int k;
+
+    for (k = 0; k < taps; k++)
+        sum += filter[k] * src[mirror(x - taps / 2 + k, w)];
+    return sum;
+}
+
+/* low-pass the previous scale with this scale's filter and keep the even samples */
+static int vif_decimate_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    const int scale = s->scale;
+    const float *filter = s->vif_filter[scale];
+    const int taps = s->vif_taps[scale];
+    const int sw = s->vif_w[scale - 1], sh = s->vif_h[scale - 1];
+    const int w = s->vif_w[scale], h = s->vif_h[scale];
+    const int slice_start = (h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    float *tmp = s->temp + jobnr * s->temp_size;
+    int i, x, y;
+
+    for (i = 0; i < 2; i++) {
+        const float *src = i ? s->vif_ref[scale - 1] : s->vif_dis[scale - 1];
+        float *dst = i ? s->vif_ref[scale] : s->vif_dis[scale];
+
+        for (y = slice_start; y < slice_end; y++) {
+            for (x = 0; x < sw; x++)
+                tmp[x] = filter_col(filter, taps, src, s->stride, x, 2 * y, sh);
+            for (x = 0; x < w; x++)
+                dst[y * s->stride + x] = filter_row(filter, taps, tmp, 2 * x, sw);
+        }
+    }
+
+    return 0;
+}
+
+static int vif_statistic_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    const int scale = s->scale;
+    const float *filter = s->vif_filter[scale];
+    const int taps = s->vif_taps[scale];
+    const int w = s->vif_w[scale], h = s->vif_h[scale];
+    const ptrdiff_t stride = s->stride;
+    const float *ref = s->vif_ref[scale];
+    const float *dis = s->vif_dis[scale];
+    const int slice_start = (h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    float *tmp_mu1 = s->temp + jobnr * s->temp_size;
+    float *tmp_mu2 = tmp_mu1 + w;
+    float *tmp_xx  = tmp_mu2 + w;
+    float *tmp_yy  = tmp_xx  + w;
+    float *tmp_xy  = tmp_yy  + w;
+    int x, y, k;
+
+    for (y = slice_start; y < slice_end; y++) {
+        double num = 0.0, den = 0.0;
+
+        for (x = 0; x < w; x++) {
+            float mu1 = 0.0f, mu2 = 0.0f, xx = 0.0f, yy = 0.0f, xy = 0.0f;
+
+            for (k = 0; k < taps; k++) {
+                const ptrdiff_t off = mirror(y - taps / 2 + k, h) * stride + x;
+                const float f = filter[k], a = ref[off], b = dis[off];
+
+                mu1 += f * a;
+                mu2 += f * b;
+                xx  += f * a * a;
+                yy  += f * b * b;
+                xy  += f * a * b;
+            }
+            tmp_mu1[x] = mu1;
+            tmp_mu2[x] = mu2;
+            tmp_xx[x]  = xx;
+            tmp_yy[x]  = yy;
+            tmp_xy[x]  = xy;
+        }
+
+        for (x = 0; x < w; x++) {
+            const float mu1 = filter_row(filter, taps, tmp_mu1, x, w);
+            const float mu2 = filter_row(filter, taps, tmp_mu2, x, w);
+            float sigma1_sq = filter_row(filter, taps, tmp_xx, x, w) - mu1 * mu1;
+            float sigma2_sq = filter_row(filter, taps, tmp_yy, x, w) - mu2 * mu2;
+            float sigma12   = filter_row(filter, taps, tmp_xy, x, w) - mu1 * mu2;
+            float g, sv_sq;
+
+            sigma1_sq = FFMAX(sigma1_sq, 0.0f);
+            sigma2_sq = FFMAX(sigma2_sq, 0.0f);
+
+            g = sigma12 / (sigma1_sq + VIF_EPS);
+            sv_sq = sigma2_sq - g * sigma12;
+
+            if (sigma1_sq < VIF_EPS) {
+                g = 0.0f;
+                sv_sq = sigma2_sq;
+                sigma1_sq = 0.0f;
+            }
+            if (sigma2_sq < VIF_EPS) {
+                g = 0.0f;
+                sv_sq = 0.0f;
+            }
+            if (g < 0.0f) {
+                sv_sq = sigma2_sq;
+                g = 0.0f;
+            }
+            sv_sq = FFMAX(sv_sq, VIF_EPS);
+            g = FFMIN(g, VIF_GAIN_LIMIT);
+
+            num += log2f(1.0f + g * g * sigma1_sq / (sv_sq + VIF_SIGMA_NSQ));
+            den += log2f(1.0f + sigma1_sq / VIF_SIGMA_NSQ);
+        }
+
+        s->vif_num[scale][y] = num;
+        s->vif_den[scale][y] = den;
+    }
+
+    return 0;
+}
+
+static int adm_dwt_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    const int scale = s->scale;
+    const int sw = scale ? s->adm_w[scale - 1] : s->vif_w[0];
+    const int sh = scale ? s->adm_h[scale - 1] : s->vif_h[0];
+    const ptrdiff_t sstride = scale ? s->band_stride : s->stride;
+    const int w = s->adm_w[scale], h = s->adm_h[scale];
+    const int slice_start = (h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    float *tmplo = s->temp + jobnr * s->temp_size;
+    float *tmphi = tmplo + sw;
+    int i, k, x, y;
+
+    for (i = 0; i < 2; i++) {
+        const float *src = scale ? s->band[(scale - 1) & 1][i][0]
+                                 : i ? s->vif_dis[0] : s->vif_ref[0];
+        float **dst = s->band[scale & 1][i];
+
+        for (y = slice_start; y < slice_end; y++) {
+            const float *row[4];
+            const ptrdiff_t off = y * s->band_stride;
+
+            for (k = 0; k < 4; k++)
+                row[k] = src + mirror(2 * y - 1 + k, sh) * sstride;
+
+            for (x = 0; x < sw; x++) {
+                float lo = 0.0f, hi = 0.0f;
+                for (k = 0; k < 4; k++) {
+                    lo += dwt_db2_lo[k] * row[k][x];
+                    hi += dwt_db2_hi[k] * row[k][x];
+                }
+                tmplo[x] = lo;
+                tmphi[x] = hi;
+            }
+
+            for (x = 0; x < w; x++) {
+                float a = 0.0f, v = 0.0f, hh = 0.0f, d = 0.0f;
+                for (k = 0; k < 4; k++) {
+                    const int j = mirror(2 * x - 1 + k, sw);
+                    a  += dwt_db2_lo[k] * tmplo[j];
+                    v  += dwt_db2_hi[k] * tmplo[j];
+                    hh += dwt_db2_lo[k] * tmphi[j];
+                    d  += dwt_db2_hi[k] * tmphi[j];
+                }
+                dst[0][off + x] = a;
+                dst[1][off + x] = hh;
+                dst[2][off + x] = v;
+                dst[3][off + x] = d;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* split the distorted detail bands into restored and additive parts */
+static av_always_inline void adm_decouple(const float o[3], const float t[3], float r[3])
+{
+    const float cos_1deg_sq = 0.99969541350954794f;
+    const float ot_dp    = o[0] * t[0] + o[1] * t[1];
+    const float o_mag_sq = o[0] * o[0] + o[1] * o[1];
+    const float t_mag_sq = t[0] * t[0] + t[1] * t[1];
+    const int angle_flag = ot_dp >= 0.0f &&
+                           ot_dp * ot_dp >= cos_1deg_sq * o_mag_sq * t_mag_sq;
+    int k;
+
+    for (k = 0; k < 3; k++) {
+        if (angle_flag) {
+            r[k] = t[k];
+        } else {
+            const float kk = av_clipf(t[k] / (o[k] + ADM_EPS), 0.0f, 1.0f);
+            r[k] = kk * o[k];
+        }
+    }
+}
+
+static void adm_crop(int w, int h, int *left, int *top, int *right, int *bottom)
+{
+    *left   = w * ADM_BORDER_FACTOR - 0.5;
+    *top    = h * ADM_BORDER_FACTOR - 0.5;
+    *right  = w - *left;
+    *bottom = h - *top;
+}
+
+static int adm_csf_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    const int scale = s->scale;
+    const float *rfactor = s->adm_rfactor[scale];
+    float *const *ref = s->band[scale & 1][0];
+    float *const *dis = s->band[scale & 1][1];
+    const int w = s->adm_w[scale], h = s->adm_h[scale];
+    const int slice_start = (h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    int left, top, right, bottom;
+    int k, x, y;
+
+    adm_crop(w, h, &left, &top, &right, &bottom);
+
+    for (y = slice_start; y < slice_end; y++) {
+        const ptrdiff_t off = y * s->band_stride;
+        double den[3] = { 0.0 };
+
+        for (x = 0; x < w; x++) {
+            float o[3], t[3], r[3];
+
+            for (k = 0; k < 3; k++) {
+                o[k] = ref[k + 1][off + x];
+                t[k] = dis[k + 1][off + x];
+            }
+            adm_decouple(o, t, r);
+            for (k = 0; k < 3; k++)
+                s->csf_f[k][off + x] = fabsf(rfactor[k] * (t[k] - r[k])) * (1.0f / 30.0f);
+
+            if (y >= top && y < bottom && x >= left && x < right) {
+                for (k = 0; k < 3; k++) {
+                    const float v = fabsf(rfactor[k] * o[k]);
+                    den[k] += v * v * v;
+                }
+            }
+        }
+
+        for (k = 0; k < 3; k++)
+            s->adm_den[k][y] = den[k];
+    }
+
+    return 0;
+}
+
+static int adm_cm_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    const int scale = s->scale;
+    const float *rfactor = s->adm_rfactor[scale];
+    float *const *ref = s->band[scale & 1][0];
+    float *const *dis = s->band[scale & 1][1];
+    const int w = s->adm_w[scale], h = s->adm_h[scale];
+    const ptrdiff_t stride = s->band_stride;
+    int left, top, right, bottom;
+    int slice_start, slice_end;
+    int i, j, k, x, y;
+
+    adm_crop(w, h, &left, &top, &right, &bottom);
+    slice_start = top + ((bottom - top) *  jobnr     ) / nb_jobs;
+    slice_end   = top + ((bottom - top) * (jobnr + 1)) / nb_jobs;
+
+    for (y = slice_start; y < slice_end; y++) {
+        const ptrdiff_t off = y * stride;
+        double num[3] = { 0.0 };
+
+        for (x = left; x < right; x++) {
+            float o[3], t[3], r[3], thr = 0.0f;
+
+            for (k = 0; k < 3; k++) {
+                o[k] = ref[k + 1][off + x];
+                t[k] = dis[k + 1][off + x];
+            }
+            adm_decouple(o, t, r);
+
+            /* contrast masking by the additive impairment in a 3x3 window */
+            for (k = 0; k < 3; k++) {
+                for (i = -1; i <= 1; i++) {
+                    const float *line = s->csf_f[k] + mirror(y + i, h) * stride;
+                    for (j = -1; j <= 1; j++)
+                        thr += line[mirror(x + j, w)];
+                }
+                thr += s->csf_f[k][off + x];
+            }
+
+            for (k = 0; k < 3; k++) {
+                const float v = FFMAX(fabsf(rfactor[k] * r[k]) - thr, 0.0f);
+                num[k] += v * v * v;
+            }
+        }
+
+        for (k = 0; k < 3; k++)
+            s->adm_num[k][y] = num[k];
+    }
+
+    return 0;
+}
+
+static double compute_adm(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    double num = 0.0, den = 0.0;
+    int scale, k, y;
+
+    for (scale = 0; scale < NB_SCALES; scale++) {
+        const int w = s->adm_w[scale], h = s->adm_h[scale];
+        int left, top, right, bottom;
+        double border;
+
+        s->scale = scale;
+        ctx->internal->execute(ctx, adm_dwt_slice, NULL, NULL, FFMIN(h, s->nb_jobs));
+        ctx->internal->execute(ctx, adm_csf_slice, NULL, NULL, FFMIN(h, s->nb_jobs));
+        ctx->internal->execute(ctx, adm_cm_slice,  NULL, NULL, FFMIN(h, s->nb_jobs));
+
+        adm_crop(w, h, &left, &top, &right, &bottom);
+        border = cbrt((bottom - top) * (right - left) / 32.0);
+        for (k = 0; k < 3; k++) {
+            double num_k = 0.0, den_k = 0.0;
+
+            for (y = top; y < bottom; y++) {
+                num_k += s->adm_num[k][y];
+                den_k += s->adm_den[k][y];
+            }
+            num += cbrt(num_k) + border;
+            den += cbrt(den_k) + border;
+        }
+    }
+
+    if (num < s->adm_numden_limit)
+        num = 0.0;
+    if (den < s->adm_numden_limit)
+        den = 0.0;
+    return den == 0.0 ? 1.0 : num / den;
+}
+
+static void compute_vif(AVFilterContext *ctx, double *vif)
+{
+    VMAFContext *s = ctx->priv;
+    int scale, y;
+
+    for (scale = 0; scale < NB_SCALES; scale++) {
+        double num = 0.0, den = 0.0;
+        const int h = s->vif_h[scale];
+
+        s->scale = scale;
+        if (scale)
+            ctx->internal->execute(ctx, vif_decimate_slice, NULL, NULL, FFMIN(h, s->nb_jobs));
+        ctx->internal->execute(ctx, vif_statistic_slice, NULL, NULL, FFMIN(h, s->nb_jobs));
+
+        for (y = 0; y < h; y++) {
+            num += s->vif_num[scale][y];
+            den += s->vif_den[scale][y];
+        }
+        vif[scale] = den == 0.0 ? 1.0 : num / den;
+    }
+}
+
+static double predict(VMAFContext *s, const double *features)
+{
+    double x[NB_FEATURES], sum = 0.0;
+    int i, k;
+
+    for (k = 0; k < NB_FEATURES; k++)
+        x[k] = s->slopes[k + 1] * features[k] + s->intercepts[k + 1];
+
+    for (i = 0; i < s->nb_sv; i++) {
+        const double *sv = s->sv + i * NB_FEATURES;
+        double d = 0.0;
+
+        for (k = 0; k < NB_FEATURES; k++)
+            d += (x[k] - sv[k]) * (x[k] - sv[k]);
+        sum += s->sv_coef[i] * exp(-s->gamma * d);
+    }
+    sum -= s->rho;
+
+    return av_clipd((sum - s->intercepts[0]) / s->slopes[0], 0.0, 100.0);
+}
+
+static void set_meta(AVDictionary **metadata, const char *key, double d)
+{
+    char key2[128];
+    char value[128];
+
+    snprintf(key2, sizeof(key2), "lavfi.vmaf.%s", key);
+    snprintf(value, sizeof(value), "%f", d);
+    av_dict_set(metadata, key2, value, 0);
+}
+
+/* motion2 is the smaller of the motion towards the previous and the next frame */
+static int output_pending(AVFilterContext *ctx, double next_motion)
+{
+    VMAFContext *s = ctx->priv;
+    double *features = s->pending_features;
+    AVFrame *out = s->pending;
+    double score = 0.0;
+    int k;
+
+    s->pending = NULL;
+    features[FEATURE_MOTION2] = FFMIN(features[FEATURE_MOTION2], next_motion);
+
+    s->nb_frames++;
+    for (k = 0; k < NB_FEATURES; k++) {
+        set_meta(&out->metadata, feature_names[k], features[k]);
+        s->feature_sum[k] += features[k];
+    }
+    if (s->nb_sv) {
+        score = predict(s, features);
+        set_meta(&out->metadata, "score", score);
+        s->score_sum += score;
+    }
+
+    if (s->stats_file) {
+        fprintf(s->stats_file, "n:%"PRId64, s->nb_frames);
+        for (k = 0; k < NB_FEATURES; k++)
+            fprintf(s->stats_file, " %s:%f", feature_names[k], features[k]);
+        if (s->nb_sv)
+            fprintf(s->stats_file, " vmaf:%f", score);
+        fprintf(s->stats_file, "\n");
+    }
+
+    return ff_filter_frame(ctx->outputs[0], out);
+}
+
+static int do_vmaf(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    double motion;
+    int ret = 0;
+
+    ctx->internal->execute(ctx, convert_slice, NULL, NULL, s->nb_jobs);
+
+    motion = ff_vmafmotion_process(&s->motion, s->in[1]);
+    if (s->pending)
+        ret = output_pending(ctx, motion);
+
+    s->pending_features[FEATURE_MOTION2] = motion;
+    s->pending_features[FEATURE_ADM2]    = compute_adm(ctx);
+    compute_vif(ctx, &s->pending_features[FEATURE_VIF_SCALE0]);
+
+    s->pending = s->in[0];
+    s->in[0] = NULL;
+    av_frame_free(&s->in[1]);
+
+    return ret;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    int64_t pts;
+    int i, ret, status;
+
+    FF_FILTER_FORWARD_STATUS_BACK_ALL(outlink, ctx);
+
+    for (i = 0; i < 2; i++) {
+        if (!s->in[i]) {
+            ret = ff_inlink_consume_frame(ctx->inputs[i], &s->in[i]);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    if (s->in[0] && s->in[1]) {
+        ret = do_vmaf(ctx);
+        ff_filter_set_ready(ctx, 100);
+        return ret;
+    }
+
+    for (i = 0; i < 2; i++) {
+        if (!s->in[i] && ff_inlink_acknowledge_status(ctx->inputs[i], &status, &pts)) {
+            ret = 0;
+            if (s->pending)
+                ret = output_pending(ctx, DBL_MAX);
+            ff_outlink_set_status(outlink, status, pts);
+            return ret;
+        }
+    }
+
+    if (ff_outlink_frame_wanted(outlink)) {
+        for (i = 0; i < 2; i++) {
+            if (!s->in[i])
+                ff_inlink_request_frame(ctx->inputs[i]);
+        }
+        return 0;
+    }
+
+    return FFERROR_NOT_READY;
+}
+
+static int parse_values(AVFilterContext *ctx, const char *str, const char *name,
+                        double *dst, double def)
+{
+    char *p = (char *)str;
+    int i;
+
+    for (i = 0; i < NB_FEATURES + 1; i++)
+        dst[i] = def;
+    if (!str)
+        return 0;
+
+    for (i = 0; i < NB_FEATURES + 1; i++) {
+        char *end;
+
+        dst[i] = av_strtod(p, &end);
+        if (end == p) {
+            av_log(ctx, AV_LOG_ERROR, "Expected %d %s, got '%s'.\n",
+                   NB_FEATURES + 1, name, str);
+            return AVERROR(EINVAL);
+        }
+        p = end + strspn(end, " |");
+    }
+
+    return 0;
+}
+
+static int load_model(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    char line[4096], type[32];
+    int i, ret = 0, in_sv = 0;
+    FILE *f;
+
+    f = fopen(s->model_path, "r");
+    if (!f) {
+        ret = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "%s: %s\n", s->model_path, av_err2str(ret));
+        return ret;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        if (!strncmp(line, "SV", 2)) {
+            in_sv = 1;
+            break;
+        }
+        if (sscanf(line, "svm_type %31s", type) == 1) {
+            if (strcmp(type, "nu_svr") && strcmp(type, "epsilon_svr")) {
+                av_log(ctx, AV_LOG_ERROR, "Unsupported SVM type %s.\n", type);
+                ret = AVERROR_PATCHWELCOME;
+                goto end;
+            }
+        } else if (sscanf(line, "kernel_type %31s", type) == 1) {
+            if (strcmp(type, "rbf")) {
+                av_log(ctx, AV_LOG_ERROR, "Unsupported kernel type %s.\n", type);
+                ret = AVERROR_PATCHWELCOME;
+                goto end;
+            }
+        } else {
+            sscanf(line, "gamma %lf", &s->gamma);
+            sscanf(line, "rho %lf", &s->rho);
+            sscanf(line, "total_sv %d", &s->nb_sv);
+        }
+    }
+
+    if (!in_sv || s->nb_sv <= 0) {
+        av_log(ctx, AV_LOG_ERROR, "No support vectors in %s.\n", s->model_path);
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+
+    s->sv_coef = av_calloc(s->nb_sv, sizeof(*s->sv_coef));
+    s->sv      = av_calloc(s->nb_sv, NB_FEATURES * sizeof(*s->sv));
+    if (!s->sv_coef || !s->sv) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (i = 0; i < s->nb_sv && fgets(line, sizeof(line), f); i++) {
+        char *p = line, *end;
+
+        s->sv_coef[i] = av_strtod(p, &p);
+        for (;;) {
+            long idx = strtol(p, &end, 10);
+
+            if (end == p || *end != ':')
+                break;
+            if (idx < 1 || idx > NB_FEATURES) {
+                av_log(ctx, AV_LOG_ERROR, "Invalid feature index %ld in %s.\n",
+                       idx, s->model_path);
+                ret = AVERROR_INVALIDDATA;
+                goto end;
+            }
+            p = end + 1;
+            s->sv[i * NB_FEATURES + idx - 1] = av_strtod(p, &p);
+        }
+    }
+    if (i < s->nb_sv) {
+        av_log(ctx, AV_LOG_ERROR, "Truncated model %s.\n", s->model_path);
+        ret = AVERROR_INVALIDDATA;
+    }
+
+end:
+    if (ret < 0)
+        s->nb_sv = 0;
+    fclose(f);
+    return ret;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    int ret;
+
+    if ((ret = parse_values(ctx, s->slopes_str, "slopes", s->slopes, 1.0)) < 0 ||
+        (ret = parse_values(ctx, s->intercepts_str, "intercepts", s->intercepts, 0.0)) < 0)
+        return ret;
+    if (s->slopes[0] == 0.0) {
+        av_log(ctx, AV_LOG_ERROR, "The score slope must not be 0.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (s->model_path && (ret = load_model(ctx)) < 0)
+        return ret;
+
+    if (s->stats_file_str) {
+        if (!strcmp(s->stats_file_str, "-")) {
+            s->stats_file = stdout;
+        } else {
+            s->stats_file = fopen(s->stats_file_str, "w");
+            if (!s->stats_file) {
+                int err = AVERROR(errno);
+                char buf[128];
+                av_strerror(err, buf, sizeof(buf));
+                av_log(ctx, AV_LOG_ERROR, "Could not open stats file %s: %s\n",
+                       s->stats_file_str, buf);
+                return err;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY10,
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P,
+        AV_PIX_FMT_YUV420P10, AV_PIX_FMT_YUV422P10, AV_PIX_FMT_YUV444P10,
+        AV_PIX_FMT_NONE
+    };
+
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_input_ref(AVFilterLink *inlink)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    AVFilterContext *ctx  = inlink->dst;
+    VMAFContext *s = ctx->priv;
+    const int w = inlink->w, h = inlink->h;
+    size_t size;
+    int i, j, k, ret;
+
+    if (ctx->inputs[0]->w != ctx->inputs[1]->w ||
+        ctx->inputs[0]->h != ctx->inputs[1]->h) {
+        av_log(ctx, AV_LOG_ERROR, "Width and height of input videos must be same.\n");
+        return AVERROR(EINVAL);
+    }
+    if (ctx->inputs[0]->format != ctx->inputs[1]->format) {
+        av_log(ctx, AV_LOG_ERROR, "Inputs must be of same pixel format.\n");
+        return AVERROR(EINVAL);
+    }
+    if (w < 32 || h < 32) {
+        av_log(ctx, AV_LOG_ERROR, "Inputs must be at least 32x32.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->depth = desc->comp[0].depth;
+
+    for (i = 0; i < NB_SCALES; i++) {
+        const int taps = (1 << (4 - i)) + 1;
+        const double sigma = taps / 5.0;
+        double sum = 0.0;
+
+        /* gaussian windows of 17, 9, 5 and 3 taps */
+        for (j = 0; j < taps; j++) {
+            const double d = j - taps / 2;
+            s->vif_filter[i][j] = exp(-d * d / (2 * sigma * sigma));
+            sum += s->vif_filter[i][j];
+        }
+        for (j = 0; j < taps; j++)
+            s->vif_filter[i][j] /= sum;
+        s->vif_taps[i] = taps;
+
+        s->vif_w[i] = i ? s->vif_w[i - 1] / 2 : w;
+        s->vif_h[i] = i ? s->vif_h[i - 1] / 2 : h;
+        s->adm_w[i] = ((i ? s->adm_w[i - 1] : w) + 1) / 2;
+        s->adm_h[i] = ((i ? s->adm_h[i - 1] : h) + 1) / 2;
+
+        s->adm_rfactor[i][0] = s->adm_rfactor[i][1] =
+            1.0f / dwt_quant_step(i, 1, s->view_dist, s->display_h);
+        s->adm_rfactor[i][2] = 1.0f / dwt_quant_step(i, 2, s->view_dist, s->display_h);
+    }
+    s->adm_numden_limit = 1e-10 * (w * h) / (1920.0 * 1080.0);
+
+    s->stride = FFALIGN(w, 16);
+    s->band_stride = FFALIGN(s->adm_w[0], 16);
+    s->nb_jobs = av_clip(ff_filter_get_nb_threads(ctx), 1, s->adm_h[NB_SCALES - 1]);
+
+    for (i = 0; i < NB_SCALES; i++) {
+        size = s->stride * s->vif_h[i];
+        s->vif_ref[i] = av_malloc_array(size, sizeof(float));
+        s->vif_dis[i] = av_malloc_array(size, sizeof(float));
+        s->vif_num[i] = av_malloc_array(s->vif_h[i], sizeof(double));
+        s->vif_den[i] = av_malloc_array(s->vif_h[i], sizeof(double));
+        if (!s->vif_ref[i] || !s->vif_dis[i] || !s->vif_num[i] || !s->vif_den[i])
+            return AVERROR(ENOMEM);
+    }
+
+    size = s->band_stride * s->adm_h[0];
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 4; k++) {
+                s->band[i][j][k] = av_malloc_array(size, sizeof(float));
+                if (!s->band[i][j][k])
+                    return AVERROR(ENOMEM);
+            }
+        }
+    }
+    for (k = 0; k < 3; k++) {
+        s->csf_f[k]   = av_malloc_array(size, sizeof(float));
+        s->adm_num[k] = av_calloc(s->adm_h[0], sizeof(double));
+        s->adm_den[k] = av_calloc(s->adm_h[0], sizeof(double));
+        if (!s->csf_f[k] || !s->adm_num[k] || !s->adm_den[k])
+            return AVERROR(ENOMEM);
+    }
+
+    s->temp_size = 5 * s->stride;
+    s->temp = av_malloc_array(s->nb_jobs * s->temp_size, sizeof(float));
+    if (!s->temp)
+        return AVERROR(ENOMEM);
+
+    if ((ret = ff_vmafmotion_init(&s->motion, w, h, inlink->format)) < 0)
+        return ret;
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *mainlink = ctx->inputs[0];
+
+    outlink->w = mainlink->w;
+    outlink->h = mainlink->h;
+    outlink->time_base = mainlink->time_base;
+    outlink->sample_aspect_ratio = mainlink->sample_aspect_ratio;
+    outlink->frame_rate = mainlink->frame_rate;
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    int i, j, k;
+
+    if (s->nb_frames > 0) {
+        char buf[256];
+
+        buf[0] = 0;
+        for (k = 0; k < NB_FEATURES; k++)
+            av_strlcatf(buf, sizeof(buf), " %s:%f", feature_names[k],
+                        s->feature_sum[k] / s->nb_frames);
+        if (s->nb_sv)
+            av_log(ctx, AV_LOG_INFO, "VMAF score: %f\n", s->score_sum / s->nb_frames);
+        av_log(ctx, AV_LOG_INFO, "VMAF features:%s\n", buf);
+    }
+
+    ff_vmafmotion_uninit(&s->motion);
+
+    for (i = 0; i < NB_SCALES; i++) {
+        av_freep(&s->vif_ref[i]);
+        av_freep(&s->vif_dis[i]);
+        av_freep(&s->vif_num[i]);
+        av_freep(&s->vif_den[i]);
+    }
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 2; j++)
+            for (k = 0; k < 4; k++)
+                av_freep(&s->band[i][j][k]);
+    for (k = 0; k < 3; k++) {
+        av_freep(&s->csf_f[k]);
+        av_freep(&s->adm_num[k]);
+        av_freep(&s->adm_den[k]);
+    }
+    av_freep(&s->temp);
+    av_freep(&s->sv_coef);
+    av_freep(&s->sv);
+
+    av_frame_free(&s->in[0]);
+    av_frame_free(&s->in[1]);
+    av_frame_free(&s->pending);
+
+    if (s->stats_file && s->stats_file != stdout)
+        fclose(s->stats_file);
+}
+
+static const AVFilterPad vmaf_inputs[] = {
+    {
+        .name         = "main",
+        .type         = AVMEDIA_TYPE_VIDEO,
+    },{
+        .name         = "reference",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input_ref,
+    },
+    { NULL }
+};
+
+static const AVFilterPad vmaf_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_vmaf = {
+    .name          = "vmaf",
+    .description   = NULL_IF_CONFIG_SMALL("Calculate the VMAF between two video streams."),
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .activate      = activate,
+    .priv_size     = sizeof(VMAFContext),
+    .priv_class    = &vmaf_class,
+    .inputs        = vmaf_inputs,
+    .outputs       = vmaf_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
@@ -29,6 +29,9 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 
+#define FF_INTERNAL_FIELDS 1
+#include "framequeue.h"
+
 #include "avfilter.h"
 #include "internal.h"
 #include "video.h"
@@ -90,6 +93,7 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
     frame = ff_frame_pool_get(link->frame_pool);
     if (!frame)
         return NULL;
+    link->nb_pool_frames++;
 
     frame->sample_aspect_ratio = link->sample_aspect_ratio;
 
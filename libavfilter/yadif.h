@@ -86,7 +86,11 @@ typedef struct YADIFContext {
     int current_field;  ///< YADIFCurrentField
 } YADIFContext;
 
-void ff_yadif_init_x86(YADIFContext *yadif);
+/**
+ * Set filter_line and filter_edges for the given bit depth.
+ */
+void ff_yadif_init_filter_line(YADIFContext *yadif, int bit_depth);
+void ff_yadif_init_x86(YADIFContext *yadif, int bit_depth);
 
 int ff_yadif_filter_frame(AVFilterLink *link, AVFrame *frame);
 
@@ -1501,6 +1501,12 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_SHORTEST   0x100000 ///< Stop muxing when the shortest stream stops.
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Add bitstream filters as requested by the muxer
+/**
+ * Drop non-keyframe video packets inside the demuxer, without reading their
+ * payload where the container allows it. Supported by mov/mp4, matroska/webm
+ * and mpegts; other demuxers ignore it.
+ */
+#define AVFMT_FLAG_SKIP_NONKEY 0x400000
 
     /**
      * Maximum size of the data read from input for determining
@@ -2086,7 +2092,8 @@ int avformat_network_init(void);
 
 /**
  * Undo the initialization done by avformat_network_init. Call it only
- * once for each time you called avformat_network_init.
+ * once for each time you called avformat_network_init. This also closes
+ * the idle connections kept by the http connection_pool option.
  */
 int avformat_network_deinit(void);
 
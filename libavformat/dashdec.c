@@ -1833,7 +1833,9 @@ static int save_avio_options(AVFormatContext *s)
 {
     DASHContext *c = s->priv_data;
     const char *opts[] = {
-        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", NULL };
+        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout",
+        "connection_pool", "pool_idle_timeout", "parallel_requests",
+        "parallel_chunk_size", NULL };
     const char **opt = opts;
     uint8_t *buf = NULL;
     int ret = 0;
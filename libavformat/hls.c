@@ -1648,7 +1648,9 @@ static int save_avio_options(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
     static const char * const opts[] = {
-        "headers", "http_proxy", "user_agent", "cookies", "referer", "rw_timeout", NULL };
+        "headers", "http_proxy", "user_agent", "cookies", "referer", "rw_timeout",
+        "connection_pool", "pool_idle_timeout", "parallel_requests",
+        "parallel_chunk_size", NULL };
     const char * const * opt = opts;
     uint8_t *buf;
     int ret = 0;
@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+
 #include "config.h"
 
 #if CONFIG_ZLIB
@@ -27,9 +29,11 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -51,6 +55,7 @@
 #define HTTP_MUTLI    2
 #define MAX_EXPIRY    19
 #define WHITESPACES " \n\t\r"
+#define HTTP_POOL_SIZE 16
 typedef enum {
     LOWER_PROTO,
     READ_HEADERS,
@@ -58,6 +63,16 @@ typedef enum {
     FINISH
 }HandshakeState;
 
+/* A lower protocol connection that can outlive the HTTPContext that
+ * opened it, parked in the process-wide pool while idle. */
+typedef struct HTTPPoolConn {
+    URLContext *hd;
+    /* interrupt callback of the HTTPContext currently using hd */
+    AVIOInterruptCB int_cb;
+    char *key;
+    int64_t expires;
+} HTTPPoolConn;
+
 typedef struct HTTPContext {
     const AVClass *class;
     URLContext *hd;
@@ -126,6 +141,15 @@ typedef struct HTTPContext {
     int is_multi_client;
     HandshakeState handshake_step;
     int is_connected_server;
+    int connection_pool;
+    int pool_idle_timeout;
+    /* Set while hd may be handed over to the connection pool. */
+    HTTPPoolConn *pool_conn;
+    /* End of the body announced by Content-Range, 0 if none. */
+    uint64_t range_end;
+    int parallel_requests;
+    int parallel_chunk_size;
+    struct HTTPParallel *parallel;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -168,6 +192,10 @@ static const AVOption options[] = {
     { "listen", "listen on HTTP", OFFSET(listen), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 2, D | E },
     { "resource", "The resource requested by a client", OFFSET(resource), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reply_code", "The http status code to return to a client", OFFSET(reply_code), AV_OPT_TYPE_INT, { .i64 = 200}, INT_MIN, 599, E},
+    { "connection_pool", "reuse idle connections across requests and contexts", OFFSET(connection_pool), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "parallel_requests", "split reads of a known-size resource into this many concurrent range requests", OFFSET(parallel_requests), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 64, D },
+    { "parallel_chunk_size", "size of each range request made with parallel_requests", OFFSET(parallel_chunk_size), AV_OPT_TYPE_INT, { .i64 = 4 << 20 }, 64 << 10, INT_MAX / 2, D },
+    { "pool_idle_timeout", "time in seconds an idle pooled connection is kept", OFFSET(pool_idle_timeout), AV_OPT_TYPE_INT, { .i64 = 10 }, 0, INT_MAX / 1000000, D },
     { NULL }
 };
 
@@ -176,6 +204,219 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                         const char *proxyauth, int *new_location);
 static int http_read_header(URLContext *h, int *new_location);
 static int http_shutdown(URLContext *h, int flags);
+static void http_parallel_stop(HTTPContext *s);
+static int http_parallel_start(URLContext *h);
+
+static AVMutex pool_lock = AV_MUTEX_INITIALIZER;
+static HTTPPoolConn *pool[HTTP_POOL_SIZE];
+static int pool_nb;
+
+static int http_pool_interrupt_cb(void *opaque)
+{
+    HTTPPoolConn *conn = opaque;
+    return ff_check_interrupt(&conn->int_cb);
+}
+
+static void http_pool_conn_free(HTTPPoolConn **pconn)
+{
+    HTTPPoolConn *conn = *pconn;
+
+    if (!conn)
+        return;
+    ffurl_closep(&conn->hd);
+    av_freep(&conn->key);
+    av_freep(pconn);
+}
+
+/* Close the lower protocol connection, pooled or not. */
+static void http_close_hd(HTTPContext *s)
+{
+    if (s->pool_conn) {
+        s->hd = NULL;
+        http_pool_conn_free(&s->pool_conn);
+    } else {
+        ffurl_closep(&s->hd);
+    }
+}
+
+/* An idle connection must not have anything to read: either the server
+ * closed it or it sent data we cannot make sense of. */
+static int http_pool_conn_alive(HTTPPoolConn *conn)
+{
+    struct pollfd p = { 0 };
+
+    p.fd     = ffurl_get_file_handle(conn->hd);
+    p.events = POLLIN;
+    if (p.fd < 0)
+        return 1;
+    return !poll(&p, 1, 0);
+}
+
+/* The pool key is the lower protocol URL and the options it is opened
+ * with, leaving out the ones only meaningful to the http layer. */
+static char *http_pool_key(HTTPContext *s, const char *lower_url,
+                           AVDictionary *options)
+{
+    AVDictionaryEntry *e = NULL;
+    AVBPrint bp;
+    char *key;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&bp, "%s", lower_url);
+    while ((e = av_dict_get(options, "", e, AV_DICT_IGNORE_SUFFIX)))
+        if (!av_opt_find(s, e->key, NULL, 0, 0))
+            av_bprintf(&bp, "|%s=%s", e->key, e->value);
+    if (av_bprint_finalize(&bp, &key) < 0)
+        return NULL;
+    return key;
+}
+
+static int http_pool_take(URLContext *h, const char *key)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPPoolConn *conn = NULL, *dead[HTTP_POOL_SIZE];
+    int64_t now = av_gettime_relative();
+    int i, nb_dead = 0;
+
+    ff_mutex_lock(&pool_lock);
+    for (i = pool_nb - 1; i >= 0; i--) {
+        HTTPPoolConn *c = pool[i];
+        if (now > c->expires || !http_pool_conn_alive(c)) {
+            dead[nb_dead++] = c;
+        } else if (!conn && !strcmp(c->key, key)) {
+            conn = c;
+        } else {
+            continue;
+        }
+        memmove(pool + i, pool + i + 1, (pool_nb - i - 1) * sizeof(*pool));
+        pool_nb--;
+    }
+    ff_mutex_unlock(&pool_lock);
+
+    for (i = 0; i < nb_dead; i++)
+        http_pool_conn_free(&dead[i]);
+    if (!conn)
+        return 0;
+
+    av_log(h, AV_LOG_DEBUG, "Reusing pooled connection to %s\n", key);
+    conn->int_cb  = h->interrupt_callback;
+    s->pool_conn  = conn;
+    s->hd         = conn->hd;
+    s->line_count = 0;
+    return 1;
+}
+
+static void http_pool_put(HTTPContext *s)
+{
+    HTTPPoolConn *conn = s->pool_conn, *dead[HTTP_POOL_SIZE];
+    int64_t now = av_gettime_relative();
+    int i, nb_dead = 0;
+
+    memset(&conn->int_cb, 0, sizeof(conn->int_cb));
+    conn->expires = now + s->pool_idle_timeout * 1000000LL;
+    s->pool_conn  = NULL;
+    s->hd         = NULL;
+
+    ff_mutex_lock(&pool_lock);
+    /* drop the expired connections, then the oldest one if still full */
+    for (i = pool_nb - 1; i >= 0; i--) {
+        if (now <= pool[i]->expires)
+            continue;
+        dead[nb_dead++] = pool[i];
+        memmove(pool + i, pool + i + 1, (pool_nb - i - 1) * sizeof(*pool));
+        pool_nb--;
+    }
+    if (pool_nb == HTTP_POOL_SIZE) {
+        dead[nb_dead++] = pool[0];
+        memmove(pool, pool + 1, --pool_nb * sizeof(*pool));
+    }
+    pool[pool_nb++] = conn;
+    ff_mutex_unlock(&pool_lock);
+
+    for (i = 0; i < nb_dead; i++)
+        http_pool_conn_free(&dead[i]);
+}
+
+void ff_http_pool_close(void)
+{
+    HTTPPoolConn *conns[HTTP_POOL_SIZE];
+    int i, nb;
+
+    ff_mutex_lock(&pool_lock);
+    nb = pool_nb;
+    memcpy(conns, pool, nb * sizeof(*pool));
+    pool_nb = 0;
+    ff_mutex_unlock(&pool_lock);
+
+    for (i = 0; i < nb; i++)
+        http_pool_conn_free(&conns[i]);
+}
+
+/* Open a lower protocol connection; with the pool enabled, its interrupt
+ * callback is routed through the HTTPPoolConn so that it always reaches
+ * the context currently using it. */
+static int http_open_hd(URLContext *h, const char *lower_url, char *key,
+                        AVDictionary **options)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPPoolConn *conn;
+    AVIOInterruptCB int_cb;
+    int err;
+
+    if (!key)
+        return ffurl_open_whitelist(&s->hd, lower_url, AVIO_FLAG_READ_WRITE,
+                                    &h->interrupt_callback, options,
+                                    h->protocol_whitelist, h->protocol_blacklist, h);
+
+    conn = av_mallocz(sizeof(*conn));
+    if (!conn) {
+        av_free(key);
+        return AVERROR(ENOMEM);
+    }
+    conn->key    = key;
+    conn->int_cb = h->interrupt_callback;
+    int_cb.callback = http_pool_interrupt_cb;
+    int_cb.opaque   = conn;
+    err = ffurl_open_whitelist(&conn->hd, lower_url, AVIO_FLAG_READ_WRITE,
+                               &int_cb, options,
+                               h->protocol_whitelist, h->protocol_blacklist, h);
+    if (err < 0) {
+        http_pool_conn_free(&conn);
+        return err;
+    }
+    s->pool_conn = conn;
+    s->hd        = conn->hd;
+    return 0;
+}
+
+/* Whether the response has been fully consumed and the connection can
+ * carry another request. Write contexts never return their connection:
+ * the reply to their request is only flushed, not parsed, when the body
+ * ends, so it could still arrive on the next request using it. */
+static int http_conn_reusable(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    uint64_t body_end;
+
+    if (!s->pool_conn || s->willclose || (h->flags & AVIO_FLAG_WRITE) ||
+        s->buf_ptr != s->buf_end)
+        return 0;
+    if (s->chunksize != UINT64_MAX)
+        return s->chunkend;
+    body_end = s->range_end ? s->range_end : s->filesize;
+    return body_end != UINT64_MAX && s->off == body_end;
+}
+
+/* Whether the request can be sent again, i.e. is a GET or HEAD. */
+static int http_request_retryable(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+
+    if ((h->flags & AVIO_FLAG_WRITE) || s->post_data)
+        return 0;
+    return !s->method || !av_strcasecmp(s->method, "GET") ||
+           !av_strcasecmp(s->method, "HEAD");
+}
 
 void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
 {
@@ -194,7 +435,7 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err, location_changed = 0;
+    int port, use_proxy, err, location_changed = 0, reused = 0;
     HTTPContext *s = h->priv_data;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
@@ -233,15 +474,35 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
     if (!s->hd) {
-        err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                                   &h->interrupt_callback, options,
-                                   h->protocol_whitelist, h->protocol_blacklist, h);
-        if (err < 0)
+        char *key = NULL;
+        /* write contexts would not give it back, see http_conn_reusable() */
+        if (s->connection_pool && !(h->flags & AVIO_FLAG_WRITE)) {
+            if (!(key = http_pool_key(s, buf, *options)))
+                return AVERROR(ENOMEM);
+            reused = http_pool_take(h, key);
+        }
+        if (reused)
+            av_free(key);
+        else if ((err = http_open_hd(h, buf, key, options)) < 0)
             return err;
     }
 
     err = http_connect(h, path, local_path, hoststr,
                        auth, proxyauth, &location_changed);
+    /* The server may have dropped the idle connection just as we reused
+     * it; nothing has been received, so a request without side effects
+     * can be retried. */
+    if (err < 0 && reused && !s->line_count && http_request_retryable(h)) {
+        char *key = av_strdup(s->pool_conn->key);
+        av_log(h, AV_LOG_DEBUG, "Pooled connection failed, reconnecting\n");
+        http_close_hd(s);
+        if (!key)
+            return AVERROR(ENOMEM);
+        if ((err = http_open_hd(h, buf, key, options)) < 0)
+            return err;
+        err = http_connect(h, path, local_path, hoststr,
+                           auth, proxyauth, &location_changed);
+    }
     if (err < 0)
         return err;
 
@@ -268,7 +529,7 @@ redo:
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
             s->auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_close_hd(s);
             goto redo;
         } else
             goto fail;
@@ -276,7 +537,7 @@ redo:
     if (s->http_code == 407) {
         if ((cur_proxy_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
             s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_close_hd(s);
             goto redo;
         } else
             goto fail;
@@ -285,7 +546,7 @@ redo:
          s->http_code == 303 || s->http_code == 307) &&
         location_changed == 1) {
         /* url moved, get next */
-        ffurl_closep(&s->hd);
+        http_close_hd(s);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
         /* Restart the authentication process with the new target, which
@@ -299,7 +560,7 @@ redo:
 
 fail:
     if (s->hd)
-        ffurl_closep(&s->hd);
+        http_close_hd(s);
     if (location_changed < 0)
         return location_changed;
     return ff_http_averror(s->http_code, AVERROR(EIO));
@@ -318,6 +579,10 @@ int ff_http_do_new_request(URLContext *h, const char *uri)
           !strcmp(h->prot->name, "https")))
         return AVERROR(EINVAL);
 
+    /* the workers use the context until they are stopped, and the chunks
+     * queued so far belong to the previous resource */
+    http_parallel_stop(s);
+
     av_url_split(proto1, sizeof(proto1), NULL, 0,
                  hostname1, sizeof(hostname1), &port1,
                  NULL, 0, s->location);
@@ -353,6 +618,8 @@ int ff_http_do_new_request(URLContext *h, const char *uri)
     av_log(s, AV_LOG_INFO, "Opening \'%s\' for %s\n", uri, h->flags & AVIO_FLAG_WRITE ? "writing" : "reading");
     ret = http_open_cnx(h, &options);
     av_dict_free(&options);
+    if (ret >= 0 && s->parallel_requests > 1 && !(h->flags & AVIO_FLAG_WRITE))
+        ret = http_parallel_start(h);
     return ret;
 }
 
@@ -489,6 +756,338 @@ static int http_handshake(URLContext *c)
     return AVERROR(EINVAL);
 }
 
+#if HAVE_THREADS
+/* One byte range of the resource, filled by a worker and consumed in
+ * order by http_parallel_read(). */
+typedef struct HTTPChunk {
+    uint8_t *data;
+    uint64_t start;
+    int size;
+    int filled;
+    int err;
+    int fetching;
+    /* dropped by a seek while a worker was still filling it */
+    int abandoned;
+} HTTPChunk;
+
+typedef struct HTTPParallel {
+    URLContext *h;
+    pthread_t *threads;
+    int nb_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    /* chunks in file order, the first one is being read */
+    HTTPChunk **queue;
+    int nb_queue, max_queue;
+    uint64_t pos, next_start, end;
+    /* also read without the lock by the interrupt callback */
+    atomic_int abort;
+} HTTPParallel;
+
+static void http_chunk_free(HTTPChunk **pc)
+{
+    if (*pc)
+        av_freep(&(*pc)->data);
+    av_freep(pc);
+}
+
+/* Drop the first n queued chunks; the ones still being fetched are
+ * freed by their worker. Must be called with the lock held. */
+static void http_parallel_drop(HTTPParallel *p, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        if (p->queue[i]->fetching)
+            p->queue[i]->abandoned = 1;
+        else
+            http_chunk_free(&p->queue[i]);
+    }
+    memmove(p->queue, p->queue + n, (p->nb_queue - n) * sizeof(*p->queue));
+    p->nb_queue -= n;
+}
+
+static int http_parallel_interrupt_cb(void *opaque)
+{
+    HTTPParallel *p = opaque;
+    return atomic_load(&p->abort) || ff_check_interrupt(&p->h->interrupt_callback);
+}
+
+static int http_parallel_fetch(HTTPParallel *p, HTTPChunk *c)
+{
+    URLContext *h = p->h, *uc = NULL;
+    HTTPContext *s = h->priv_data;
+    AVIOInterruptCB int_cb = { http_parallel_interrupt_cb, p };
+    AVDictionary *opts = NULL;
+    int ret = 0, attempts, abandoned = 0;
+
+    for (attempts = 0; attempts < 3 && c->filled < c->size && !abandoned; attempts++) {
+        av_dict_copy(&opts, s->chained_options, 0);
+        av_dict_set_int(&opts, "offset", c->start + c->filled, 0);
+        av_dict_set_int(&opts, "end_offset", c->start + c->size, 0);
+        av_dict_set_int(&opts, "parallel_requests", 0, 0);
+        av_dict_set_int(&opts, "connection_pool", s->connection_pool, 0);
+        ret = ffurl_open_whitelist(&uc, s->location, AVIO_FLAG_READ, &int_cb,
+                                   &opts, h->protocol_whitelist,
+                                   h->protocol_blacklist, h);
+        av_dict_free(&opts);
+        if (ret < 0) {
+            if (ret == AVERROR_EXIT)
+                break;
+            continue;
+        }
+
+        while (c->filled < c->size && !abandoned) {
+            ret = ffurl_read(uc, c->data + c->filled, c->size - c->filled);
+            if (ret <= 0) {
+                if (!ret)
+                    ret = AVERROR_EOF;
+                break;
+            }
+            pthread_mutex_lock(&p->lock);
+            c->filled += ret;
+            abandoned  = c->abandoned || atomic_load(&p->abort);
+            pthread_cond_broadcast(&p->cond);
+            pthread_mutex_unlock(&p->lock);
+        }
+        ffurl_closep(&uc);
+        if (ret == AVERROR_EXIT)
+            break;
+    }
+    if (c->filled == c->size || abandoned)
+        return 0;
+    if (ret == AVERROR_EXIT)
+        return ret;
+    av_log(h, AV_LOG_ERROR, "Failed to fetch bytes %"PRIu64"-%"PRIu64": %s\n",
+           c->start, c->start + c->size - 1, av_err2str(ret));
+    return ret < 0 ? ret : AVERROR(EIO);
+}
+
+static void *http_parallel_worker(void *arg)
+{
+    HTTPParallel *p = arg;
+    HTTPContext *s = p->h->priv_data;
+    HTTPChunk *c;
+    int ret;
+
+    pthread_mutex_lock(&p->lock);
+    while (!atomic_load(&p->abort)) {
+        if (p->nb_queue == p->max_queue || p->next_start >= p->end) {
+            pthread_cond_wait(&p->cond, &p->lock);
+            continue;
+        }
+        c = av_mallocz(sizeof(*c));
+        if (c)
+            c->data = av_malloc(s->parallel_chunk_size);
+        if (!c || !c->data) {
+            http_chunk_free(&c);
+            atomic_store(&p->abort, 1);
+            break;
+        }
+        c->start  = p->next_start;
+        c->size   = FFMIN(s->parallel_chunk_size, p->end - p->next_start);
+        c->fetching = 1;
+        p->next_start += c->size;
+        p->queue[p->nb_queue++] = c;
+        pthread_mutex_unlock(&p->lock);
+
+        ret = http_parallel_fetch(p, c);
+
+        pthread_mutex_lock(&p->lock);
+        c->fetching = 0;
+        c->err      = ret;
+        if (c->abandoned)
+            http_chunk_free(&c);
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static void http_parallel_stop(HTTPContext *s)
+{
+    HTTPParallel *p = s->parallel;
+    int i;
+
+    if (!p)
+        return;
+    pthread_mutex_lock(&p->lock);
+    atomic_store(&p->abort, 1);
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    for (i = 0; i < p->nb_threads; i++)
+        pthread_join(p->threads[i], NULL);
+    for (i = 0; i < p->nb_queue; i++)
+        http_chunk_free(&p->queue[i]);
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->lock);
+    av_freep(&p->threads);
+    av_freep(&p->queue);
+    av_freep(&s->parallel);
+}
+
+/* Once the size of the resource is known, hand the rest of the transfer
+ * over to parallel_requests workers, each fetching parallel_chunk_size
+ * byte ranges; up to two chunks per worker are buffered ahead of the
+ * read position. */
+static int http_parallel_start(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPParallel *p;
+    uint64_t end = s->end_off ? s->end_off : s->filesize;
+    int i, ret;
+
+    if (h->is_streamed || s->chunksize != UINT64_MAX || s->icy_metaint ||
+#if CONFIG_ZLIB
+        s->compressed ||
+#endif
+        end == UINT64_MAX || end - s->off <= s->parallel_chunk_size) {
+        av_log(h, AV_LOG_VERBOSE, "Not using parallel requests for this resource\n");
+        return 0;
+    }
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    p->h          = h;
+    atomic_init(&p->abort, 0);
+    p->pos        = s->off;
+    p->next_start = s->off;
+    p->end        = end;
+    p->max_queue  = 2 * s->parallel_requests;
+    p->queue      = av_mallocz_array(p->max_queue, sizeof(*p->queue));
+    p->threads    = av_mallocz_array(s->parallel_requests, sizeof(*p->threads));
+    if (!p->queue || !p->threads) {
+        av_freep(&p->queue);
+        av_freep(&p->threads);
+        av_freep(&p);
+        return AVERROR(ENOMEM);
+    }
+    if ((ret = AVERROR(pthread_mutex_init(&p->lock, NULL)))) {
+        av_freep(&p->queue);
+        av_freep(&p->threads);
+        av_freep(&p);
+        return ret;
+    }
+    if ((ret = AVERROR(pthread_cond_init(&p->cond, NULL)))) {
+        pthread_mutex_destroy(&p->lock);
+        av_freep(&p->queue);
+        av_freep(&p->threads);
+        av_freep(&p);
+        return ret;
+    }
+    s->parallel = p;
+
+    for (i = 0; i < s->parallel_requests; i++) {
+        if ((ret = AVERROR(pthread_create(&p->threads[i], NULL,
+                                          http_parallel_worker, p)))) {
+            http_parallel_stop(s);
+            return ret;
+        }
+        p->nb_threads++;
+    }
+
+    /* the response already started on hd is not needed any more */
+    http_close_hd(s);
+    return 0;
+}
+
+static int http_parallel_read(URLContext *h, uint8_t *buf, int size)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPParallel *p = s->parallel;
+    int ret;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        HTTPChunk *c = p->nb_queue ? p->queue[0] : NULL;
+
+        if (p->pos >= p->end) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        if (c && p->pos < c->start + c->filled) {
+            ret = FFMIN(size, c->start + c->filled - p->pos);
+            memcpy(buf, c->data + (p->pos - c->start), ret);
+            p->pos += ret;
+            if (p->pos == c->start + c->size) {
+                http_parallel_drop(p, 1);
+                pthread_cond_broadcast(&p->cond);
+            }
+            break;
+        }
+        if (c && !c->fetching && c->err < 0) {
+            ret = c->err;
+            break;
+        }
+        if (atomic_load(&p->abort)) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        pthread_cond_wait(&p->cond, &p->lock);
+    }
+    s->off = p->pos;
+    pthread_mutex_unlock(&p->lock);
+    return ret;
+}
+
+static int64_t http_parallel_seek(URLContext *h, int64_t off, int whence)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPParallel *p = s->parallel;
+    int i;
+
+    if (whence == AVSEEK_SIZE)
+        return s->filesize;
+    if (whence == SEEK_CUR)
+        off += p->pos;
+    else if (whence == SEEK_END)
+        off += s->filesize;
+    else if (whence != SEEK_SET)
+        return AVERROR(EINVAL);
+    if (off < 0)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&p->lock);
+    /* keep the buffered chunks from the one holding the target on */
+    for (i = 0; i < p->nb_queue; i++)
+        if (p->queue[i]->start + p->queue[i]->size > off)
+            break;
+    if (i < p->nb_queue && p->queue[i]->start <= off) {
+        http_parallel_drop(p, i);
+    } else if (off < p->pos || off >= p->next_start) {
+        http_parallel_drop(p, p->nb_queue);
+        p->next_start = FFMIN(off, p->end);
+    }
+    p->pos = off;
+    s->off = off;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    return off;
+}
+#else
+static void http_parallel_stop(HTTPContext *s)
+{
+}
+
+static int http_parallel_start(URLContext *h)
+{
+    av_log(h, AV_LOG_WARNING, "parallel_requests needs thread support\n");
+    return 0;
+}
+
+static int http_parallel_read(URLContext *h, uint8_t *buf, int size)
+{
+    return AVERROR(ENOSYS);
+}
+
+static int64_t http_parallel_seek(URLContext *h, int64_t off, int whence)
+{
+    return AVERROR(ENOSYS);
+}
+#endif /* HAVE_THREADS */
+
 static int http_listen(URLContext *h, const char *uri, int flags,
                        AVDictionary **options) {
     HTTPContext *s = h->priv_data;
@@ -556,6 +1155,8 @@ static int http_open(URLContext *h, const char *uri, int flags,
         return http_listen(h, uri, flags, options);
     }
     ret = http_open_cnx(h, options);
+    if (ret >= 0 && s->parallel_requests > 1 && !(flags & AVIO_FLAG_WRITE))
+        ret = http_parallel_start(h);
     if (ret < 0)
         av_dict_free(&s->chained_options);
     return ret;
@@ -659,10 +1260,13 @@ static void parse_content_range(URLContext *h, const char *p)
 {
     HTTPContext *s = h->priv_data;
     const char *slash;
+    char *end;
 
     if (!strncmp(p, "bytes ", 6)) {
         p     += 6;
-        s->off = strtoull(p, NULL, 10);
+        s->off = strtoull(p, &end, 10);
+        if (*end == '-')
+            s->range_end = strtoull(end + 1, NULL, 10) + 1;
         if ((slash = strchr(p, '/')) && strlen(slash) > 0)
             s->filesize = strtoull(slash + 1, NULL, 10);
     }
@@ -1232,7 +1836,7 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                            "Expect: 100-continue\r\n");
 
     if (!has_header(s->headers, "\r\nConnection: ")) {
-        if (s->multiple_requests)
+        if (s->multiple_requests || s->pool_conn)
             len += av_strlcpy(headers + len, "Connection: keep-alive\r\n",
                               sizeof(headers) - len);
         else
@@ -1304,6 +1908,7 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
     s->off              = 0;
     s->icy_data_read    = 0;
     s->filesize         = UINT64_MAX;
+    s->range_end        = 0;
     s->willclose        = 0;
     s->end_chunked_post = 0;
     s->end_header       = 0;
@@ -1358,14 +1963,14 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
                    "Chunked encoding data size: %"PRIu64"\n",
                     s->chunksize);
 
-            if (!s->chunksize && s->multiple_requests) {
+            if (!s->chunksize && (s->multiple_requests || s->pool_conn)) {
                 http_get_line(s, line, sizeof(line)); // read empty chunk
                 s->chunkend = 1;
                 return 0;
             }
             else if (!s->chunksize) {
                 av_log(h, AV_LOG_DEBUG, "Last chunk received, closing conn\n");
-                ffurl_closep(&s->hd);
+                http_close_hd(s);
                 return 0;
             }
             else if (s->chunksize == UINT64_MAX) {
@@ -1580,6 +2185,9 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
 {
     HTTPContext *s = h->priv_data;
 
+    if (s->parallel)
+        return http_parallel_read(h, buf, size);
+
     if (s->icy_metaint > 0) {
         size = store_icy(h, size);
         if (size < 0)
@@ -1658,12 +2266,16 @@ static int http_close(URLContext *h)
     av_freep(&s->inflate_buffer);
 #endif /* CONFIG_ZLIB */
 
+    http_parallel_stop(s);
+
     if (s->hd && !s->end_chunked_post)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
-    if (s->hd)
-        ffurl_closep(&s->hd);
+    if (s->hd && http_conn_reusable(h))
+        http_pool_put(s);
+    else if (s->hd)
+        http_close_hd(s);
     av_dict_free(&s->chained_options);
     return ret;
 }
@@ -1672,6 +2284,7 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
 {
     HTTPContext *s = h->priv_data;
     URLContext *old_hd = s->hd;
+    HTTPPoolConn *old_pool_conn = s->pool_conn;
     uint64_t old_off = s->off;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size, ret;
@@ -1709,25 +2322,34 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
     /* we save the old context in case the seek fails */
     old_buf_size = s->buf_end - s->buf_ptr;
     memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
+    s->hd        = NULL;
+    s->pool_conn = NULL;
 
     /* if it fails, continue on old connection */
     if ((ret = http_open_cnx(h, &options)) < 0) {
         av_dict_free(&options);
         memcpy(s->buffer, old_buf, old_buf_size);
-        s->buf_ptr = s->buffer;
-        s->buf_end = s->buffer + old_buf_size;
-        s->hd      = old_hd;
-        s->off     = old_off;
+        s->buf_ptr   = s->buffer;
+        s->buf_end   = s->buffer + old_buf_size;
+        s->hd        = old_hd;
+        s->pool_conn = old_pool_conn;
+        s->off       = old_off;
         return ret;
     }
     av_dict_free(&options);
-    ffurl_close(old_hd);
+    if (old_pool_conn)
+        http_pool_conn_free(&old_pool_conn);
+    else
+        ffurl_close(old_hd);
     return off;
 }
 
 static int64_t http_seek(URLContext *h, int64_t off, int whence)
 {
+    HTTPContext *s = h->priv_data;
+
+    if (s->parallel)
+        return http_parallel_seek(h, off, whence);
     return http_seek_internal(h, off, whence, 0);
 }
 
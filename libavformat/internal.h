@@ -572,6 +572,15 @@ int ff_generate_avci_extradata(AVStream *st);
  */
 int ff_stream_add_bitstream_filter(AVStream *st, const char *name, const char *args);
 
+/**
+ * Check whether a demuxer should drop the non-keyframe packets of a stream,
+ * either because of the stream discard level or because
+ * AVFMT_FLAG_SKIP_NONKEY is set and the stream is video.
+ *
+ * @return 1 if non-keyframe packets should be dropped, 0 otherwise
+ */
+int ff_demux_skip_nonkey(const AVFormatContext *s, const AVStream *st);
+
 /**
  * Copy encoding parameters from source to destination stream
  *
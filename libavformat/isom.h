@@ -238,6 +238,7 @@ typedef struct MOVStreamContext {
     uint32_t format;
 
     int has_sidx;  // If there is an sidx entry for this stream.
+    int index_pending; ///< index construction deferred until the track is read
     struct {
         struct AVAESCTR* aes_ctr;
         unsigned int per_sample_iv_size;  // Either 0, 8, or 16.
@@ -294,6 +295,12 @@ typedef struct MOVContext {
     int decryption_key_len;
     int enable_drefs;
     int32_t movie_display_matrix[3][3]; ///< display matrix from mvhd
+    int lazy_index;         ///< only build the sample index of tracks that are read
+    int nb_pending_index;   ///< number of tracks whose index is not built yet
+    int64_t last_dts;       ///< dts of the last returned sample, in AV_TIME_BASE
+    int frag_window_size;   ///< number of fragments kept in the index, 0 for all
+    int frag_trimmed;       ///< fragments were dropped from the index by frag_window_size
+    int64_t frag_first_moof; ///< offset of the first fragment, to read a trimmed file again
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
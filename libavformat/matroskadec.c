@@ -1053,6 +1053,71 @@ static int matroska_ebmlnum_sint(MatroskaDemuxContext *matroska,
     return res;
 }
 
+/*
+ * Read a SimpleBlock as binary data. When non-keyframes are to be skipped,
+ * the block header is read first and non-keyframe blocks of such streams
+ * are skipped without reading their payload; they are returned with size 0.
+ * 0 is success, < 0 or NEEDS_CHECKING is failure.
+ */
+static int matroska_read_simpleblock(MatroskaDemuxContext *matroska,
+                                     int length, int64_t pos, EbmlBin *bin)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+    MatroskaTrack *tracks = matroska->tracks.elem;
+    uint8_t header[8 + 3];
+    int header_size = FFMIN(length, sizeof(header));
+    uint64_t num;
+    int i, n, ret;
+
+    /* whole discarded tracks are dropped later anyway, they do not need
+     * the split read */
+    for (i = 0; i < matroska->tracks.nb_elem; i++)
+        if (tracks[i].stream && tracks[i].stream->discard < AVDISCARD_ALL &&
+            ff_demux_skip_nonkey(matroska->ctx, tracks[i].stream))
+            break;
+    if (i == matroska->tracks.nb_elem)
+        return ebml_read_binary(pb, length, pos, bin);
+
+    if ((ret = avio_read(pb, header, header_size)) != header_size)
+        return ret < 0 ? ret : NEEDS_CHECKING;
+
+    if (header_size > 3 &&
+        (n = matroska_ebmlnum_uint(matroska, header, header_size, &num)) > 0 &&
+        n + 3 <= header_size && !(header[n + 2] & 0x80)) {
+        for (i = 0; i < matroska->tracks.nb_elem; i++) {
+            if (tracks[i].num != num)
+                continue;
+            if (tracks[i].stream && tracks[i].stream->discard < AVDISCARD_ALL &&
+                ff_demux_skip_nonkey(matroska->ctx, tracks[i].stream)) {
+                if ((ret = avio_skip(pb, length - header_size)) < 0)
+                    return ret;
+                bin->size = 0;
+                return 0;
+            }
+            break;
+        }
+    }
+
+    ret = av_buffer_realloc(&bin->buf, length + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (ret < 0)
+        return ret;
+    memset(bin->buf->data + length, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    memcpy(bin->buf->data, header, header_size);
+
+    bin->data = bin->buf->data;
+    bin->size = length;
+    bin->pos  = pos;
+    length   -= header_size;
+    if ((ret = avio_read(pb, bin->data + header_size, length)) != length) {
+        av_buffer_unref(&bin->buf);
+        bin->data = NULL;
+        bin->size = 0;
+        return ret < 0 ? ret : NEEDS_CHECKING;
+    }
+
+    return 0;
+}
+
 static int ebml_parse(MatroskaDemuxContext *matroska,
                       EbmlSyntax *syntax, void *data);
 
@@ -1382,7 +1447,10 @@ static int ebml_parse(MatroskaDemuxContext *matroska,
         res = ebml_read_ascii(pb, length, data);
         break;
     case EBML_BIN:
-        res = ebml_read_binary(pb, length, pos_alt, data);
+        if (id == MATROSKA_ID_SIMPLEBLOCK)
+            res = matroska_read_simpleblock(matroska, length, pos_alt, data);
+        else
+            res = ebml_read_binary(pb, length, pos_alt, data);
         break;
     case EBML_LEVEL1:
     case EBML_NEST:
@@ -4045,6 +4045,33 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     mov_estimate_video_delay(mov, st);
 }
 
+/* free the sample tables once the index has been built from them */
+static void mov_free_sample_tables(MOVStreamContext *sc)
+{
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stts_data);
+    av_freep(&sc->stps_data);
+    av_freep(&sc->elst_data);
+    av_freep(&sc->rap_group);
+}
+
+/* build the index of a track whose construction was deferred by lazy_index */
+static void mov_build_pending_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (!sc->index_pending)
+        return;
+    sc->index_pending = 0;
+    mov->nb_pending_index--;
+    mov_build_index(mov, st);
+    mov_free_sample_tables(sc);
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && st->codecpar->codec_id == AV_CODEC_ID_AAC)
+        st->skip_samples = sc->start_pad;
+}
+
 static int test_same_origin(const char *src, const char *ref) {
     char src_proto[64];
     char ref_proto[64];
@@ -4203,7 +4230,12 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 
     avpriv_set_pts_info(st, 64, 1, sc->time_scale);
 
-    mov_build_index(c, st);
+    if (c->lazy_index) {
+        sc->index_pending = 1;
+        c->nb_pending_index++;
+    } else {
+        mov_build_index(c, st);
+    }
 
     if (sc->dref_id-1 < sc->drefs_count && sc->drefs[sc->dref_id-1].path) {
         MOVDref *dref = &sc->drefs[sc->dref_id - 1];
@@ -4273,14 +4305,8 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             st->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
-    av_freep(&sc->elst_data);
-    av_freep(&sc->rap_group);
+    if (!sc->index_pending)
+        mov_free_sample_tables(sc);
 
     return 0;
 }
@@ -4716,6 +4742,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    mov_build_pending_index(c, st);
 
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
@@ -6866,15 +6893,19 @@ static int mov_read_default(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         } else {
             int64_t start_pos = avio_tell(pb);
             int64_t left;
+            int forward;
             int err = parse(c, pb, a);
             if (err < 0) {
                 c->atom_depth --;
                 return err;
             }
+            /* with a fragment window, read the fragments one at a time
+             * while demuxing, like on non-seekable input */
+            forward = !(pb->seekable & AVIO_SEEKABLE_NORMAL) || c->fc->flags & AVFMT_FLAG_IGNIDX ||
+                      c->frag_index.complete || c->frag_window_size > 0;
             if (c->found_moov && c->found_mdat &&
-                ((!(pb->seekable & AVIO_SEEKABLE_NORMAL) || c->fc->flags & AVFMT_FLAG_IGNIDX || c->frag_index.complete) ||
-                 start_pos + a.size == avio_size(pb))) {
-                if (!(pb->seekable & AVIO_SEEKABLE_NORMAL) || c->fc->flags & AVFMT_FLAG_IGNIDX || c->frag_index.complete)
+                (forward || start_pos + a.size == avio_size(pb))) {
+                if (forward)
                     c->next_root_atom = start_pos + a.size;
                 c->atom_depth --;
                 return 0;
@@ -7005,6 +7036,7 @@ static void mov_read_chapters(AVFormatContext *s)
             av_log(s, AV_LOG_ERROR, "Referenced QT chapter track not found\n");
             continue;
         }
+        mov_build_pending_index(mov, st);
 
         sc = st->priv_data;
         cur_pos = avio_tell(sc->pb);
@@ -7424,8 +7456,10 @@ static int mov_read_header(AVFormatContext *s)
             mov_read_chapters(s);
         for (i = 0; i < s->nb_streams; i++)
             if (s->streams[i]->codecpar->codec_tag == AV_RL32("tmcd")) {
+                mov_build_pending_index(mov, s->streams[i]);
                 mov_read_timecode_track(s, s->streams[i]);
             } else if (s->streams[i]->codecpar->codec_tag == AV_RL32("rtmd")) {
+                mov_build_pending_index(mov, s->streams[i]);
                 mov_read_rtmd_track(s, s->streams[i]);
             }
     }
@@ -7451,11 +7485,18 @@ static int mov_read_header(AVFormatContext *s)
     }
     export_orphan_timecode(s);
 
+    /* fragments and their index lookups expect the moov samples to be indexed */
+    if (mov->nb_pending_index && (mov->frag_index.nb_items || mov->trex_data))
+        for (i = 0; i < s->nb_streams; i++)
+            mov_build_pending_index(mov, s->streams[i]);
+    mov->last_dts = AV_NOPTS_VALUE;
+
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *st = s->streams[i];
         MOVStreamContext *sc = st->priv_data;
         fix_timescale(mov, sc);
-        if(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && st->codecpar->codec_id == AV_CODEC_ID_AAC) {
+        if(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && st->codecpar->codec_id == AV_CODEC_ID_AAC &&
+           !sc->index_pending) {
             st->skip_samples = sc->start_pad;
         }
         if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && sc->nb_frames_for_fps > 0 && sc->duration_for_fps > 0)
@@ -7623,6 +7664,90 @@ static int should_retry(AVIOContext *pb, int error_code) {
     return 1;
 }
 
+/* first sample index entry of track id in the fragments from index on, or -1 */
+static int frag_first_index_entry(MOVFragmentIndex *frag_index, int index, int id)
+{
+    for (; index < frag_index->nb_items; index++) {
+        MOVFragmentStreamInfo *info = get_frag_stream_info(frag_index, index, id);
+        if (info && info->index_entry >= 0)
+            return info->index_entry;
+    }
+    return -1;
+}
+
+/**
+ * Drop the oldest fragments from the fragment index, and their samples
+ * from the sample index, once everything in them has been read, so that
+ * at most frag_window_size fragments stay indexed.
+ */
+static void mov_trim_fragments(AVFormatContext *s)
+{
+    MOVContext *mov = s->priv_data;
+    MOVFragmentIndex *frag_index = &mov->frag_index;
+    int drop = frag_index->nb_items - mov->frag_window_size;
+    int i, j;
+
+    if (mov->frag_window_size <= 0 || drop <= 0)
+        return;
+
+    /* keep the current fragment and any fragment with unread samples */
+    for (; drop > 0; drop--) {
+        if (frag_index->item[drop - 1].moof_offset >= mov->fragment.moof_offset)
+            continue;
+        for (i = 0; i < s->nb_streams; i++) {
+            MOVStreamContext *sc = s->streams[i]->priv_data;
+            if (frag_first_index_entry(frag_index, drop, s->streams[i]->id) > sc->current_sample)
+                break;
+        }
+        if (i == s->nb_streams)
+            break;
+    }
+    if (drop <= 0)
+        return;
+
+    if (!mov->frag_trimmed)
+        mov->frag_first_moof = frag_index->item[0].moof_offset;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        MOVStreamContext *sc = st->priv_data;
+        int entry = frag_first_index_entry(frag_index, drop, st->id);
+        int cut = FFMIN(sc->current_sample, st->nb_index_entries);
+
+        if (entry >= 0)
+            cut = FFMIN(cut, entry);
+        /* only per-sample ctts and indexes without edit list ranges can be cut */
+        if (cut <= 0 || sc->index_ranges ||
+            (sc->ctts_data && sc->ctts_count != st->nb_index_entries))
+            continue;
+
+        memmove(st->index_entries, st->index_entries + cut,
+                (st->nb_index_entries - cut) * sizeof(*st->index_entries));
+        st->nb_index_entries -= cut;
+        if (sc->ctts_data) {
+            memmove(sc->ctts_data, sc->ctts_data + cut,
+                    (sc->ctts_count - cut) * sizeof(*sc->ctts_data));
+            sc->ctts_count -= cut;
+            sc->ctts_index  = FFMAX(sc->ctts_index - cut, 0);
+        }
+        sc->current_sample -= cut;
+        sc->current_index  -= cut;
+        fix_frag_index_entries(frag_index, drop, st->id, -cut);
+    }
+
+    for (i = 0; i < drop; i++) {
+        MOVFragmentStreamInfo *info = frag_index->item[i].stream_info;
+        for (j = 0; j < frag_index->item[i].nb_stream_info; j++)
+            mov_free_encryption_index(&info[j].encryption_index);
+        av_freep(&frag_index->item[i].stream_info);
+    }
+    memmove(frag_index->item, frag_index->item + drop,
+            (frag_index->nb_items - drop) * sizeof(*frag_index->item));
+    frag_index->nb_items -= drop;
+    frag_index->current   = FFMAX(frag_index->current - drop, -1);
+    mov->frag_trimmed     = 1;
+}
+
 static int mov_switch_root(AVFormatContext *s, int64_t target, int index)
 {
     int ret;
@@ -7655,6 +7780,8 @@ static int mov_switch_root(AVFormatContext *s, int64_t target, int index)
         return AVERROR_EOF;
     av_log(s, AV_LOG_TRACE, "read fragments, offset 0x%"PRIx64"\n", avio_tell(s->pb));
 
+    mov_trim_fragments(s);
+
     return 1;
 }
 
@@ -7681,6 +7808,34 @@ static int mov_change_extradata(MOVStreamContext *sc, AVPacket *pkt)
     return 0;
 }
 
+static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags);
+
+/**
+ * Build the deferred index of every track that is not discarded. Tracks
+ * that become wanted in the middle of demuxing start at the keyframe
+ * before the last returned sample.
+ */
+static void mov_build_selected_indexes(AVFormatContext *s)
+{
+    MOVContext *mov = s->priv_data;
+    int i;
+
+    for (i = 0; i < s->nb_streams && mov->nb_pending_index; i++) {
+        AVStream *st = s->streams[i];
+        MOVStreamContext *sc = st->priv_data;
+
+        if (!sc->index_pending || st->discard == AVDISCARD_ALL)
+            continue;
+        mov_build_pending_index(mov, st);
+        if (mov->last_dts != AV_NOPTS_VALUE && st->nb_index_entries) {
+            mov_seek_stream(s, st, av_rescale(mov->last_dts, sc->time_scale, AV_TIME_BASE),
+                            AVSEEK_FLAG_BACKWARD);
+            if (mov->last_dts > 0)
+                st->skip_samples = 0;
+        }
+    }
+}
+
 static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
@@ -7691,6 +7846,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     int ret;
     mov->fc = s;
  retry:
+    if (mov->nb_pending_index)
+        mov_build_selected_indexes(s);
     sample = mov_find_next_sample(s, &st);
     if (!sample || (mov->next_root_atom && sample->pos > mov->next_root_atom)) {
         if (!mov->next_root_atom)
@@ -7700,6 +7857,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         goto retry;
     }
     sc = st->priv_data;
+    mov->last_dts = av_rescale(sample->timestamp, AV_TIME_BASE, sc->time_scale);
     /* must be done just before reading, to avoid infinite loop on sample */
     current_index = sc->current_index;
     mov_current_sample_inc(sc);
@@ -7709,6 +7867,29 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         sample->size = FFMIN(sample->size, (mov->next_root_atom - sample->pos));
     }
 
+    if (st->discard != AVDISCARD_ALL && !(sample->flags & AVINDEX_KEYFRAME) &&
+        ff_demux_skip_nonkey(s, st)) {
+        /* Drop the sample without seeking or reading, only keep the
+         * ctts and stsc positions in sync with the sample index. */
+        if (sc->ctts_data && sc->ctts_index < sc->ctts_count) {
+            sc->ctts_sample++;
+            if (sc->ctts_index < sc->ctts_count &&
+                sc->ctts_data[sc->ctts_index].count == sc->ctts_sample) {
+                sc->ctts_index++;
+                sc->ctts_sample = 0;
+            }
+        }
+        if (sc->stsc_data) {
+            sc->stsc_sample++;
+            if (mov_stsc_index_valid(sc->stsc_index, sc->stsc_count) &&
+                mov_get_stsc_samples(sc, sc->stsc_index) == sc->stsc_sample) {
+                sc->stsc_index++;
+                sc->stsc_sample = 0;
+            }
+        }
+        goto retry;
+    }
+
     if (st->discard != AVDISCARD_ALL) {
         int64_t ret64 = avio_seek(sc->pb, sample->pos, SEEK_SET);
         if (ret64 != sample->pos) {
@@ -7720,11 +7901,6 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             return AVERROR_INVALIDDATA;
         }
 
-        if( st->discard == AVDISCARD_NONKEY && 0==(sample->flags & AVINDEX_KEYFRAME) ) {
-            av_log(mov->fc, AV_LOG_DEBUG, "Nonkey frame from stream %d discarded due to AVDISCARD_NONKEY\n", sc->ffindex);
-            goto retry;
-        }
-
         ret = av_get_packet(sc->pb, pkt, sample->size);
         if (ret < 0) {
             if (should_retry(sc->pb, ret)) {
@@ -7815,6 +7991,144 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+/**
+ * Drop the sample and fragment index and read the file again from its
+ * first fragment, to seek before the fragment window. The fragments of a
+ * file without sidx are found by reading it in order, and the samples of
+ * the moov are not read again, so this is only possible when all the
+ * samples are in fragments.
+ */
+static int mov_restart_fragments(AVFormatContext *s)
+{
+    MOVContext *mov = s->priv_data;
+    MOVFragmentIndex *frag_index = &mov->frag_index;
+    int i, j;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        MOVStreamContext *sc = s->streams[i]->priv_data;
+        if (sc->sample_count || sc->index_ranges) {
+            av_log(s, AV_LOG_ERROR, "Cannot seek before the %d fragments kept by "
+                   "frag_window_size\n", mov->frag_window_size);
+            return AVERROR(EINVAL);
+        }
+    }
+
+    for (i = 0; i < s->nb_streams; i++) {
+        MOVStreamContext *sc = s->streams[i]->priv_data;
+        s->streams[i]->nb_index_entries = 0;
+        sc->ctts_count  = 0;
+        sc->ctts_index  = 0;
+        sc->ctts_sample = 0;
+        sc->track_end   = 0;
+        mov_current_sample_set(sc, 0);
+    }
+    for (i = 0; i < frag_index->nb_items; i++) {
+        MOVFragmentStreamInfo *info = frag_index->item[i].stream_info;
+        for (j = 0; j < frag_index->item[i].nb_stream_info; j++)
+            mov_free_encryption_index(&info[j].encryption_index);
+        av_freep(&frag_index->item[i].stream_info);
+    }
+    frag_index->nb_items = 0;
+    frag_index->current  = -1;
+    mov->frag_trimmed    = 0;
+
+    return mov_switch_root(s, mov->frag_first_moof, -1);
+}
+
+/**
+ * Check whether a track aligned on timestamp of st after a seek would
+ * need samples the fragment window dropped already.
+ */
+static int mov_fragments_dropped(AVFormatContext *s, AVStream *st, int64_t timestamp)
+{
+    MOVContext *mov = s->priv_data;
+    int i;
+
+    for (i = 0; i < s->nb_streams && mov->frag_trimmed; i++) {
+        AVStream *st2 = s->streams[i];
+        if (st2->discard == AVDISCARD_ALL || !st2->nb_index_entries)
+            continue;
+        if (av_rescale_q(timestamp, st->time_base, st2->time_base) < st2->index_entries[0].timestamp)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * Parse the fragments following the fragment window until timestamp is
+ * indexed, dropping the skipped ones on the way but keeping the fragments
+ * from the last keyframe on, and the one before the last for the tracks
+ * that are stored late.
+ */
+static int mov_scan_fragments(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
+{
+    MOVContext *mov = s->priv_data;
+    int i, key, prev, ret;
+
+    while (mov->next_root_atom) {
+        for (key = st->nb_index_entries - 1; key >= 0; key--)
+            if (flags & AVSEEK_FLAG_ANY ||
+                st->index_entries[key].flags & AVINDEX_KEYFRAME)
+                break;
+        if (key >= 0 && st->index_entries[st->nb_index_entries - 1].timestamp >= timestamp &&
+            (flags & AVSEEK_FLAG_BACKWARD || st->index_entries[key].timestamp >= timestamp))
+            break;
+        prev = search_frag_moof_offset(&mov->frag_index, mov->fragment.moof_offset) - 1;
+        for (i = 0; i < s->nb_streams; i++) {
+            AVStream *st2 = s->streams[i];
+            int entry = frag_first_index_entry(&mov->frag_index, FFMAX(prev, 0), st2->id);
+            if (entry < 0)
+                entry = st2->nb_index_entries;
+            if (st2 == st && key >= 0)
+                entry = FFMIN(entry, key);
+            mov_current_sample_set(st2->priv_data, entry);
+        }
+        ret = mov_switch_root(s, mov->next_root_atom, -1);
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/**
+ * Without a complete fragment index, the fragment window only holds the
+ * fragments around the read position: read the file again from its first
+ * fragment when the seek lands before the window, and parse the following
+ * fragments when it lands after it. Only the stream the seek is done on
+ * moves the window, the other tracks are aligned on the sample found.
+ */
+static int mov_seek_fragment_window(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
+{
+    MOVContext *mov = s->priv_data;
+    MOVStreamContext *sc = st->priv_data;
+    int sample, ret;
+
+    if (mov->frag_window_size <= 0 || mov->frag_index.complete)
+        return 0;
+
+    timestamp -= sc->min_corrected_pts + sc->dts_shift;
+    if (mov_fragments_dropped(s, st, timestamp)) {
+        ret = mov_restart_fragments(s);
+        if (ret < 0 && ret != AVERROR_EOF)
+            return ret;
+    }
+    ret = mov_scan_fragments(s, st, timestamp, flags);
+    if (ret < 0)
+        return ret;
+
+    /* a backward seek can land before the samples other tracks kept */
+    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sample < 0 || !mov_fragments_dropped(s, st, st->index_entries[sample].timestamp))
+        return 0;
+    ret = mov_restart_fragments(s);
+    if (ret < 0 && ret != AVERROR_EOF)
+        return ret;
+    return mov_scan_fragments(s, st, timestamp, flags);
+}
+
 static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp)
 {
     MOVContext *mov = s->priv_data;
@@ -7893,15 +8207,25 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
     MOVContext *mc = s->priv_data;
     AVStream *st;
     int sample;
-    int i;
+    int i, ret;
 
     if (stream_index >= s->nb_streams)
         return AVERROR_INVALIDDATA;
 
     st = s->streams[stream_index];
+    /* with seek_streams_individually, the other tracks are positioned
+     * when their index gets built */
+    mov_build_pending_index(mc, st);
+    for (i = 0; i < s->nb_streams && mc->nb_pending_index && !mc->seek_individually; i++)
+        if (s->streams[i]->discard != AVDISCARD_ALL)
+            mov_build_pending_index(mc, s->streams[i]);
+    ret = mov_seek_fragment_window(s, st, sample_time, flags);
+    if (ret < 0)
+        return ret;
     sample = mov_seek_stream(s, st, sample_time, flags);
     if (sample < 0)
         return sample;
+    mc->last_dts = av_rescale_q(st->index_entries[sample].timestamp, st->time_base, AV_TIME_BASE_Q);
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
@@ -7913,11 +8237,14 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
             st = s->streams[i];
             st->skip_samples = (sample_time <= 0) ? sc->start_pad : 0;
 
-            if (stream_index == i)
+            if (stream_index == i || sc->index_pending)
                 continue;
 
             timestamp = av_rescale_q(seek_timestamp, s->streams[stream_index]->time_base, st->time_base);
-            mov_seek_stream(s, st, timestamp, flags);
+            /* the fragment window may not index this track up to the
+             * target yet, continue it from the next fragment */
+            if (mov_seek_stream(s, st, timestamp, flags) < 0 && mc->frag_window_size > 0)
+                mov_current_sample_set(sc, st->nb_index_entries);
         }
     } else {
         for (i = 0; i < s->nb_streams; i++) {
@@ -7983,6 +8310,10 @@ static const AVOption mov_options[] = {
     { "decryption_key", "The media decryption key (hex)", OFFSET(decryption_key), AV_OPT_TYPE_BINARY, .flags = AV_OPT_FLAG_DECODING_PARAM },
     { "enable_drefs", "Enable external track support.", OFFSET(enable_drefs), AV_OPT_TYPE_BOOL,
         {.i64 = 0}, 0, 1, FLAGS },
+    { "frag_window_size", "Number of fragments to keep indexed when reading fragmented files, 0 keeps all",
+        OFFSET(frag_window_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, FLAGS },
+    { "lazy_index", "Only build the sample index of tracks when they are first read",
+        OFFSET(lazy_index), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, FLAGS },
 
     { NULL },
 };
@@ -98,6 +98,7 @@ struct MpegTSFilter {
     int last_cc; /* last cc code (-1 if first packet) */
     int64_t last_pcr;
     int discard;
+    unsigned discard_gen; /* MpegTSContext.discard_gen discard was computed for */
     enum MpegTSFilterType type;
     union {
         MpegTSPESFilter pes_filter;
@@ -164,6 +165,12 @@ struct MpegTSContext {
     unsigned int nb_prg;
     struct Program *prg;
 
+    /** bumped whenever the result of discard_pid() may have changed */
+    unsigned discard_gen;
+    /** AVProgram.discard values discard_gen was last checked against */
+    enum AVDiscard *prg_discard;
+    int nb_prg_discard;
+
     int8_t crc_validity[NB_PID_MAX];
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
@@ -255,6 +262,8 @@ typedef struct PESContext {
     AVBufferRef *buffer;
     SLConfigDescr sl;
     int merged_st;
+    int random_access;      /**< random_access_indicator of the current PES packet */
+    int seen_random_access; /**< random_access_indicator was seen on this PID */
 } PESContext;
 
 extern AVInputFormat ff_mpegts_demuxer;
@@ -295,12 +304,14 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
             ts->prg[i].nb_pids = 0;
             ts->prg[i].pmt_found = 0;
         }
+    ts->discard_gen++;
 }
 
 static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg = 0;
+    ts->discard_gen++;
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -333,6 +344,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
             return;
 
     p->pids[p->nb_pids++] = pid;
+    ts->discard_gen++;
 }
 
 static void set_pmt_found(MpegTSContext *ts, unsigned int programid)
@@ -408,6 +420,35 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+/**
+ * Invalidate the cached discard_pid() results if the caller changed the
+ * discard flag of any program since the last call.
+ */
+static void check_program_discard(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i, changed = 0;
+
+    if (ts->nb_prg_discard != s->nb_programs) {
+        if (av_reallocp_array(&ts->prg_discard, s->nb_programs,
+                              sizeof(*ts->prg_discard)) < 0) {
+            ts->nb_prg_discard = 0;
+            ts->discard_gen++;
+            return;
+        }
+        ts->nb_prg_discard = s->nb_programs;
+        changed = 1;
+    }
+    for (i = 0; i < s->nb_programs; i++) {
+        if (ts->prg_discard[i] != s->programs[i]->discard) {
+            ts->prg_discard[i] = s->programs[i]->discard;
+            changed = 1;
+        }
+    }
+    if (changed)
+        ts->discard_gen++;
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -497,6 +538,7 @@ static MpegTSFilter *mpegts_open_filter(MpegTSContext *ts, unsigned int pid,
     filter->pid     = pid;
     filter->es_id   = -1;
     filter->last_cc = -1;
+    filter->discard_gen = ts->discard_gen - 1;
     filter->last_pcr= -1;
 
     return filter;
@@ -1153,6 +1195,12 @@ static int mpegts_push_data(MpegTSFilter *filter,
                         code == 0x1be) /* padding_stream */
                         goto skip;
 
+                    /* Only trust the random_access_indicator for dropping
+                     * non-keyframes once the muxer has been seen setting it. */
+                    if (pes->st && !pes->sub_st && pes->seen_random_access &&
+                        !pes->random_access && ff_demux_skip_nonkey(ts->stream, pes->st))
+                        goto skip;
+
                     /* stream not present in PMT */
                     if (!pes->st) {
                         if (ts->skip_changes)
@@ -2594,8 +2642,10 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     }
     if (!tss)
         return 0;
-    if (is_start)
-        tss->discard = discard_pid(ts, pid);
+    if (is_start && tss->discard_gen != ts->discard_gen) {
+        tss->discard     = discard_pid(ts, pid);
+        tss->discard_gen = ts->discard_gen;
+    }
     if (tss->discard)
         return 0;
     ts->current_pid = pid;
@@ -2708,6 +2758,13 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
         int ret;
         // Note: The position here points actually behind the current packet.
         if (tss->type == MPEGTS_PES) {
+            if (is_start) {
+                PESContext *pc = tss->u.pes_filter.opaque;
+                pc->random_access = has_adaptation &&
+                                    packet[4] != 0 && /* with length > 0 */
+                                    (packet[5] & 0x40); /* and random access indicated */
+                pc->seen_random_access |= pc->random_access;
+            }
             if ((ret = tss->u.pes_filter.pes_cb(tss, p, p_end - p, is_start,
                                                 pos - ts->raw_packet_size)) < 0)
                 return ret;
@@ -2767,15 +2824,32 @@ static int mpegts_resync(AVFormatContext *s, int seekback, const uint8_t *curren
         return 0;
     }
 
-    for (i = 0; i < ts->resync_size; i++) {
-        c = avio_r8(pb);
-        if (avio_feof(pb))
-            return AVERROR_EOF;
-        if (c == 0x47) {
-            avio_seek(pb, -1, SEEK_CUR);
+    for (i = 0; i < ts->resync_size; ) {
+        int len = FFMIN(pb->buf_end - pb->buf_ptr, ts->resync_size - i);
+        const uint8_t *sync;
+
+        if (len <= 0) {
+            /* nothing buffered, read a single byte to refill */
+            c = avio_r8(pb);
+            if (avio_feof(pb))
+                return AVERROR_EOF;
+            if (c == 0x47) {
+                avio_seek(pb, -1, SEEK_CUR);
+                reanalyze(s->priv_data);
+                return 0;
+            }
+            i++;
+            continue;
+        }
+        /* scan whatever is buffered at once */
+        sync = memchr(pb->buf_ptr, 0x47, len);
+        if (sync) {
+            avio_skip(pb, sync - pb->buf_ptr);
             reanalyze(s->priv_data);
             return 0;
         }
+        avio_skip(pb, len);
+        i += len;
     }
     av_log(s, AV_LOG_ERROR,
            "max resync size reached, could not find sync byte\n");
@@ -2817,6 +2891,75 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/* return 1 if handle_packet() would ignore the packet entirely */
+static av_always_inline int packet_is_dropped(MpegTSContext *ts, const uint8_t *packet,
+                                              int *skipped_pes)
+{
+    int pid = AV_RB16(packet + 1) & 0x1fff;
+    int is_start = packet[1] & 0x40;
+    MpegTSFilter *tss = ts->pids[pid];
+    PESContext *pes;
+    int cc;
+
+    if (!tss)
+        return !(ts->auto_guess && is_start);
+    if (!is_start || tss->discard_gen == ts->discard_gen) {
+        if (tss->discard)
+            return 1;
+    } else {
+        return 0;
+    }
+
+    /* payload of a stream the caller does not want, between two PES
+     * headers; only taken for plain in-sequence payload packets so that
+     * the continuity, corruption and PCR state stay the same */
+    if (tss->type != MPEGTS_PES || is_start)
+        return 0;
+    pes = tss->u.pes_filter.opaque;
+    if (pes->state != MPEGTS_SKIP || !pes->st ||
+        pes->st->discard != AVDISCARD_ALL ||
+        (pes->sub_st && pes->sub_st->discard != AVDISCARD_ALL))
+        return 0;
+    cc = packet[3] & 0xf;
+    if ((packet[1] & 0x80) || (packet[3] & 0x30) != 0x10 ||
+        tss->last_cc < 0 || cc != ((tss->last_cc + 1) & 0xf))
+        return 0;
+    tss->last_cc    = cc;
+    ts->current_pid = pid;
+    *skipped_pes    = 1;
+    return 1;
+}
+
+/**
+ * Skip the packets at the current position which handle_packet() would
+ * ignore, straight from the I/O buffer and without copying them.
+ *
+ * @return number of packets skipped
+ */
+static int skip_dropped_packets(MpegTSContext *ts, int64_t max_packets)
+{
+    AVIOContext *pb = ts->stream->pb;
+    const uint8_t *p = pb->buf_ptr;
+    int64_t n = 0, last_pes = -1;
+
+    while (n < max_packets && pb->buf_end - p >= ts->raw_packet_size && p[0] == 0x47) {
+        int skipped_pes = 0;
+        if (!packet_is_dropped(ts, p, &skipped_pes))
+            break;
+        if (skipped_pes)
+            last_pes = n;
+        p += ts->raw_packet_size;
+        n++;
+    }
+    if (n) {
+        int64_t pos = avio_tell(pb);
+        if (last_pes >= 0 && pos >= 0)
+            ts->pos47_full = pos + last_pes * ts->raw_packet_size;
+        avio_skip(pb, p - pb->buf_ptr);
+    }
+    return n;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
@@ -2845,10 +2988,14 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         }
     }
 
+    check_program_discard(ts);
+
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, AV_INPUT_BUFFER_PADDING_SIZE);
     for (;;) {
+        int64_t skipped;
+
         packet_num++;
         if (nb_packets != 0 && packet_num >= nb_packets ||
             ts->stop_parse > 1) {
@@ -2858,6 +3005,12 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        skipped = skip_dropped_packets(ts, nb_packets ? nb_packets - packet_num : INT64_MAX);
+        if (skipped) {
+            packet_num += skipped - 1;
+            continue;
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
@@ -3136,6 +3289,7 @@ static void mpegts_free(MpegTSContext *ts)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->prg_discard);
 
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
@@ -3246,6 +3400,7 @@ int avpriv_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
 
     len1 = len;
     ts->pkt = pkt;
+    check_program_discard(ts);
     for (;;) {
         ts->stop_parse = 0;
         if (len < TS_PACKET_SIZE)
@@ -23,6 +23,7 @@
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "internal.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -35,6 +36,11 @@ typedef enum {
 
 #define DEFAULT_SLAVE_FAILURE_POLICY ON_SLAVE_FAILURE_ABORT
 
+typedef enum {
+    QUEUE_POLICY_BLOCK = 0,
+    QUEUE_POLICY_DROP  = 1
+} SlaveQueuePolicy;
+
 typedef struct {
     AVFormatContext *avf;
     AVBSFContext **bsfs; ///< bitstream filters per stream
@@ -47,6 +53,19 @@ typedef struct {
      * disabled output streams are set to -1 */
     int *stream_map;
     int header_written;
+
+    SlaveQueuePolicy queue_policy;
+    int use_thread;
+#if HAVE_THREADS
+    AVFormatContext *tee_avf;
+    pthread_t thread;
+#endif
+    /* the fields below are protected by TeeContext.lock */
+    uint64_t read_pos;      ///< position in the packet ring of the next packet to write
+    uint64_t nb_dropped;
+    int *wait_keyframe;     ///< per output stream, set after packets were dropped
+    int stop;               ///< the thread must exit once the ring is drained
+    int error;              ///< error the thread exited with
 } TeeSlave;
 
 typedef struct TeeContext {
@@ -57,6 +76,19 @@ typedef struct TeeContext {
     int use_fifo;
     AVDictionary *fifo_options;
     char *fifo_options_str;
+
+    int use_threads;
+    int queue_size;
+    int queue_policy;
+#if HAVE_THREADS
+    /** packets shared by all the threaded slaves, each one holding a
+     * reference; a NULL packet (flush request) is stored with stream_index -1 */
+    AVPacket *ring;
+    uint64_t write_pos;
+    int lock_initialized;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
 } TeeContext;
 
 static const char *const slave_delim     = "|";
@@ -69,6 +101,14 @@ static const AVOption options[] = {
          OFFSET(use_fifo), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
         {"fifo_options", "fifo pseudo-muxer options", OFFSET(fifo_options_str),
          AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM},
+        {"use_threads", "Write each slave output from its own thread",
+         OFFSET(use_threads), AV_OPT_TYPE_BOOL, {.i64 = HAVE_THREADS}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
+        {"queue_size", "Number of packets queued for the slave threads",
+         OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64 = 256}, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
+        {"queue_policy", "What to do when a slave thread falls behind by queue_size packets",
+         OFFSET(queue_policy), AV_OPT_TYPE_INT, {.i64 = QUEUE_POLICY_BLOCK}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM, "queue_policy"},
+        {"block", "wait for the slave", 0, AV_OPT_TYPE_CONST, {.i64 = QUEUE_POLICY_BLOCK}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "queue_policy"},
+        {"drop",  "drop packets until the next keyframe", 0, AV_OPT_TYPE_CONST, {.i64 = QUEUE_POLICY_DROP}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "queue_policy"},
         {NULL}
 };
 
@@ -96,6 +136,20 @@ static inline int parse_slave_failure_policy_option(const char *opt, TeeSlave *t
     return AVERROR(EINVAL);
 }
 
+static inline int parse_slave_queue_policy_option(const char *opt, TeeSlave *tee_slave)
+{
+    if (!opt) {
+        return 0;
+    } else if (!av_strcasecmp("block", opt)) {
+        tee_slave->queue_policy = QUEUE_POLICY_BLOCK;
+        return 0;
+    } else if (!av_strcasecmp("drop", opt)) {
+        tee_slave->queue_policy = QUEUE_POLICY_DROP;
+        return 0;
+    }
+    return AVERROR(EINVAL);
+}
+
 static int parse_slave_fifo_options(const char *use_fifo,
                                     const char *fifo_options, TeeSlave *tee_slave)
 {
@@ -119,6 +173,34 @@ static int parse_slave_fifo_options(const char *use_fifo,
     return ret;
 }
 
+static void stop_slave_thread(TeeSlave *tee_slave)
+{
+#if HAVE_THREADS
+    TeeContext *tee;
+    int ret;
+
+    if (!tee_slave->use_thread)
+        return;
+    tee = tee_slave->tee_avf->priv_data;
+
+    pthread_mutex_lock(&tee->lock);
+    tee_slave->stop = 1;
+    pthread_cond_broadcast(&tee->cond);
+    pthread_mutex_unlock(&tee->lock);
+
+    ret = pthread_join(tee_slave->thread, NULL);
+    if (ret)
+        av_log(tee_slave->tee_avf, AV_LOG_ERROR, "pthread join error: %s\n",
+               av_err2str(AVERROR(ret)));
+    tee_slave->use_thread = 0;
+
+    if (tee_slave->nb_dropped)
+        av_log(tee_slave->tee_avf, AV_LOG_WARNING,
+               "Slave '%s': %"PRIu64" packets dropped\n",
+               tee_slave->avf->url, tee_slave->nb_dropped);
+#endif
+}
+
 static int close_slave(TeeSlave *tee_slave)
 {
     AVFormatContext *avf;
@@ -129,8 +211,14 @@ static int close_slave(TeeSlave *tee_slave)
     if (!avf)
         return 0;
 
-    if (tee_slave->header_written)
-        ret = av_write_trailer(avf);
+    stop_slave_thread(tee_slave);
+    ret = tee_slave->error;
+
+    if (tee_slave->header_written) {
+        int ret2 = av_write_trailer(avf);
+        if (!ret)
+            ret = ret2;
+    }
 
     if (tee_slave->bsfs) {
         for (i = 0; i < avf->nb_streams; ++i)
@@ -138,6 +226,7 @@ static int close_slave(TeeSlave *tee_slave)
     }
     av_freep(&tee_slave->stream_map);
     av_freep(&tee_slave->bsfs);
+    av_freep(&tee_slave->wait_keyframe);
 
     ff_format_io_close(avf, &avf->pb);
     avformat_free_context(avf);
@@ -163,7 +252,7 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     AVDictionaryEntry *entry;
     char *filename;
     char *format = NULL, *select = NULL, *on_fail = NULL;
-    char *use_fifo = NULL, *fifo_options_str = NULL;
+    char *use_fifo = NULL, *fifo_options_str = NULL, *queue_policy = NULL;
     AVFormatContext *avf2 = NULL;
     AVStream *st, *st2;
     int stream_count;
@@ -186,6 +275,7 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     STEAL_OPTION("onfail", on_fail);
     STEAL_OPTION("use_fifo", use_fifo);
     STEAL_OPTION("fifo_options", fifo_options_str);
+    STEAL_OPTION("queue_policy", queue_policy);
 
     ret = parse_slave_failure_policy_option(on_fail, tee_slave);
     if (ret < 0) {
@@ -194,6 +284,13 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
         goto end;
     }
 
+    ret = parse_slave_queue_policy_option(queue_policy, tee_slave);
+    if (ret < 0) {
+        av_log(avf, AV_LOG_ERROR,
+               "Invalid queue_policy option value, valid options are 'block' and 'drop'\n");
+        goto end;
+    }
+
     ret = parse_slave_fifo_options(use_fifo, fifo_options_str, tee_slave);
     if (ret < 0) {
         av_log(avf, AV_LOG_ERROR, "Error parsing fifo options: %s\n", av_err2str(ret));
@@ -398,6 +495,7 @@ end:
     av_free(format);
     av_free(select);
     av_free(on_fail);
+    av_free(queue_policy);
     av_dict_free(&options);
     av_freep(&tmp_select);
     return ret;
@@ -445,6 +543,189 @@ static int tee_process_slave_failure(AVFormatContext *avf, unsigned slave_idx, i
     }
 }
 
+/**
+ * Filter and write a packet to a slave.
+ *
+ * @param pkt packet to write, whose reference is taken over, or NULL to flush
+ */
+static int write_slave_packet(TeeSlave *tee_slave, AVPacket *pkt, int s2)
+{
+    AVFormatContext *avf2 = tee_slave->avf;
+    AVBSFContext *bsfs;
+    int ret;
+
+    if (!pkt)
+        return av_interleaved_write_frame(avf2, NULL);
+
+    bsfs = tee_slave->bsfs[s2];
+    pkt->stream_index = s2;
+
+    ret = av_bsf_send_packet(bsfs, pkt);
+    if (ret < 0) {
+        av_log(avf2, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
+               av_err2str(ret));
+        av_packet_unref(pkt);
+        return ret;
+    }
+
+    while(1) {
+        ret = av_bsf_receive_packet(bsfs, pkt);
+        if (ret == AVERROR(EAGAIN)) {
+            ret = 0;
+            break;
+        } else if (ret < 0) {
+            break;
+        }
+
+        av_packet_rescale_ts(pkt, bsfs->time_base_out,
+                             avf2->streams[s2]->time_base);
+        ret = av_interleaved_write_frame(avf2, pkt);
+        if (ret < 0)
+            break;
+    };
+
+    return ret;
+}
+
+#if HAVE_THREADS
+static void *slave_thread(void *arg)
+{
+    TeeSlave *tee_slave = arg;
+    TeeContext *tee = tee_slave->tee_avf->priv_data;
+    AVPacket pkt, *slot;
+    int ret = 0, s2;
+
+    pthread_mutex_lock(&tee->lock);
+    while (1) {
+        while (tee_slave->read_pos == tee->write_pos && !tee_slave->stop)
+            pthread_cond_wait(&tee->cond, &tee->lock);
+        if (tee_slave->read_pos == tee->write_pos)
+            break;
+
+        if (tee->write_pos - tee_slave->read_pos > tee->queue_size) {
+            /* the writer went past us, resume at the oldest packet left
+             * and skip to the next keyframe of each stream */
+            tee_slave->nb_dropped += tee->write_pos - tee->queue_size - tee_slave->read_pos;
+            tee_slave->read_pos    = tee->write_pos - tee->queue_size;
+            for (s2 = 0; s2 < tee_slave->avf->nb_streams; s2++)
+                tee_slave->wait_keyframe[s2] = 1;
+        }
+
+        slot = &tee->ring[tee_slave->read_pos++ % tee->queue_size];
+        pthread_cond_broadcast(&tee->cond);
+
+        if (slot->stream_index < 0) {
+            pthread_mutex_unlock(&tee->lock);
+            ret = write_slave_packet(tee_slave, NULL, 0);
+        } else {
+            s2 = tee_slave->stream_map[slot->stream_index];
+            if (s2 < 0)
+                continue;
+            if (tee_slave->wait_keyframe[s2]) {
+                if (!(slot->flags & AV_PKT_FLAG_KEY)) {
+                    tee_slave->nb_dropped++;
+                    continue;
+                }
+                tee_slave->wait_keyframe[s2] = 0;
+            }
+            ret = av_packet_ref(&pkt, slot);
+            pthread_mutex_unlock(&tee->lock);
+            if (ret >= 0)
+                ret = write_slave_packet(tee_slave, &pkt, s2);
+        }
+
+        pthread_mutex_lock(&tee->lock);
+        if (ret < 0) {
+            tee_slave->error = ret;
+            pthread_cond_broadcast(&tee->cond);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&tee->lock);
+
+    return NULL;
+}
+
+static int start_slave_thread(AVFormatContext *avf, TeeSlave *tee_slave)
+{
+    TeeContext *tee = avf->priv_data;
+    int ret;
+
+    tee_slave->wait_keyframe = av_calloc(tee_slave->avf->nb_streams,
+                                         sizeof(*tee_slave->wait_keyframe));
+    if (!tee_slave->wait_keyframe)
+        return AVERROR(ENOMEM);
+
+    tee_slave->tee_avf  = avf;
+    tee_slave->read_pos = tee->write_pos;
+    ret = pthread_create(&tee_slave->thread, NULL, slave_thread, tee_slave);
+    if (ret) {
+        av_log(avf, AV_LOG_ERROR, "Failed to start thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    tee_slave->use_thread = 1;
+    return 0;
+}
+
+/**
+ * Put a packet in the ring shared by the slave threads, waiting for the
+ * blocking slaves to make room and handling the failed ones.
+ */
+static int tee_queue_packet(AVFormatContext *avf, AVPacket *pkt)
+{
+    TeeContext *tee = avf->priv_data;
+    AVPacket *slot;
+    unsigned i;
+    int ret = 0;
+
+    pthread_mutex_lock(&tee->lock);
+    while (1) {
+        TeeSlave *failed = NULL;
+        int full = 0;
+
+        for (i = 0; i < tee->nb_slaves; i++) {
+            TeeSlave *tee_slave = &tee->slaves[i];
+            if (!tee_slave->avf || !tee_slave->use_thread)
+                continue;
+            if (tee_slave->error) {
+                failed = tee_slave;
+                break;
+            }
+            if (tee_slave->queue_policy == QUEUE_POLICY_BLOCK &&
+                tee->write_pos - tee_slave->read_pos >= tee->queue_size)
+                full = 1;
+        }
+
+        if (failed) {
+            pthread_mutex_unlock(&tee->lock);
+            ret = tee_process_slave_failure(avf, failed - tee->slaves, failed->error);
+            if (ret < 0)
+                return ret;
+            pthread_mutex_lock(&tee->lock);
+            continue;
+        }
+        if (!full)
+            break;
+        pthread_cond_wait(&tee->cond, &tee->lock);
+    }
+
+    slot = &tee->ring[tee->write_pos % tee->queue_size];
+    av_packet_unref(slot);
+    if (pkt)
+        ret = av_packet_ref(slot, pkt);
+    else
+        slot->stream_index = -1;
+    if (ret >= 0) {
+        tee->write_pos++;
+        pthread_cond_broadcast(&tee->cond);
+    }
+    pthread_mutex_unlock(&tee->lock);
+
+    return ret;
+}
+#endif
+
 static int tee_write_header(AVFormatContext *avf)
 {
     TeeContext *tee = avf->priv_data;
@@ -474,6 +755,24 @@ static int tee_write_header(AVFormatContext *avf)
             goto fail;
     }
 
+    if (tee->use_threads) {
+#if HAVE_THREADS
+        if (!(tee->ring = av_mallocz_array(tee->queue_size, sizeof(*tee->ring)))) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        if ((ret = AVERROR(pthread_mutex_init(&tee->lock, NULL))))
+            goto fail;
+        if ((ret = AVERROR(pthread_cond_init(&tee->cond, NULL)))) {
+            pthread_mutex_destroy(&tee->lock);
+            goto fail;
+        }
+        tee->lock_initialized = 1;
+#else
+        tee->use_threads = 0;
+#endif
+    }
+
     if (!(tee->slaves = av_mallocz_array(nb_slaves, sizeof(*tee->slaves)))) {
         ret = AVERROR(ENOMEM);
         goto fail;
@@ -483,6 +782,7 @@ static int tee_write_header(AVFormatContext *avf)
     for (i = 0; i < nb_slaves; i++) {
 
         tee->slaves[i].use_fifo = tee->use_fifo;
+        tee->slaves[i].queue_policy = tee->queue_policy;
         ret = av_dict_copy(&tee->slaves[i].fifo_options, tee->fifo_options, 0);
         if (ret < 0)
             goto fail;
@@ -493,6 +793,12 @@ static int tee_write_header(AVFormatContext *avf)
                 goto fail;
         } else {
             log_slave(&tee->slaves[i], avf, AV_LOG_VERBOSE);
+#if HAVE_THREADS
+            /* the fifo muxer already writes from its own thread */
+            if (tee->use_threads && !tee->slaves[i].use_fifo &&
+                (ret = start_slave_thread(avf, &tee->slaves[i])) < 0)
+                goto fail;
+#endif
         }
         av_freep(&slaves[i]);
     }
@@ -537,20 +843,22 @@ static int tee_write_trailer(AVFormatContext *avf)
 static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 {
     TeeContext *tee = avf->priv_data;
-    AVFormatContext *avf2;
-    AVBSFContext *bsfs;
     AVPacket pkt2;
-    int ret_all = 0, ret;
-    unsigned i, s;
+    int ret_all = 0, ret, threaded = 0;
+    unsigned i;
     int s2;
 
     for (i = 0; i < tee->nb_slaves; i++) {
-        if (!(avf2 = tee->slaves[i].avf))
+        if (!tee->slaves[i].avf)
+            continue;
+        if (tee->slaves[i].use_thread) {
+            threaded = 1;
             continue;
+        }
 
         /* Flush slave if pkt is NULL*/
         if (!pkt) {
-            ret = av_interleaved_write_frame(avf2, NULL);
+            ret = write_slave_packet(&tee->slaves[i], NULL, 0);
             if (ret < 0) {
                 ret = tee_process_slave_failure(avf, i, ret);
                 if (!ret_all && ret < 0)
@@ -559,8 +867,7 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
             continue;
         }
 
-        s = pkt->stream_index;
-        s2 = tee->slaves[i].stream_map[s];
+        s2 = tee->slaves[i].stream_map[pkt->stream_index];
         if (s2 < 0)
             continue;
 
@@ -570,41 +877,44 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
                 ret_all = ret;
                 continue;
             }
-        bsfs = tee->slaves[i].bsfs[s2];
-        pkt2.stream_index = s2;
 
-        ret = av_bsf_send_packet(bsfs, &pkt2);
+        ret = write_slave_packet(&tee->slaves[i], &pkt2, s2);
         if (ret < 0) {
-            av_log(avf, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
-                   av_err2str(ret));
             ret = tee_process_slave_failure(avf, i, ret);
             if (!ret_all && ret < 0)
                 ret_all = ret;
         }
+    }
 
-        while(1) {
-            ret = av_bsf_receive_packet(bsfs, &pkt2);
-            if (ret == AVERROR(EAGAIN)) {
-                ret = 0;
-                break;
-            } else if (ret < 0) {
-                break;
-            }
+#if HAVE_THREADS
+    if (threaded) {
+        ret = tee_queue_packet(avf, pkt);
+        if (!ret_all && ret < 0)
+            ret_all = ret;
+    }
+#endif
+    return ret_all;
+}
 
-            av_packet_rescale_ts(&pkt2, bsfs->time_base_out,
-                                 avf2->streams[s2]->time_base);
-            ret = av_interleaved_write_frame(avf2, &pkt2);
-            if (ret < 0)
-                break;
-        };
+static void tee_deinit(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
 
-        if (ret < 0) {
-            ret = tee_process_slave_failure(avf, i, ret);
-            if (!ret_all && ret < 0)
-                ret_all = ret;
-        }
+    if (tee->slaves)
+        close_slaves(avf);
+#if HAVE_THREADS
+    if (tee->ring) {
+        int i;
+        for (i = 0; i < tee->queue_size; i++)
+            av_packet_unref(&tee->ring[i]);
+        av_freep(&tee->ring);
     }
-    return ret_all;
+    if (tee->lock_initialized) {
+        pthread_mutex_destroy(&tee->lock);
+        pthread_cond_destroy(&tee->cond);
+        tee->lock_initialized = 0;
+    }
+#endif
 }
 
 AVOutputFormat ff_tee_muxer = {
@@ -614,6 +924,7 @@ AVOutputFormat ff_tee_muxer = {
     .write_header      = tee_write_header,
     .write_trailer     = tee_write_trailer,
     .write_packet      = tee_write_packet,
+    .deinit            = tee_deinit,
     .priv_class        = &tee_muxer_class,
     .flags             = AVFMT_NOFILE | AVFMT_ALLOW_FLUSH,
 };
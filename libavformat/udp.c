@@ -26,6 +26,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -63,6 +64,15 @@
 
 #if HAVE_PTHREAD_CANCEL
 #include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+#ifdef __linux__
+#include <netinet/udp.h>
+/* UDP generic segmentation offload, Linux 4.18 and later */
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT                                      103
+#endif
 #endif
 
 #ifndef IPV6_ADD_MEMBERSHIP
@@ -73,6 +83,11 @@
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_DEFAULT_BATCH_SIZE 32
+#define UDP_MAX_BATCH_SIZE 1024
+/* limits of a single send with segmentation offload */
+#define UDP_MAX_GSO_SEGMENTS 64
+#define UDP_MAX_GSO_SIZE (65535 - UDP_HEADER_SIZE - 40)
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -102,8 +117,28 @@ typedef struct UDPContext {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     int thread_started;
+
+    /* single producer, single consumer ring of datagrams prefixed with their
+     * size, filled by circular_buffer_task_rx() and read by udp_read()
+     * without locking; the mutex is only taken to wait for data */
+    uint8_t *rx_ring;
+    int rx_ring_size;
+    atomic_int rx_ring_read;
+    atomic_int rx_ring_write;
+#endif
+
+    /* datagrams received by or waiting for a single system call */
+    int batch_size;
+    int gso;
+    uint8_t *batch_buf;
+    int *batch_len;
+    struct sockaddr_storage *batch_addr;
+    int nb_batch;
+    int batch_pos;
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iov;
 #endif
-    uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
     char *localaddr;
     int timeout;
@@ -135,6 +170,8 @@ static const AVOption options[] = {
     { "timeout",        "set raise error timeout (only in read mode)",     OFFSET(timeout),        AV_OPT_TYPE_INT,    { .i64 = 0 },      0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch_size",     "Maximum number of datagrams per system call",     OFFSET(batch_size),     AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, UDP_MAX_BATCH_SIZE, D|E },
+    { "gso",            "Let the kernel split batches of datagrams (Linux only)", OFFSET(gso),     AV_OPT_TYPE_BOOL,   { .i64 = 0 },      0, 1,       E },
     { NULL }
 };
 
@@ -453,63 +490,279 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+static int udp_alloc_batch(UDPContext *s, int nb, int datagram_size)
+{
+    s->batch_size = nb;
+    s->batch_buf  = av_malloc((size_t)nb * datagram_size);
+    s->batch_len  = av_malloc_array(nb, sizeof(*s->batch_len));
+    s->batch_addr = av_malloc_array(nb, sizeof(*s->batch_addr));
+    if (!s->batch_buf || !s->batch_len || !s->batch_addr)
+        return AVERROR(ENOMEM);
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    s->msgs = av_mallocz_array(nb, sizeof(*s->msgs));
+    s->iov  = av_malloc_array(nb, sizeof(*s->iov));
+    if (!s->msgs || !s->iov)
+        return AVERROR(ENOMEM);
+#endif
+    return 0;
+}
+
+static void udp_free_batch(UDPContext *s)
+{
+    av_freep(&s->batch_buf);
+    av_freep(&s->batch_len);
+    av_freep(&s->batch_addr);
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+#endif
+}
+
+static int udp_send(UDPContext *s, const uint8_t *buf, int size)
+{
+    int ret;
+
+    if (!s->is_connected) {
+        ret = sendto (s->udp_fd, buf, size, 0,
+                      (struct sockaddr *) &s->dest_addr,
+                      s->dest_addr_len);
+    } else
+        ret = send(s->udp_fd, buf, size, 0);
+
+    return ret < 0 ? ff_neterrno() : ret;
+}
+
+/**
+ * Send nb datagrams stored back to back in buf with as few system calls as
+ * possible: one per run of full-sized datagrams with segmentation offload,
+ * one per batch_size datagrams with sendmmsg(), one per datagram otherwise.
+ */
+static int udp_send_batch(URLContext *h, const uint8_t *buf, const int *len, int nb)
+{
+    UDPContext *s = h->priv_data;
+
+    while (nb > 0) {
+        int n = 1, size = len[0], ret;
+
+        if (s->gso) {
+            /* only the last datagram sent at once may be shorter */
+            while (n < nb && n < UDP_MAX_GSO_SEGMENTS && len[n - 1] == s->pkt_size &&
+                   size + len[n] <= UDP_MAX_GSO_SIZE)
+                size += len[n++];
+            ret = udp_send(s, buf, size);
+            if (ret < 0 && n > 1 && ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
+                av_log(h, AV_LOG_WARNING, "UDP segmentation offload failed (%s), disabling it\n",
+                       av_err2str(ret));
+                s->gso = 0;
+                continue;
+            }
+#if HAVE_SENDMMSG
+        } else if (nb > 1) {
+            int i;
+
+            n = FFMIN(nb, s->batch_size);
+            for (i = 0, size = 0; i < n; i++) {
+                s->iov[i].iov_base = (uint8_t *)buf + size;
+                s->iov[i].iov_len  = len[i];
+                s->msgs[i].msg_hdr.msg_name    = s->is_connected ? NULL : &s->dest_addr;
+                s->msgs[i].msg_hdr.msg_namelen = s->is_connected ? 0 : s->dest_addr_len;
+                s->msgs[i].msg_hdr.msg_iov     = &s->iov[i];
+                s->msgs[i].msg_hdr.msg_iovlen  = 1;
+                size += len[i];
+            }
+            ret = sendmmsg(s->udp_fd, s->msgs, n, 0);
+            if (ret < 0) {
+                ret = ff_neterrno();
+            } else if (ret < n) {
+                for (n = ret, size = 0, i = 0; i < n; i++)
+                    size += len[i];
+            }
+#endif
+        } else {
+            ret = udp_send(s, buf, size);
+        }
+
+        if (ret < 0) {
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+            if (ret == AVERROR(EAGAIN) && (ret = ff_network_wait_fd(s->udp_fd, 1)) < 0 &&
+                ret != AVERROR(EAGAIN))
+                return ret;
+            continue;
+        }
+        buf += size;
+        len += n;
+        nb  -= n;
+    }
+    return 0;
+}
+
+static int udp_flush_batch(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    int ret = udp_send_batch(h, s->batch_buf, s->batch_len, s->nb_batch);
+
+    s->nb_batch  = 0;
+    s->batch_pos = 0;
+    return ret;
+}
+
 #if HAVE_PTHREAD_CANCEL
+/**
+ * Receive up to batch_size datagrams of at most UDP_MAX_PKT_SIZE bytes into
+ * batch_buf, waiting for the first one only.
+ *
+ * @return number of datagrams received or a negative error code
+ */
+static int udp_recv_batch(UDPContext *s)
+{
+    socklen_t addr_len = sizeof(s->batch_addr[0]);
+    int ret;
+#if HAVE_RECVMMSG
+    int i;
+
+    if (s->batch_size > 1) {
+        for (i = 0; i < s->batch_size; i++) {
+            s->iov[i].iov_base = s->batch_buf + (size_t)i * UDP_MAX_PKT_SIZE;
+            s->iov[i].iov_len  = UDP_MAX_PKT_SIZE;
+            s->msgs[i].msg_hdr.msg_name    = &s->batch_addr[i];
+            s->msgs[i].msg_hdr.msg_namelen = addr_len;
+            s->msgs[i].msg_hdr.msg_iov     = &s->iov[i];
+            s->msgs[i].msg_hdr.msg_iovlen  = 1;
+        }
+        ret = recvmmsg(s->udp_fd, s->msgs, s->batch_size, MSG_WAITFORONE, NULL);
+        if (ret < 0)
+            return ff_neterrno();
+        for (i = 0; i < ret; i++)
+            s->batch_len[i] = s->msgs[i].msg_len;
+        return ret;
+    }
+#endif
+    ret = recvfrom(s->udp_fd, s->batch_buf, UDP_MAX_PKT_SIZE, 0,
+                   (struct sockaddr *)&s->batch_addr[0], &addr_len);
+    if (ret < 0)
+        return ff_neterrno();
+    s->batch_len[0] = ret;
+    return 1;
+}
+
+static void rx_ring_put(UDPContext *s, int pos, const uint8_t *src, int len)
+{
+    int n = FFMIN(len, s->rx_ring_size - pos);
+
+    memcpy(s->rx_ring + pos, src, n);
+    memcpy(s->rx_ring, src + n, len - n);
+}
+
+static void rx_ring_get(UDPContext *s, int pos, uint8_t *dst, int len)
+{
+    int n = FFMIN(len, s->rx_ring_size - pos);
+
+    memcpy(dst, s->rx_ring + pos, n);
+    memcpy(dst + n, s->rx_ring, len - n);
+}
+
+/* called by the receiving thread only */
+static int rx_ring_write(UDPContext *s, const uint8_t *buf, int len)
+{
+    int wpos  = atomic_load_explicit(&s->rx_ring_write, memory_order_relaxed);
+    int rpos  = atomic_load_explicit(&s->rx_ring_read,  memory_order_acquire);
+    int space = (rpos - wpos - 1 + s->rx_ring_size) % s->rx_ring_size;
+    uint8_t size[4];
+
+    if (space < len + 4)
+        return AVERROR(ENOSPC);
+
+    AV_WL32(size, len);
+    rx_ring_put(s, wpos, size, 4);
+    rx_ring_put(s, (wpos + 4) % s->rx_ring_size, buf, len);
+    atomic_store_explicit(&s->rx_ring_write, (wpos + 4 + len) % s->rx_ring_size,
+                          memory_order_release);
+    return 0;
+}
+
+/* called by udp_read() only, returns AVERROR(EAGAIN) if the ring is empty */
+static int rx_ring_read(URLContext *h, uint8_t *buf, int size)
+{
+    UDPContext *s = h->priv_data;
+    int rpos = atomic_load_explicit(&s->rx_ring_read,  memory_order_relaxed);
+    int wpos = atomic_load_explicit(&s->rx_ring_write, memory_order_acquire);
+    uint8_t tmp[4];
+    int len, avail;
+
+    if (rpos == wpos)
+        return AVERROR(EAGAIN);
+
+    rx_ring_get(s, rpos, tmp, 4);
+    avail = len = AV_RL32(tmp);
+    if (avail > size) {
+        av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
+        avail = size;
+    }
+    rx_ring_get(s, (rpos + 4) % s->rx_ring_size, buf, avail);
+    atomic_store_explicit(&s->rx_ring_read, (rpos + 4 + len) % s->rx_ring_size,
+                          memory_order_release);
+    return avail;
+}
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
     UDPContext *s = h->priv_data;
     int old_cancelstate;
+    int err = 0;
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-    pthread_mutex_lock(&s->mutex);
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
+        err = AVERROR(EIO);
         goto end;
     }
     while(1) {
-        int len;
-        struct sockaddr_storage addr;
-        socklen_t addr_len = sizeof(addr);
+        int i, n;
 
-        pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
+        n = udp_recv_batch(s);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-        pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
-            if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
+        if (n < 0) {
+            if (n != AVERROR(EAGAIN) && n != AVERROR(EINTR)) {
+                err = n;
                 goto end;
             }
             continue;
         }
-        if (ff_ip_check_source_lists(&addr, &s->filters))
-            continue;
-        AV_WL32(s->tmp, len);
 
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+        for (i = 0; i < n; i++) {
+            if (ff_ip_check_source_lists(&s->batch_addr[i], &s->filters))
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+            if (rx_ring_write(s, s->batch_buf + (size_t)i * UDP_MAX_PKT_SIZE,
+                              s->batch_len[i]) < 0) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    err = AVERROR(EIO);
+                    goto end;
+                }
             }
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
+
+        pthread_mutex_lock(&s->mutex);
         pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
     }
 
 end:
+    pthread_mutex_lock(&s->mutex);
+    s->circular_buffer_error = err;
     pthread_cond_signal(&s->cond);
     pthread_mutex_unlock(&s->mutex);
     return NULL;
@@ -536,8 +789,7 @@ static void *circular_buffer_task_tx( void *_URLContext)
     }
 
     for(;;) {
-        int len;
-        const uint8_t *p;
+        int len, nb, ret;
         uint8_t tmp[4];
         int64_t timestamp;
 
@@ -552,13 +804,18 @@ static void *circular_buffer_task_tx( void *_URLContext)
             len=av_fifo_size(s->fifo);
         }
 
-        av_fifo_generic_read(s->fifo, tmp, 4, NULL);
-        len=AV_RL32(tmp);
+        /* take as many queued datagrams as a burst may contain */
+        nb = len = 0;
+        do {
+            av_fifo_generic_read(s->fifo, tmp, 4, NULL);
+            s->batch_len[nb] = AV_RL32(tmp);
 
-        av_assert0(len >= 0);
-        av_assert0(len <= sizeof(s->tmp));
+            av_assert0(s->batch_len[nb] >= 0);
+            av_assert0(s->batch_len[nb] <= UDP_MAX_PKT_SIZE);
 
-        av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
+            av_fifo_generic_read(s->fifo, s->batch_buf + len, s->batch_len[nb], NULL);
+            len += s->batch_len[nb++];
+        } while (nb < s->batch_size && av_fifo_size(s->fifo) >= 4);
 
         pthread_mutex_unlock(&s->mutex);
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
@@ -583,28 +840,12 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
-        p = s->tmp;
-        while (len) {
-            int ret;
-            av_assert0(len > 0);
-            if (!s->is_connected) {
-                ret = sendto (s->udp_fd, p, len, 0,
-                            (struct sockaddr *) &s->dest_addr,
-                            s->dest_addr_len);
-            } else
-                ret = send(s->udp_fd, p, len, 0);
-            if (ret >= 0) {
-                len -= ret;
-                p   += ret;
-            } else {
-                ret = ff_neterrno();
-                if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
-                    pthread_mutex_lock(&s->mutex);
-                    s->circular_buffer_error = ret;
-                    pthread_mutex_unlock(&s->mutex);
-                    return NULL;
-                }
-            }
+        ret = udp_send_batch(h, s->batch_buf, s->batch_len, nb);
+        if (ret < 0) {
+            pthread_mutex_lock(&s->mutex);
+            s->circular_buffer_error = ret;
+            pthread_mutex_unlock(&s->mutex);
+            return NULL;
         }
 
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
@@ -724,6 +965,10 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             s->timeout = strtol(buf, NULL, 10);
         if (is_output && av_find_info_tag(buf, sizeof(buf), "broadcast", p))
             s->is_broadcast = strtol(buf, NULL, 10);
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p))
+            s->batch_size = av_clip(strtol(buf, NULL, 10), -1, UDP_MAX_BATCH_SIZE);
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "gso", p))
+            s->gso = strtol(buf, NULL, 10);
     }
     /* handling needed to support options picking from both AVOption and URL */
     s->circular_buffer_size *= 188;
@@ -849,6 +1094,19 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             ff_log_net_error(h, AV_LOG_ERROR, "setsockopt(SO_SNDBUF)");
             goto fail;
         }
+        if (s->gso) {
+            /* sends larger than pkt_size are split in pkt_size datagrams */
+#ifdef __linux__
+            if (s->pkt_size <= 0 ||
+                setsockopt(udp_fd, IPPROTO_UDP, UDP_SEGMENT, &s->pkt_size, sizeof(s->pkt_size)) < 0) {
+                ff_log_net_error(h, AV_LOG_WARNING, "setsockopt(UDP_SEGMENT)");
+                s->gso = 0;
+            }
+#else
+            av_log(h, AV_LOG_WARNING, "UDP segmentation offload is not supported on this platform\n");
+            s->gso = 0;
+#endif
+        }
     } else {
         /* set udp recv buffer size to the requested value (default 64K) */
         tmp = s->buffer_size;
@@ -891,8 +1149,26 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
         int ret;
 
+        if (is_output) {
+            /* send at once what a burst may contain */
+            int nb = FFMIN(s->burst_bits / (8 * FFMAX(h->max_packet_size, 1)), UDP_MAX_BATCH_SIZE);
+            ret = udp_alloc_batch(s, av_clip(nb, 1, s->batch_size < 0 ? UDP_DEFAULT_BATCH_SIZE : FFMAX(s->batch_size, 1)),
+                                  UDP_MAX_PKT_SIZE);
+            if (ret >= 0 && !(s->fifo = av_fifo_alloc(s->circular_buffer_size)))
+                ret = AVERROR(ENOMEM);
+        } else {
+            ret = udp_alloc_batch(s, HAVE_RECVMMSG ? (s->batch_size < 0 ? UDP_DEFAULT_BATCH_SIZE : FFMAX(s->batch_size, 1)) : 1,
+                                  UDP_MAX_PKT_SIZE);
+            s->rx_ring_size = s->circular_buffer_size + 1;
+            if (ret >= 0 && !(s->rx_ring = av_malloc(s->rx_ring_size)))
+                ret = AVERROR(ENOMEM);
+            atomic_init(&s->rx_ring_read,  0);
+            atomic_init(&s->rx_ring_write, 0);
+        }
+        if (ret < 0)
+            goto fail;
+
         /* start the task going */
-        s->fifo = av_fifo_alloc(s->circular_buffer_size);
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -912,6 +1188,14 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     }
 #endif
 
+    /* gather the datagrams written directly if asked to */
+    if (is_output && !s->fifo && s->pkt_size > 0 &&
+        (s->batch_size > 1 || (s->gso && s->batch_size < 0))) {
+        if (udp_alloc_batch(s, s->batch_size < 0 ? UDP_DEFAULT_BATCH_SIZE : s->batch_size,
+                            s->pkt_size) < 0)
+            goto fail;
+    }
+
     return 0;
 #if HAVE_PTHREAD_CANCEL
  thread_fail:
@@ -923,6 +1207,10 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL
+    av_freep(&s->rx_ring);
+#endif
+    udp_free_batch(s);
     ff_ip_reset_filters(&s->filters);
     return AVERROR(EIO);
 }
@@ -946,22 +1234,13 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
 #if HAVE_PTHREAD_CANCEL
     int avail, nonblock = h->flags & AVIO_FLAG_NONBLOCK;
 
-    if (s->fifo) {
+    if (s->rx_ring) {
+        /* the ring is only read here, and written without the lock */
+        if ((avail = rx_ring_read(h, buf, size)) >= 0)
+            return avail;
         pthread_mutex_lock(&s->mutex);
         do {
-            avail = av_fifo_size(s->fifo);
-            if (avail) { // >=size) {
-                uint8_t tmp[4];
-
-                av_fifo_generic_read(s->fifo, tmp, 4, NULL);
-                avail= AV_RL32(tmp);
-                if(avail > size){
-                    av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
-                    avail= size;
-                }
-
-                av_fifo_generic_read(s->fifo, buf, avail, NULL);
-                av_fifo_drain(s->fifo, AV_RL32(tmp) - avail);
+            if ((avail = rx_ring_read(h, buf, size)) >= 0) {
                 pthread_mutex_unlock(&s->mutex);
                 return avail;
             } else if(s->circular_buffer_error){
@@ -1035,26 +1314,37 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
         return size;
     }
 #endif
+    if (s->batch_buf) {
+        if (size <= s->pkt_size) {
+            memcpy(s->batch_buf + s->batch_pos, buf, size);
+            s->batch_len[s->nb_batch++] = size;
+            s->batch_pos += size;
+            if (s->nb_batch < s->batch_size)
+                return size;
+            ret = udp_flush_batch(h);
+            return ret < 0 ? ret : size;
+        }
+        /* keep the datagrams in order */
+        if ((ret = udp_flush_batch(h)) < 0)
+            return ret;
+    }
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
             return ret;
     }
 
-    if (!s->is_connected) {
-        ret = sendto (s->udp_fd, buf, size, 0,
-                      (struct sockaddr *) &s->dest_addr,
-                      s->dest_addr_len);
-    } else
-        ret = send(s->udp_fd, buf, size, 0);
-
-    return ret < 0 ? ff_neterrno() : ret;
+    return udp_send(s, buf, size);
 }
 
 static int udp_close(URLContext *h)
 {
     UDPContext *s = h->priv_data;
 
+    if (s->nb_batch && udp_flush_batch(h) < 0)
+        av_log(h, AV_LOG_ERROR, "Failed to send the last datagrams\n");
+
 #if HAVE_PTHREAD_CANCEL
     // Request close once writing is finished
     if (s->thread_started && !(h->flags & AVIO_FLAG_READ)) {
@@ -1082,6 +1372,10 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL
+    av_freep(&s->rx_ring);
+#endif
+    udp_free_batch(s);
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
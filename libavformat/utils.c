@@ -50,6 +50,9 @@
 #if CONFIG_NETWORK
 #include "network.h"
 #endif
+#if CONFIG_HTTP_PROTOCOL
+#include "http.h"
+#endif
 #include "riff.h"
 #include "url.h"
 
@@ -5014,6 +5017,9 @@ int avformat_network_init(void)
 
 int avformat_network_deinit(void)
 {
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_pool_close();
+#endif
 #if CONFIG_NETWORK
     ff_network_close();
     ff_tls_deinit();
@@ -5519,6 +5525,13 @@ uint8_t *av_stream_new_side_data(AVStream *st, enum AVPacketSideDataType type,
     return data;
 }
 
+int ff_demux_skip_nonkey(const AVFormatContext *s, const AVStream *st)
+{
+    return st->discard >= AVDISCARD_NONKEY ||
+           (s->flags & AVFMT_FLAG_SKIP_NONKEY &&
+            st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO);
+}
+
 int ff_stream_add_bitstream_filter(AVStream *st, const char *name, const char *args)
 {
     int ret;
@@ -179,6 +179,13 @@ enum AVFrameSideDataType {
      * array element is implied by AVFrameSideData.size / AVRegionOfInterest.self_size.
      */
     AV_FRAME_DATA_REGIONS_OF_INTEREST,
+
+    /**
+     * The frame starts a new scene, as detected by e.g. the select filter.
+     * The data is a single double holding the scene change score in the
+     * range [0, 1]. Encoders may use it to place a keyframe.
+     */
+    AV_FRAME_DATA_SCENE_CHANGE,
 };
 
 enum AVActiveFormatDescription {
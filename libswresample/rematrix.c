@@ -495,7 +495,7 @@ av_cold void swri_rematrix_free(SwrContext *s){
 }
 
 int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
-    int out_i, in_i, i, j;
+    int out_i, in_i, j;
     int len1 = 0;
     int off = 0;
 
@@ -541,35 +541,33 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
             if(len != len1)
                 s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
             break;}
-        default:
+        default: {
+            const int nb_in = s->matrix_ch[out_i][0];
+            const uint8_t *src[SWR_CH_MAX];
+
+            for(j=0; j<nb_in; j++)
+                src[j] = in->ch[s->matrix_ch[out_i][1+j]];
+
             if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
-                for(i=0; i<len; i++){
-                    float v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((float*)in->ch[in_i])[i] * s->matrix_flt[out_i][in_i];
-                    }
-                    ((float*)out->ch[out_i])[i]= v;
-                }
+                float coeffs[SWR_CH_MAX];
+                for(j=0; j<nb_in; j++)
+                    coeffs[j] = s->matrix_flt[out_i][s->matrix_ch[out_i][1+j]];
+                mix_n_float((float*)out->ch[out_i], (const float**)src, coeffs, nb_in, len);
             }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
-                for(i=0; i<len; i++){
-                    double v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((double*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
-                    }
-                    ((double*)out->ch[out_i])[i]= v;
-                }
+                double coeffs[SWR_CH_MAX];
+                for(j=0; j<nb_in; j++)
+                    coeffs[j] = s->matrix[out_i][s->matrix_ch[out_i][1+j]];
+                mix_n_double((double*)out->ch[out_i], (const double**)src, coeffs, nb_in, len);
             }else{
-                for(i=0; i<len; i++){
-                    int v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((int16_t*)in->ch[in_i])[i] * s->matrix32[out_i][in_i];
-                    }
-                    ((int16_t*)out->ch[out_i])[i]= (v + 16384)>>15;
-                }
+                int coeffs[SWR_CH_MAX];
+                for(j=0; j<nb_in; j++)
+                    coeffs[j] = s->matrix32[out_i][s->matrix_ch[out_i][1+j]];
+                if(s->int_sample_fmt == AV_SAMPLE_FMT_S32P)
+                    mix_n_s32((int32_t*)out->ch[out_i], (const int32_t**)src, coeffs, nb_in, len);
+                else
+                    mix_n_s16((int16_t*)out->ch[out_i], (const int16_t**)src, coeffs, nb_in, len);
             }
+            break;}
         }
     }
     return 0;
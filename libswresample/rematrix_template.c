@@ -87,6 +87,37 @@ static void RENAME(mix8to2)(SAMPLE **out, const SAMPLE **in, COEFF *coeffp, inte
     }
 }
 
+#ifndef TEMPLATE_CLIP
+/* Mix nb_in channels into out. The sum is accumulated in blocks, two input
+ * channels at a time, which keeps the per sample order of the additions
+ * while removing the serial dependency between consecutive samples. */
+static void RENAME(mix_n)(SAMPLE *out, const SAMPLE **in, const COEFF *coeffp, int nb_in, integer len){
+    INTER acc[256];
+    int i, j, k;
+
+    for(i=0; i<len; i+=FF_ARRAY_ELEMS(acc)) {
+        const int n = FFMIN(len - i, (int)FF_ARRAY_ELEMS(acc));
+
+        for(k=0; k<n; k++)
+            acc[k] = 0;
+        for(j=0; j+1<nb_in; j+=2) {
+            const SAMPLE *src0 = in[j] + i, *src1 = in[j+1] + i;
+            const INTER coeff0 = coeffp[j], coeff1 = coeffp[j+1];
+            for(k=0; k<n; k++)
+                acc[k] = acc[k] + src0[k] * coeff0 + src1[k] * coeff1;
+        }
+        if(j < nb_in) {
+            const SAMPLE *src = in[j] + i;
+            const INTER coeff = coeffp[j];
+            for(k=0; k<n; k++)
+                acc[k] += src[k] * coeff;
+        }
+        for(k=0; k<n; k++)
+            out[i+k] = R(acc[k]);
+    }
+}
+#endif
+
 static RENAME(mix_any_func_type) *RENAME(get_mix_any_func)(SwrContext *s){
     if(   s->out_ch_layout == AV_CH_LAYOUT_STEREO && (s->in_ch_layout == AV_CH_LAYOUT_5POINT1 || s->in_ch_layout == AV_CH_LAYOUT_5POINT1_BACK)
        && s->matrix[0][2] == s->matrix[1][2] && s->matrix[0][3] == s->matrix[1][3]
@@ -0,0 +1,78 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavfilter/af_volume.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "checkasm.h"
+
+#define LEN 256
+
+static void check_scale_samples(enum AVSampleFormat fmt, const char *name,
+                                int volume_i, const char *range)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,  [LEN * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [LEN * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [LEN * 4]);
+    VolumeContext vol = { 0 };
+    int i;
+
+    declare_func(void, uint8_t *dst, const uint8_t *src, int nb_samples, int volume);
+
+    vol.sample_fmt = fmt;
+    vol.volume_i   = volume_i;
+    ff_volume_init(&vol);
+
+    if (check_func(vol.scale_samples, "scale_samples_%s_%s", name, range)) {
+        const int len = LEN * 4 / av_get_bytes_per_sample(fmt);
+
+        for (i = 0; i < LEN * 4; i++)
+            src[i] = rnd();
+        memset(dst0, 0, LEN * 4);
+        memset(dst1, 0, LEN * 4);
+
+        call_ref(dst0, src, len, volume_i);
+        call_new(dst1, src, len, volume_i);
+        if (memcmp(dst0, dst1, LEN * 4))
+            fail();
+        bench_new(dst1, src, len, volume_i);
+    }
+}
+
+void checkasm_check_volume(void)
+{
+    static const struct {
+        enum AVSampleFormat fmt;
+        const char *name;
+    } formats[] = {
+        { AV_SAMPLE_FMT_U8,  "u8"  },
+        { AV_SAMPLE_FMT_S16, "s16" },
+        { AV_SAMPLE_FMT_S32, "s32" },
+    };
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        /* -6dB, +9.5dB and +54dB, the last one needs 64-bit products for s16 */
+        check_scale_samples(formats[i].fmt, formats[i].name, 128,      "low");
+        check_scale_samples(formats[i].fmt, formats[i].name, 768,      "mid");
+        check_scale_samples(formats[i].fmt, formats[i].name, 0x1FFFF, "high");
+        report("scale_samples_%s", formats[i].name);
+    }
+}
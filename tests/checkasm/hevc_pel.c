@@ -0,0 +1,205 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+
+#include "libavcodec/avcodec.h"
+
+#include "libavcodec/hevcdsp.h"
+
+#include "checkasm.h"
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x03ff03ff, 0x0fff0fff };
+static const int sizes[10] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define SRC_EXTRA    8
+#define SRC_STRIDE   ((MAX_PB_SIZE + 2 * SRC_EXTRA) * 2)
+#define SRC_BUF_SIZE (SRC_STRIDE * (MAX_PB_SIZE + 2 * SRC_EXTRA))
+#define SRC_OFFSET   (SRC_EXTRA * SRC_STRIDE + SRC_EXTRA * 2)
+#define DST_BUF_SIZE (MAX_PB_SIZE * MAX_PB_SIZE * 2)
+
+#define randomize_buffers(buf0, buf1, size, mask)           \
+    do {                                                    \
+        int k;                                              \
+        for (k = 0; k < size; k += 4) {                     \
+            uint32_t r = rnd() & mask;                      \
+            AV_WN32A(buf0 + k, r);                          \
+            AV_WN32A(buf1 + k, r);                          \
+        }                                                   \
+    } while (0)
+
+/* intermediate 14-bit samples as produced by put_hevc_*pel */
+#define randomize_src2(buf, size)                           \
+    do {                                                    \
+        int k;                                              \
+        for (k = 0; k < size; k++)                          \
+            buf[k] = (rnd() & 0x3fff) - 0x1000;             \
+    } while (0)
+
+static void check_put_hevc_pel(HEVCDSPContext *h, int bit_depth, int qpel)
+{
+    LOCAL_ALIGNED_32(uint8_t,  src0, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t,  src1, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t,  dst0, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t,  dst1, [DST_BUF_SIZE / 2]);
+    const char *type = qpel ? "qpel" : "epel";
+    int max_frac = qpel ? 3 : 7;
+    int i, j, k;
+    declare_func(void, int16_t *dst, uint8_t *src, ptrdiff_t srcstride,
+                 int height, intptr_t mx, intptr_t my, int width);
+
+    for (i = 0; i < 10; i++) {
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 2; k++) {
+                int size = sizes[i];
+                intptr_t mx = k ? 1 + rnd() % max_frac : 0;
+                intptr_t my = j ? 1 + rnd() % max_frac : 0;
+                void (*func)(int16_t *, uint8_t *, ptrdiff_t, int, intptr_t, intptr_t, int) =
+                    qpel ? h->put_hevc_qpel[i][j][k] : h->put_hevc_epel[i][j][k];
+
+                randomize_buffers(src0, src1, SRC_BUF_SIZE, pixel_mask[(bit_depth - 8) >> 1]);
+                memset(dst0, 0, DST_BUF_SIZE);
+                memset(dst1, 0, DST_BUF_SIZE);
+
+                if (check_func(func, "put_hevc_%s%s%s%d_%d", type,
+                               k ? "_h" : "", j ? "_v" : "", size, bit_depth)) {
+                    call_ref(dst0, src0 + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+                    call_new(dst1, src1 + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+                    if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                        fail();
+                    bench_new(dst1, src1 + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+                }
+            }
+        }
+    }
+}
+
+static void check_put_hevc_pel_uni(HEVCDSPContext *h, int bit_depth, int qpel)
+{
+    LOCAL_ALIGNED_32(uint8_t, src0, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    const char *type = qpel ? "qpel" : "epel";
+    int max_frac = qpel ? 3 : 7;
+    int i, j, k;
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int height, intptr_t mx, intptr_t my, int width);
+
+    for (i = 0; i < 10; i++) {
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 2; k++) {
+                int size = sizes[i];
+                ptrdiff_t dststride = MAX_PB_SIZE * SIZEOF_PIXEL;
+                intptr_t mx = k ? 1 + rnd() % max_frac : 0;
+                intptr_t my = j ? 1 + rnd() % max_frac : 0;
+                void (*func)(uint8_t *, ptrdiff_t, uint8_t *, ptrdiff_t, int, intptr_t, intptr_t, int) =
+                    qpel ? h->put_hevc_qpel_uni[i][j][k] : h->put_hevc_epel_uni[i][j][k];
+
+                randomize_buffers(src0, src1, SRC_BUF_SIZE, pixel_mask[(bit_depth - 8) >> 1]);
+                memset(dst0, 0, DST_BUF_SIZE);
+                memset(dst1, 0, DST_BUF_SIZE);
+
+                if (check_func(func, "put_hevc_%s_uni%s%s%d_%d", type,
+                               k ? "_h" : "", j ? "_v" : "", size, bit_depth)) {
+                    call_ref(dst0, dststride, src0 + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+                    call_new(dst1, dststride, src1 + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+                    if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                        fail();
+                    bench_new(dst1, dststride, src1 + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+                }
+            }
+        }
+    }
+}
+
+static void check_put_hevc_pel_bi(HEVCDSPContext *h, int bit_depth, int qpel)
+{
+    LOCAL_ALIGNED_32(uint8_t, src0, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, src2, [MAX_PB_SIZE * MAX_PB_SIZE]);
+    const char *type = qpel ? "qpel" : "epel";
+    int max_frac = qpel ? 3 : 7;
+    int i, j, k;
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int16_t *src2, int height, intptr_t mx, intptr_t my, int width);
+
+    for (i = 0; i < 10; i++) {
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 2; k++) {
+                int size = sizes[i];
+                ptrdiff_t dststride = MAX_PB_SIZE * SIZEOF_PIXEL;
+                intptr_t mx = k ? 1 + rnd() % max_frac : 0;
+                intptr_t my = j ? 1 + rnd() % max_frac : 0;
+                void (*func)(uint8_t *, ptrdiff_t, uint8_t *, ptrdiff_t, int16_t *,
+                             int, intptr_t, intptr_t, int) =
+                    qpel ? h->put_hevc_qpel_bi[i][j][k] : h->put_hevc_epel_bi[i][j][k];
+
+                randomize_buffers(src0, src1, SRC_BUF_SIZE, pixel_mask[(bit_depth - 8) >> 1]);
+                randomize_src2(src2, MAX_PB_SIZE * MAX_PB_SIZE);
+                memset(dst0, 0, DST_BUF_SIZE);
+                memset(dst1, 0, DST_BUF_SIZE);
+
+                if (check_func(func, "put_hevc_%s_bi%s%s%d_%d", type,
+                               k ? "_h" : "", j ? "_v" : "", size, bit_depth)) {
+                    call_ref(dst0, dststride, src0 + SRC_OFFSET, SRC_STRIDE, src2, size, mx, my, size);
+                    call_new(dst1, dststride, src1 + SRC_OFFSET, SRC_STRIDE, src2, size, mx, my, size);
+                    if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                        fail();
+                    bench_new(dst1, dststride, src1 + SRC_OFFSET, SRC_STRIDE, src2, size, mx, my, size);
+                }
+            }
+        }
+    }
+}
+
+void checkasm_check_hevc_pel(void)
+{
+    int bit_depth, qpel;
+
+    for (qpel = 0; qpel <= 1; qpel++) {
+        for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+            HEVCDSPContext h;
+
+            ff_hevc_dsp_init(&h, bit_depth);
+            check_put_hevc_pel(&h, bit_depth, qpel);
+        }
+        report(qpel ? "qpel" : "epel");
+
+        for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+            HEVCDSPContext h;
+
+            ff_hevc_dsp_init(&h, bit_depth);
+            check_put_hevc_pel_uni(&h, bit_depth, qpel);
+        }
+        report(qpel ? "qpel_uni" : "epel_uni");
+
+        for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+            HEVCDSPContext h;
+
+            ff_hevc_dsp_init(&h, bit_depth);
+            check_put_hevc_pel_bi(&h, bit_depth, qpel);
+        }
+        report(qpel ? "qpel_bi" : "epel_bi");
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+
+#include "libswresample/swresample.h"
+#include "libswresample/swresample_internal.h"
+
+#include "checkasm.h"
+
+/* the SIMD kernels handle multiples of 16 samples, swri_rematrix() the rest */
+#define LEN 1024
+
+static void randomize_buffer(uint8_t *buf, enum AVSampleFormat fmt, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        if (fmt == AV_SAMPLE_FMT_S16P)
+            ((int16_t *)buf)[i] = rnd();
+        else
+            ((float *)buf)[i] = (int32_t)rnd() / (float)INT32_MAX;
+    }
+}
+
+static int compare_buffers(const uint8_t *a, const uint8_t *b, enum AVSampleFormat fmt, int len)
+{
+    if (fmt == AV_SAMPLE_FMT_S16P)
+        return memcmp(a, b, len * sizeof(int16_t));
+    return !float_near_abs_eps_array((const float *)a, (const float *)b, 1e-6, len);
+}
+
+static void check_mix(SwrContext *s, enum AVSampleFormat fmt, const char *name)
+{
+    LOCAL_ALIGNED_32(uint8_t, src0, [LEN * sizeof(float)]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [LEN * sizeof(float)]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [LEN * sizeof(float)]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [LEN * sizeof(float)]);
+
+    randomize_buffer(src0, fmt, LEN);
+    randomize_buffer(src1, fmt, LEN);
+
+    if (check_func(s->mix_1_1_simd, "mix_1_1_%s", name)) {
+        declare_func_emms(AV_CPU_FLAG_MMX, void, void *out, const void *in, void *coeffp,
+                          integer index, integer len);
+
+        memset(dst0, 0, LEN * sizeof(float));
+        memset(dst1, 0, LEN * sizeof(float));
+        /* the C version uses the plain coefficient layout */
+        s->mix_1_1_f(dst0, src0, s->native_matrix, 1, LEN);
+        call_new(dst1, src0, s->native_simd_matrix, 1, LEN);
+        if (compare_buffers(dst0, dst1, fmt, LEN))
+            fail();
+        bench_new(dst1, src0, s->native_simd_matrix, 1, LEN);
+    }
+
+    if (check_func(s->mix_2_1_simd, "mix_2_1_%s", name)) {
+        declare_func_emms(AV_CPU_FLAG_MMX, void, void *out, const void *in1, const void *in2,
+                          void *coeffp, integer index1, integer index2, integer len);
+
+        memset(dst0, 0, LEN * sizeof(float));
+        memset(dst1, 0, LEN * sizeof(float));
+        s->mix_2_1_f(dst0, src0, src1, s->native_matrix, 2, 3, LEN);
+        call_new(dst1, src0, src1, s->native_simd_matrix, 2, 3, LEN);
+        if (compare_buffers(dst0, dst1, fmt, LEN))
+            fail();
+        bench_new(dst1, src0, src1, s->native_simd_matrix, 2, 3, LEN);
+    }
+}
+
+void checkasm_check_sw_rematrix(void)
+{
+    static const struct {
+        enum AVSampleFormat fmt;
+        const char *name;
+    } formats[] = {
+        { AV_SAMPLE_FMT_S16P, "int16" },
+        { AV_SAMPLE_FMT_FLTP, "float" },
+    };
+    int i, j;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        SwrContext *s = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_STEREO, formats[i].fmt, 48000,
+                                           AV_CH_LAYOUT_STEREO, formats[i].fmt, 48000, 0, NULL);
+        double matrix[4];
+
+        if (!s)
+            continue;
+        /* a custom matrix forces rematrixing; gains below 1 keep the int16
+         * coefficients unshifted so both versions round identically */
+        for (j = 0; j < FF_ARRAY_ELEMS(matrix); j++)
+            matrix[j] = (int32_t)rnd() / (double)INT32_MAX;
+        if (swr_set_matrix(s, matrix, 2) >= 0 && swr_init(s) >= 0)
+            check_mix(s, formats[i].fmt, formats[i].name);
+        swr_free(&s);
+        report("mix_%s", formats[i].name);
+    }
+}
@@ -0,0 +1,133 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+#define SRC_LEN 2048
+#define DST_LEN 1024
+
+static const struct {
+    enum AVSampleFormat fmt;
+    const char *name;
+} formats[] = {
+    { AV_SAMPLE_FMT_S16P, "int16"  },
+    { AV_SAMPLE_FMT_S32P, "int32"  },
+    { AV_SAMPLE_FMT_FLTP, "float"  },
+    { AV_SAMPLE_FMT_DBLP, "double" },
+};
+
+static void randomize_buffer(uint8_t *buf, enum AVSampleFormat fmt, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16P: ((int16_t *)buf)[i] = rnd();                     break;
+        case AV_SAMPLE_FMT_S32P: ((int32_t *)buf)[i] = (int32_t)rnd() >> 8;       break;
+        case AV_SAMPLE_FMT_FLTP: ((float   *)buf)[i] = (int32_t)rnd() / (float)INT32_MAX;  break;
+        case AV_SAMPLE_FMT_DBLP: ((double  *)buf)[i] = (int32_t)rnd() / (double)INT32_MAX; break;
+        }
+    }
+}
+
+/* the integer kernels may differ by one unit in the rounding */
+static int compare_buffers(const uint8_t *a, const uint8_t *b, enum AVSampleFormat fmt, int len)
+{
+    int i;
+
+    switch (fmt) {
+    case AV_SAMPLE_FMT_S16P:
+        for (i = 0; i < len; i++)
+            if (FFABS(((const int16_t *)a)[i] - ((const int16_t *)b)[i]) > 1)
+                return 1;
+        return 0;
+    case AV_SAMPLE_FMT_S32P:
+        for (i = 0; i < len; i++)
+            if (FFABS((int64_t)((const int32_t *)a)[i] - ((const int32_t *)b)[i]) > 1)
+                return 1;
+        return 0;
+    case AV_SAMPLE_FMT_FLTP:
+        return !float_near_abs_eps_array((const float *)a, (const float *)b, 1e-6, len);
+    default:
+        return !double_near_abs_eps_array((const double *)a, (const double *)b, 1e-12, len);
+    }
+}
+
+static void check_resample(ResampleContext *c, const char *name, int linear)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,  [SRC_LEN * sizeof(double)]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_LEN * sizeof(double)]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_LEN * sizeof(double)]);
+    const int index = c->index, frac = c->frac;
+    int ret0, ret1, index0, frac0;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, int, ResampleContext *c, void *dst,
+                      const void *src, int n, int update_ctx);
+
+    if (check_func(linear ? c->dsp.resample_linear : c->dsp.resample_common,
+                   "resample_%s_%s", linear ? "linear" : "common", name)) {
+        randomize_buffer(src, c->format, SRC_LEN);
+        memset(dst0, 0, DST_LEN * sizeof(double));
+        memset(dst1, 0, DST_LEN * sizeof(double));
+
+        ret0   = call_ref(c, dst0, src, DST_LEN, 1);
+        index0 = c->index;
+        frac0  = c->frac;
+        c->index = index;
+        c->frac  = frac;
+        ret1   = call_new(c, dst1, src, DST_LEN, 1);
+
+        if (ret0 != ret1 || index0 != c->index || frac0 != c->frac ||
+            compare_buffers(dst0, dst1, c->format, DST_LEN))
+            fail();
+
+        c->index = index;
+        c->frac  = frac;
+        bench_new(c, dst1, src, DST_LEN, 0);
+    }
+}
+
+void checkasm_check_sw_resample(void)
+{
+    int i, linear;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        for (linear = 0; linear < 2; linear++) {
+            /* 48kHz to 44.1kHz with the default filter */
+            ResampleContext *c = swri_resampler.init(NULL, 44100, 48000, 32, 10, linear,
+                                                     0.97, formats[i].fmt,
+                                                     SWR_FILTER_TYPE_KAISER, 9, 20, 0, 0);
+            if (!c)
+                continue;
+            /* start past the implicit leading zeros, with a fractional phase */
+            c->index = 3;
+            c->frac  = c->src_incr / 3;
+
+            check_resample(c, formats[i].name, linear);
+            swri_resampler.free(&c);
+        }
+        report("resample_%s", formats[i].name);
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/vf_overlay.h"
+#include "libavutil/mem.h"
+
+#define WIDTH 256
+#define WIDTH_PADDED (WIDTH + 32)
+
+#define randomize_buffers(buf, size)     \
+    do {                                 \
+       int j;                            \
+       uint8_t *tmp_buf = (uint8_t *)buf;\
+       for (j = 0; j < size; j++)        \
+           tmp_buf[j] = rnd() & 0xFF;    \
+    } while (0)
+
+static void check_overlay_row(int format, int pix_format, int plane,
+                              const char *name)
+{
+    LOCAL_ALIGNED_32(uint8_t, src    , [WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(uint8_t, alpha  , [WIDTH_PADDED * 2 * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst_org, [WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(uint8_t, dst_ref, [WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(uint8_t, dst_new, [WIDTH_PADDED]);
+    ptrdiff_t alinesize = WIDTH_PADDED * 2;
+    int w, ret_ref, ret_new;
+    OverlayContext s;
+
+    declare_func(int, uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                 int w, ptrdiff_t alinesize);
+
+    memset(&s, 0, sizeof(s));
+    ff_overlay_init(&s, format, pix_format, 0, 0);
+
+    randomize_buffers(src, WIDTH_PADDED);
+    randomize_buffers(alpha, WIDTH_PADDED * 2 * 2);
+    randomize_buffers(dst_org, WIDTH_PADDED);
+
+    if (check_func(s.blend_row[plane], "%s", name)) {
+        /* odd widths exercise the tail left to the generic code */
+        for (w = WIDTH - 7; w <= WIDTH; w += 7) {
+            memcpy(dst_ref, dst_org, WIDTH_PADDED);
+            memcpy(dst_new, dst_org, WIDTH_PADDED);
+            ret_ref = call_ref(dst_ref, NULL, src, alpha, w, alinesize);
+            ret_new = call_new(dst_new, NULL, src, alpha, w, alinesize);
+            /* the pixels left to the generic code must not be touched */
+            if (ret_new < 0 || ret_new > w ||
+                memcmp(dst_ref, dst_new, FFMIN(ret_ref, ret_new)) ||
+                memcmp(dst_org + ret_new, dst_new + ret_new, WIDTH_PADDED - ret_new))
+                fail();
+        }
+        bench_new(dst_new, NULL, src, alpha, WIDTH, alinesize);
+    }
+}
+
+void checkasm_check_vf_overlay(void)
+{
+    check_overlay_row(OVERLAY_FORMAT_YUV444, AV_PIX_FMT_YUV444P, 0, "overlay_row_44");
+    report("overlay_row_44");
+
+    check_overlay_row(OVERLAY_FORMAT_YUV420, AV_PIX_FMT_YUV420P, 1, "overlay_row_20");
+    report("overlay_row_20");
+
+    check_overlay_row(OVERLAY_FORMAT_YUV422, AV_PIX_FMT_YUV422P, 1, "overlay_row_22");
+    report("overlay_row_22");
+}
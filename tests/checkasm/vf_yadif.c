@@ -0,0 +1,99 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/yadif.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+
+/* 1080i and 2160i line widths */
+static const int widths[] = { 1920, 3840 };
+
+#define MAX_WIDTH  3840
+#define STRIDE     ((MAX_WIDTH + 64) * 2)
+#define ROWS       5
+#define BUF_SIZE   (STRIDE * ROWS)
+#define OFFSET     (2 * STRIDE)
+
+#define randomize_buffers(buf, size, depth)                 \
+    do {                                                    \
+        int j;                                              \
+        for (j = 0; j < size; j += 2)                       \
+            if (depth > 8)                                  \
+                AV_WN16A(buf + j, rnd() & ((1 << depth) - 1)); \
+            else                                            \
+                AV_WN16A(buf + j, rnd());                   \
+    } while (0)
+
+static void check_filter_line(int depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, prev,    [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, cur,     [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, next,    [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst_new, [BUF_SIZE]);
+    const int df   = (depth + 7) / 8;
+    const int edge = 3 + 8 / df - 1;
+    YADIFContext s;
+    int i, parity, mode;
+
+    declare_func(void, void *dst, void *prev, void *cur, void *next,
+                 int w, int prefs, int mrefs, int parity, int mode);
+
+    memset(&s, 0, sizeof(s));
+    ff_yadif_init_filter_line(&s, depth);
+
+    randomize_buffers(prev, BUF_SIZE, depth);
+    randomize_buffers(cur,  BUF_SIZE, depth);
+    randomize_buffers(next, BUF_SIZE, depth);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+        const int w   = widths[i] - edge;
+        const int off = OFFSET + 3 * df;
+
+        if (check_func(s.filter_line, "yadif_filter_line_%d_%d", depth, widths[i])) {
+            for (parity = 0; parity <= 1; parity++) {
+                for (mode = 0; mode <= 2; mode += 2) {
+                    memset(dst_ref, 0, BUF_SIZE);
+                    memset(dst_new, 0, BUF_SIZE);
+                    call_ref(dst_ref + off, prev + off, cur + off, next + off,
+                             w, STRIDE, -STRIDE, parity, mode);
+                    call_new(dst_new + off, prev + off, cur + off, next + off,
+                             w, STRIDE, -STRIDE, parity, mode);
+                    if (memcmp(dst_ref, dst_new, BUF_SIZE))
+                        fail();
+                }
+            }
+            bench_new(dst_new + off, prev + off, cur + off, next + off,
+                      w, STRIDE, -STRIDE, 0, 0);
+        }
+    }
+}
+
+void checkasm_check_vf_yadif(void)
+{
+    check_filter_line(8);
+    report("yadif8");
+
+    check_filter_line(10);
+    report("yadif10");
+
+    check_filter_line(16);
+    report("yadif16");
+}
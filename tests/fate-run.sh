@@ -139,6 +139,13 @@ ffmetadata(){
     ffmpeg "$@" -bitexact -f ffmetadata -
 }
 
+tee_framecrc(){
+    out1="${outdir}/${test}-1.framecrc"
+    out2="${outdir}/${test}-2.framecrc"
+    ffmpeg "$@" -bitexact -f tee "[f=framecrc]${out1}|[f=framecrc:select=v]${out2}" || return
+    cat "$out1" "$out2"
+}
+
 framemd5(){
     ffmpeg "$@" -bitexact -f framemd5 -
 }
@@ -358,6 +365,15 @@ refcmp_metadata(){
         -f null /dev/null | awk -v ref=${ref} -v fuzz=${fuzz} -f ${base}/refcmp-metadata.awk -
 }
 
+multimetrics_metadata(){
+    pixfmt=$1
+    fuzz=${2:-0.001}
+    sws_flags=bicubic+accurate_rnd+bitexact
+    ffmpeg $FLAGS $ENC_OPTS \
+        -lavfi "testsrc2=size=300x200:rate=1:duration=5,format=${pixfmt},split=3[ref][tmp0][tmp1];[tmp0]avgblur=4[enc0];[tmp1]scale=150:100:flags=${sws_flags}[enc1];[ref][enc0][enc1]multimetrics=flags=${sws_flags},metadata=print:file=-" \
+        -f null /dev/null | awk -v ref=${ref} -v fuzz=${fuzz} -f ${base}/refcmp-metadata.awk -
+}
+
 pixfmt_conversion(){
     conversion="${test#pixfmt-}"
     outdir="tests/data/pixfmt"
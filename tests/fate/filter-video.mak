@@ -219,6 +219,10 @@ FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_F
 fate-filter-overlay_yuv420: tests/data/filtergraphs/overlay_yuv420
 fate-filter-overlay_yuv420: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_yuv420
 
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER LUTYUV_FILTER PAD_FILTER OVERLAY_FILTER) += fate-filter-overlay_yuv420p10
+fate-filter-overlay_yuv420p10: tests/data/filtergraphs/overlay_yuv420p10
+fate-filter-overlay_yuv420p10: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_yuv420p10
+
 FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_FILTER) += fate-filter-overlay_nv12
 fate-filter-overlay_nv12: tests/data/filtergraphs/overlay_nv12
 fate-filter-overlay_nv12: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_nv12
@@ -233,6 +237,10 @@ FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_F
 fate-filter-overlay_yuv422: tests/data/filtergraphs/overlay_yuv422
 fate-filter-overlay_yuv422: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_yuv422
 
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER LUTYUV_FILTER PAD_FILTER OVERLAY_FILTER) += fate-filter-overlay_yuv422p10
+fate-filter-overlay_yuv422p10: tests/data/filtergraphs/overlay_yuv422p10
+fate-filter-overlay_yuv422p10: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_yuv422p10
+
 FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_FILTER) += fate-filter-overlay_yuv444
 fate-filter-overlay_yuv444: tests/data/filtergraphs/overlay_yuv444
 fate-filter-overlay_yuv444: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_yuv444
@@ -442,6 +450,20 @@ fate-filter-fps-down-eof-pass: CMD = framecrc -lavfi testsrc2=r=7:d=3.5,fps=3:eo
 fate-filter-fps-start-drop: CMD = framecrc -lavfi testsrc2=r=7:d=3.5,fps=3:start_time=1.5
 fate-filter-fps-start-fill: CMD = framecrc -lavfi testsrc2=r=7:d=1.5,setpts=PTS+14,fps=3:start_time=1.5
 
+TONEMAP_YUV_DEPS = TESTSRC2_FILTER FORMAT_FILTER SETPARAMS_FILTER TONEMAP_FILTER
+FATE_FILTER-$(call ALLYES, $(TONEMAP_YUV_DEPS)) += fate-filter-tonemap-yuv-pq fate-filter-tonemap-yuv-hlg
+fate-filter-tonemap-yuv-pq:  CMD = framecrc -lavfi testsrc2=s=320x240:r=5:d=1,format=yuv420p10,setparams=color_primaries=bt2020:color_trc=smpte2084:colorspace=bt2020nc,tonemap=hable:format=yuv420p -pix_fmt yuv420p
+fate-filter-tonemap-yuv-hlg: CMD = framecrc -lavfi testsrc2=s=320x240:r=5:d=1,format=yuv420p10,setparams=color_primaries=bt2020:color_trc=arib-std-b67:colorspace=bt2020nc,tonemap=hable:format=yuv420p -pix_fmt yuv420p
+
+LUT3D_DEPS = TESTSRC2_FILTER FORMAT_FILTER LUT3D_FILTER
+FATE_FILTER-$(call ALLYES, $(LUT3D_DEPS)) += fate-filter-lut3d-gbrp10-nearest fate-filter-lut3d-gbrp10-trilinear fate-filter-lut3d-gbrp10-tetrahedral fate-filter-lut3d-gbrap12
+fate-filter-lut3d-gbrp10-%: CMD = framecrc -lavfi testsrc2=s=320x240:r=5:d=1,format=gbrp10,lut3d=file=$(SRC_PATH)/tests/lut3d.cube:interp=$(@:fate-filter-lut3d-gbrp10-%=%) -pix_fmt gbrp10le
+fate-filter-lut3d-gbrap12: CMD = framecrc -lavfi testsrc2=s=320x240:r=5:d=1:alpha=192,format=gbrap12,lut3d=file=$(SRC_PATH)/tests/lut3d.cube -pix_fmt gbrap12le
+
+HALDCLUT_DEPS = TESTSRC2_FILTER HALDCLUTSRC_FILTER CURVES_FILTER FORMAT_FILTER SCALE_FILTER HALDCLUT_FILTER
+FATE_FILTER-$(call ALLYES, $(HALDCLUT_DEPS)) += fate-filter-haldclut-gbrp10
+fate-filter-haldclut-gbrp10: CMD = framecrc -lavfi "sws_flags=+accurate_rnd+bitexact;testsrc2=s=320x240:r=5:d=1,format=gbrp10[main];haldclutsrc=4:d=0.2,curves=vintage,format=gbrp10[clut];[main][clut]haldclut" -pix_fmt gbrp10le
+
 FATE_FILTER_SAMPLES-$(call ALLYES, MOV_DEMUXER FPS_FILTER QTRLE_DECODER) += fate-filter-fps-cfr fate-filter-fps fate-filter-fps-r
 fate-filter-fps-cfr: CMD = framecrc -i $(TARGET_SAMPLES)/qtrle/apple-animation-variable-fps-bug.mov -r 30 -vsync cfr -pix_fmt yuv420p
 fate-filter-fps-r:   CMD = framecrc -i $(TARGET_SAMPLES)/qtrle/apple-animation-variable-fps-bug.mov -r 30 -vf fps -pix_fmt yuv420p
@@ -736,12 +758,24 @@ FATE_METADATA_FILTER-$(call ALLYES, $(SCENEDETECT_DEPS)) += fate-filter-metadata
 fate-filter-metadata-scenedetect: SRC = $(TARGET_SAMPLES)/svq3/Vertical400kbit.sorenson3.mov
 fate-filter-metadata-scenedetect: CMD = run $(FILTER_METADATA_COMMAND) "sws_flags=+accurate_rnd+bitexact;movie='$(SRC)',select=gt(scene\,.25)"
 
+SCENEDETECT_THUMB_DEPS = FFPROBE LAVFI_INDEV TESTSRC2_FILTER FORMAT_FILTER SELECT_FILTER AVDEVICE
+FATE_METADATA_FILTER_LAVFI-$(call ALLYES, $(SCENEDETECT_THUMB_DEPS)) += fate-filter-metadata-scenedetect-thumb
+fate-filter-metadata-scenedetect-thumb: CMD = run $(FILTER_METADATA_COMMAND) "testsrc2=r=5:d=3:s=176x144,format=yuv420p,select=gte(scene\,0):scene_mode=thumb"
+
+FATE_METADATA_FILTER_LAVFI-$(call ALLYES, $(SCENEDETECT_THUMB_DEPS)) += fate-filter-metadata-scenedetect-thumb-10bit
+fate-filter-metadata-scenedetect-thumb-10bit: CMD = run $(FILTER_METADATA_COMMAND) "testsrc2=r=5:d=3:s=176x144,format=yuv420p10le,select=gte(scene\,0):scene_mode=thumb"
+
 CROPDETECT_DEPS = FFPROBE LAVFI_INDEV MOVIE_FILTER CROPDETECT_FILTER SCALE_FILTER \
                   AVCODEC AVDEVICE MOV_DEMUXER H264_DECODER
 FATE_METADATA_FILTER-$(call ALLYES, $(CROPDETECT_DEPS)) += fate-filter-metadata-cropdetect
 fate-filter-metadata-cropdetect: SRC = $(TARGET_SAMPLES)/filter/cropdetect.mp4
 fate-filter-metadata-cropdetect: CMD = run $(FILTER_METADATA_COMMAND) "sws_flags=+accurate_rnd+bitexact;movie='$(SRC)',cropdetect=max_outliers=3"
 
+QCDETECT_DEPS = FFPROBE LAVFI_INDEV COLOR_FILTER TESTSRC2_FILTER LOOP_FILTER CONCAT_FILTER \
+                PAD_FILTER FORMAT_FILTER QCDETECT_FILTER AVDEVICE
+FATE_METADATA_FILTER_LAVFI-$(call ALLYES, $(QCDETECT_DEPS)) += fate-filter-metadata-qcdetect
+fate-filter-metadata-qcdetect: CMD = run $(FILTER_METADATA_COMMAND) "color=black:s=160x96:r=5:d=1.2[b];testsrc2=s=160x96:r=5:d=1.2[t];testsrc2=s=160x96:r=5:d=0.2,loop=loop=7:size=1[f];[b][t][f]concat=n=3,pad=176:144:8:24,format=yuv420p,qcdetect=bd=0.5:fd=0.5:crop_round=2[out0]"
+
 SILENCEDETECT_DEPS = FFPROBE AVDEVICE LAVFI_INDEV AMOVIE_FILTER TTA_DEMUXER TTA_DECODER SILENCEDETECT_FILTER
 FATE_METADATA_FILTER-$(call ALLYES, $(SILENCEDETECT_DEPS)) += fate-filter-metadata-silencedetect
 fate-filter-metadata-silencedetect: SRC = $(TARGET_SAMPLES)/lossless-audio/inside.tta
@@ -793,10 +827,21 @@ fate-filter-refcmp-ssim-rgb: CMD = refcmp_metadata ssim rgb24 0.015
 FATE_FILTER_SAMPLES-$(call ALLYES, $(REFCMP_DEPS) SSIM_FILTER) += fate-filter-refcmp-ssim-yuv
 fate-filter-refcmp-ssim-yuv: CMD = refcmp_metadata ssim yuv422p 0.015
 
+MULTIMETRICS_DEPS = FFMPEG LAVFI_INDEV TESTSRC2_FILTER AVGBLUR_FILTER SCALE_FILTER METADATA_FILTER MULTIMETRICS_FILTER
+FATE_FILTER-$(call ALLYES, $(MULTIMETRICS_DEPS)) += fate-filter-multimetrics-yuv fate-filter-multimetrics-yuv10
+fate-filter-multimetrics-yuv:   CMD = multimetrics_metadata yuv420p 0.015
+fate-filter-multimetrics-yuv10: CMD = multimetrics_metadata yuv420p10 0.015
+
+FATE_FILTER-$(call ALLYES, $(REFCMP_DEPS) VMAF_FILTER) += fate-filter-refcmp-vmaf-yuv fate-filter-refcmp-vmaf-yuv10 fate-filter-refcmp-vmaf-model
+fate-filter-refcmp-vmaf-yuv:   CMD = refcmp_metadata vmaf yuv420p 0.002
+fate-filter-refcmp-vmaf-yuv10: CMD = refcmp_metadata vmaf yuv420p10 0.002
+fate-filter-refcmp-vmaf-model: CMD = refcmp_metadata "vmaf=model_path=$(SRC_PATH)/tests/vmaf.model:slopes=0.01|1|0.05|1|1|1|1:intercepts=0.2|0|0|0|0|0|0" yuv420p 0.002
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
+FATE_FFPROBE += $(FATE_METADATA_FILTER_LAVFI-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
 
 fate-vfilter: $(FATE_FILTER-yes) $(FATE_FILTER_SAMPLES-yes) $(FATE_FILTER_VSYNTH-yes)
 
-fate-filter: fate-afilter fate-vfilter $(FATE_METADATA_FILTER-yes)
+fate-filter: fate-afilter fate-vfilter $(FATE_METADATA_FILTER-yes) $(FATE_METADATA_FILTER_LAVFI-yes)
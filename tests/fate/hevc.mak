@@ -216,12 +216,35 @@ FATE_HEVC += fate-hevc-conformance-$(1)
 fate-hevc-conformance-$(1): CMD = framecrc -flags unaligned -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit -pix_fmt yuv444p12le
 endef
 
+# WPP streams decoded with wavefront threads nested inside frame threads,
+# the output must match the single threaded reference
+HEVC_SAMPLES_WPP = $(filter WPP_%,$(HEVC_SAMPLES))
+HEVC_SAMPLES_WPP_10BIT = $(filter WPP_%,$(HEVC_SAMPLES_10BIT))
+
+define FATE_HEVC_WPP_TEST
+FATE_HEVC += fate-hevc-conformance-$(1)-wpp-threads
+fate-hevc-conformance-$(1)-wpp-threads: CMD = framecrc -flags unaligned -vsync drop -wpp_threads 2 -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit -pix_fmt yuv420p
+fate-hevc-conformance-$(1)-wpp-threads: REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-$(1)
+fate-hevc-conformance-$(1)-wpp-threads: THREADS = 2
+fate-hevc-conformance-$(1)-wpp-threads: THREAD_TYPE = frame
+endef
+
+define FATE_HEVC_WPP_TEST_10BIT
+FATE_HEVC += fate-hevc-conformance-$(1)-wpp-threads
+fate-hevc-conformance-$(1)-wpp-threads: CMD = framecrc -flags unaligned -wpp_threads 2 -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit -pix_fmt yuv420p10le
+fate-hevc-conformance-$(1)-wpp-threads: REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-$(1)
+fate-hevc-conformance-$(1)-wpp-threads: THREADS = 2
+fate-hevc-conformance-$(1)-wpp-threads: THREAD_TYPE = frame
+endef
+
 $(foreach N,$(HEVC_SAMPLES),$(eval $(call FATE_HEVC_TEST,$(N))))
 $(foreach N,$(HEVC_SAMPLES_10BIT),$(eval $(call FATE_HEVC_TEST_10BIT,$(N))))
 $(foreach N,$(HEVC_SAMPLES_422_10BIT),$(eval $(call FATE_HEVC_TEST_422_10BIT,$(N))))
 $(foreach N,$(HEVC_SAMPLES_422_10BIN),$(eval $(call FATE_HEVC_TEST_422_10BIN,$(N))))
 $(foreach N,$(HEVC_SAMPLES_444_8BIT),$(eval $(call FATE_HEVC_TEST_444_8BIT,$(N))))
 $(foreach N,$(HEVC_SAMPLES_444_12BIT),$(eval $(call FATE_HEVC_TEST_444_12BIT,$(N))))
+$(foreach N,$(HEVC_SAMPLES_WPP),$(eval $(call FATE_HEVC_WPP_TEST,$(N))))
+$(foreach N,$(HEVC_SAMPLES_WPP_10BIT),$(eval $(call FATE_HEVC_WPP_TEST_10BIT,$(N))))
 
 fate-hevc-paramchange-yuv420p-yuv420p10: CMD = framecrc -vsync 0 -i $(TARGET_SAMPLES)/hevc/paramchange_yuv420p_yuv420p10.hevc -sws_flags area+accurate_rnd+bitexact
 FATE_HEVC += fate-hevc-paramchange-yuv420p-yuv420p10
@@ -56,6 +56,22 @@ fate-lavf-wtv: CMD = lavf_container "" "-c:a mp2 -threads 1"
 FATE_AVCONV += $(FATE_LAVF_CONTAINER)
 fate-lavf-container fate-lavf: $(FATE_LAVF_CONTAINER)
 
+# demuxer options exercised on the files generated above
+FATE_LAVF_DEMUX-$(call ENCDEC2, MPEG4,      MP2,       MATROSKA)           += skipnonkey-mkv
+FATE_LAVF_DEMUX-$(call ENCDEC2, MPEG4,      PCM_ALAW,  MOV)                += skipnonkey-mov
+FATE_LAVF_DEMUX-$(call ENCDEC2, MPEG2VIDEO, MP2,       MPEGTS)             += skipnonkey-ts
+
+FATE_LAVF_DEMUX = $(FATE_LAVF_DEMUX-yes:%=fate-lavf-%)
+
+fate-lavf-skipnonkey-%: SRC = $(TARGET_PATH)/tests/data/lavf/lavf.$(@:fate-lavf-skipnonkey-%=%)
+fate-lavf-skipnonkey-%: CMD = framecrc -fflags +skipnonkey -i $(SRC) -c copy
+fate-lavf-skipnonkey-mkv: fate-lavf-mkv
+fate-lavf-skipnonkey-mov: fate-lavf-mov
+fate-lavf-skipnonkey-ts:  fate-lavf-ts
+
+FATE_AVCONV += $(FATE_LAVF_DEMUX)
+fate-lavf-demux fate-lavf: $(FATE_LAVF_DEMUX)
+
 FATE_LAVF_CONTAINER_FATE-$(call ALLYES, MATROSKA_DEMUXER   OGG_MUXER)          += vp3.ogg
 FATE_LAVF_CONTAINER_FATE-$(call ALLYES, MATROSKA_DEMUXER   OGV_MUXER)          += vp8.ogg
 FATE_LAVF_CONTAINER_FATE-$(call ALLYES, MOV_DEMUXER        LATM_MUXER)         += latm
@@ -0,0 +1,17 @@
+TEE_MUXER_DEPS = TEE_MUXER FRAMECRC_MUXER LAVFI_INDEV TESTSRC2_FILTER SINE_FILTER RAWVIDEO_ENCODER PCM_S16LE_ENCODER
+TEE_MUXER_INPUT = -f lavfi -i testsrc2=s=160x120:r=10:d=2 -f lavfi -i sine=d=2 \
+                  -map 0 -map 1 -c:v rawvideo -pix_fmt yuv420p -c:a pcm_s16le
+
+# the queue holds every packet of the input, so that no packet is ever
+# dropped and the output does not depend on the thread scheduling
+FATE_TEE_MUXER-$(call ALLYES, $(TEE_MUXER_DEPS)) += fate-tee-muxer-threads-block fate-tee-muxer-threads-drop
+fate-tee-muxer-threads-block: CMD = tee_framecrc $(TEE_MUXER_INPUT) -use_threads 1 -queue_size 256 -queue_policy block
+fate-tee-muxer-threads-drop:  CMD = tee_framecrc $(TEE_MUXER_INPUT) -use_threads 1 -queue_size 256 -queue_policy drop
+fate-tee-muxer-threads-%: REF = $(SRC_PATH)/tests/ref/fate/tee-muxer
+
+FATE_TEE_MUXER-$(call ALLYES, $(TEE_MUXER_DEPS)) += fate-tee-muxer-nothreads
+fate-tee-muxer-nothreads: CMD = tee_framecrc $(TEE_MUXER_INPUT) -use_threads 0
+fate-tee-muxer-nothreads: REF = $(SRC_PATH)/tests/ref/fate/tee-muxer
+
+FATE_FFMPEG += $(FATE_TEE_MUXER-yes)
+fate-tee-muxer: $(FATE_TEE_MUXER-yes)